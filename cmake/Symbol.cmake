@@ -17,4 +17,5 @@ set (SYMBOL_SOURCES
   ${SYMBOL_DIR}/Scope.cpp
   ${SYMBOL_DIR}/STManager.cpp
   ${SYMBOL_DIR}/Type.cpp
+  ${SYMBOL_DIR}/ModuleInterface.cpp
 )
\ No newline at end of file
@@ -1,7 +1,16 @@
 #include "CodegenVisitor.h"
+#include "llvm/Support/Path.h"
 
 std::optional<Value *> CodegenVisitor::TvisitCompilationUnit(WPLParser::CompilationUnitContext *ctx)
 {
+    // The name of the input stream is the path to the file being compiled
+    if (dibuilder)
+    {
+        std::string source = ctx->getStart()->getTokenSource()->getSourceName();
+        debugFile = dibuilder->createFile(llvm::sys::path::filename(source), llvm::sys::path::parent_path(source));
+        compileUnit = dibuilder->createCompileUnit(llvm::dwarf::DW_LANG_C, debugFile, "wplc", flags & CompilerFlags::CONST_FOLD, "", 0);
+    }
+
     for (auto e : ctx->defs)
     {
         e->accept(this); // TODO: remove this?
@@ -21,7 +30,7 @@ std::optional<Value *> CodegenVisitor::TvisitCompilationUnit(WPLParser::Compilat
 
             if (!optSym)
             {
-                errorHandler.addCodegenError(fnCtx->getStart(), "Incorrectly bound symbol in function definition. Probably a compiler error.");
+                errorHandler.addCodegenError(fnCtx, "Incorrectly bound symbol in function definition. Probably a compiler error.");
                 return {};
             }
 
@@ -29,7 +38,7 @@ std::optional<Value *> CodegenVisitor::TvisitCompilationUnit(WPLParser::Compilat
 
             if (!symbol->type)
             {
-                errorHandler.addCodegenError(fnCtx->getStart(), "Type for function not correctly bound! Probably a compiler errror.");
+                errorHandler.addCodegenError(fnCtx, "Type for function not correctly bound! Probably a compiler errror.");
                 return {};
             }
 
@@ -46,13 +55,13 @@ std::optional<Value *> CodegenVisitor::TvisitCompilationUnit(WPLParser::Compilat
                 }
                 else
                 {
-                    errorHandler.addCodegenError(fnCtx->getStart(), "Could not treat function type as function.");
+                    errorHandler.addCodegenError(fnCtx, "Could not treat function type as function.");
                     return {};
                 }
             }
             else
             {
-                errorHandler.addCodegenError(fnCtx->getStart(), "Function bound to: " + generalType->toString() + ". Requires Invokable!");
+                errorHandler.addCodegenError(fnCtx, "Function bound to: " + generalType->toString() + ". Requires Invokable!");
             }
         }
     }
@@ -76,6 +85,10 @@ std::optional<Value *> CodegenVisitor::TvisitCompilationUnit(WPLParser::Compilat
          * This will segfault if not found, but, as stated, that should be impossible.
          */
 
+        // main isn't part of the source, so it has no debug info
+        if (dibuilder)
+            builder->SetCurrentDebugLocation(llvm::DebugLoc());
+
         FunctionType *mainFuncType = FunctionType::get(Int32Ty, {Int32Ty, Int8PtrPtrTy}, false);
         Function *mainFunc = Function::Create(mainFuncType, GlobalValue::ExternalLinkage, "main", module);
 
@@ -87,6 +100,9 @@ std::optional<Value *> CodegenVisitor::TvisitCompilationUnit(WPLParser::Compilat
         builder->CreateRet(builder->CreateCall(progFn, {}));
     }
 
+    if (dibuilder)
+        dibuilder->finalize();
+
     return {};
 }
 
@@ -95,7 +111,7 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
     std::optional<Symbol *> symOpt = props->getBinding(ctx->check);
     if (!symOpt)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Could not locate symbol for case");
+        errorHandler.addCodegenError(ctx, "Could not locate symbol for case");
         return {};
     }
 
@@ -104,26 +120,36 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
         auto origParent = builder->GetInsertBlock()->getParent();
         BasicBlock *mergeBlk = BasicBlock::Create(module->getContext(), "matchcont");
 
-        std::any anyCheck = ctx->check->accept(this);
+        llvm::Type *sumTy = sumType->getLLVMType(module);
+
+        // When the value being matched on has storage, read its tag and payload in place rather than copying the whole sum
+        std::optional<Value *> sumAddr = {};
+        if (WPLParser::FieldAccessContext *fieldCtx = dynamic_cast<WPLParser::FieldAccessContext *>(ctx->check->ex))
+            sumAddr = visitFieldAccessAddr(fieldCtx->fieldAccessExpr());
+
+        std::optional<Value *> optVal = sumAddr ? sumAddr : any2Value(ctx->check->accept(this));
 
         // Attempt to cast the check; if this fails, then codegen for the check failed
-        if (std::optional<Value *> optVal = any2Value(anyCheck))
+        if (optVal)
         {
-            // Check that the optional, in fact, has a value. Otherwise, something went wrong.
-            if (!optVal)
+            Value *SumPtr = optVal.value();
+
+            if (!sumAddr)
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->check->getText());
-                return {};
+                Value *sumVal = optVal.value();
+                SumPtr = CreateEntryBlockAlloc(sumVal->getType());
+                builder->CreateStore(sumVal, SumPtr);
             }
 
-            Value *sumVal = optVal.value();
-            llvm::AllocaInst *SumPtr = builder->CreateAlloca(sumVal->getType());
-            builder->CreateStore(sumVal, SumPtr);
-
-            Value *tagPtr = builder->CreateGEP(SumPtr, {Int32Zero, Int32Zero});
+            Value *tagPtr = builder->CreateGEP(sumTy, SumPtr, {Int32Zero, Int32Zero});
 
             Value *tag = builder->CreateLoad(tagPtr->getType()->getPointerElementType(), tagPtr);
 
+            /*
+             * Even though semantic analysis ensures that every case of the sum is covered, a sum that
+             * was never assigned (ie, a zero-initialized global or array element) still has tag 0, so
+             * any other tag falls through to the merge block.
+             */
             llvm::SwitchInst *switchInst = builder->CreateSwitch(tag, mergeBlk, sumType->getCases().size());
 
             for (WPLParser::MatchAlternativeContext *altCtx : ctx->cases)
@@ -132,7 +158,7 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
 
                 if (!localSymOpt)
                 {
-                    errorHandler.addCodegenError(altCtx->getStart(), "Failed to lookup type for case");
+                    errorHandler.addCodegenError(altCtx, "Failed to lookup type for case");
                     return {};
                 }
 
@@ -142,7 +168,7 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
 
                 if (index == 0)
                 {
-                    errorHandler.addCodegenError(ctx->getStart(), "Unable to find key for type " + localSymOpt.value()->type->toString() + " in sum");
+                    errorHandler.addCodegenError(ctx, "Unable to find key for type " + localSymOpt.value()->type->toString() + " in sum");
                     return {};
                 }
 
@@ -150,14 +176,14 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
 
                 builder->SetInsertPoint(matchBlk);
 
-                switchInst->addCase(ConstantInt::get(Int32Ty, index, true), matchBlk);
+                switchInst->addCase(ConstantInt::get(sumType->getTagType(module), index, true), matchBlk);
                 origParent->getBasicBlockList().push_back(matchBlk);
 
                 std::optional<Symbol *> varSymbolOpt = props->getBinding(altCtx->VARIABLE());
 
                 if (!varSymbolOpt)
                 {
-                    errorHandler.addCodegenError(altCtx->getStart(), "Failed to find symbol in match");
+                    errorHandler.addCodegenError(altCtx, "Failed to find symbol in match");
                     return {};
                 }
 
@@ -167,12 +193,12 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
                 llvm::Type *ty = varSymbol->type->getLLVMType(module);
 
                 // Can skip global stuff
-                llvm::AllocaInst *v = builder->CreateAlloca(ty, 0, altCtx->VARIABLE()->getText());
+                beginScope();
+                llvm::AllocaInst *v = CreateScopedAlloc(ty, altCtx->VARIABLE()->getText());
                 varSymbol->val = v;
-                // varSymbol->val = v;
 
                 // Now to store the var
-                Value *valuePtr = builder->CreateGEP(SumPtr, {Int32Zero, Int32One});
+                Value *valuePtr = builder->CreateGEP(sumTy, SumPtr, {Int32Zero, Int32One});
 
                 Value *corrected = builder->CreateBitCast(valuePtr, ty->getPointerTo());
 
@@ -181,6 +207,7 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
                 builder->CreateStore(val, v);
 
                 altCtx->eval->accept(this);
+                endScope();
 
                 if (WPLParser::BlockStatementContext *blkStmtCtx = dynamic_cast<WPLParser::BlockStatementContext *>(altCtx->eval))
                 {
@@ -201,6 +228,11 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
                 }
             }
         }
+        else
+        {
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->check->getText(); });
+            return {};
+        }
 
         origParent->getBasicBlockList().push_back(mergeBlk);
         builder->SetInsertPoint(mergeBlk);
@@ -208,63 +240,516 @@ std::optional<Value *> CodegenVisitor::TvisitMatchStatement(WPLParser::MatchStat
         return {};
     }
 
-    errorHandler.addCodegenError(ctx->getStart(), "Failed to lookup type for case");
+    errorHandler.addCodegenError(ctx, "Failed to lookup type for case");
 
     return {};
 }
 
-std::optional<Value *> CodegenVisitor::TvisitInvocation(WPLParser::InvocationContext *ctx)
+std::optional<std::vector<Value *>> CodegenVisitor::visitArguments(WPLParser::InvocationContext *ctx, const TypeInvoke *inv)
 {
-    std::optional<Symbol *> symOpt = props->getBinding((ctx->lam ? (antlr4::tree::ParseTree *)ctx->lam : (antlr4::tree::ParseTree *)ctx));
-    if (!symOpt)
+    std::vector<const Type *> paramTypes = inv->getParamTypes();
+
+    // Create the argument vector
+    std::vector<llvm::Value *> args;
+
+    // Variables whose arrays are passed as slices; the callee may write through them, so they cannot also be passed by reference
+    std::set<Symbol *> slicedRoots;
+    for (unsigned int i = 0; i < ctx->args.size() && i < paramTypes.size(); i++)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to lookup binding: " + ctx->getText());
-        return {};
+        if (!dynamic_cast<const TypeSlice *>(paramTypes.at(i)))
+            continue;
+
+        if (WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(ctx->args.at(i)))
+        {
+            if (std::optional<Symbol *> rootOpt = props->getBinding(access->fieldAccessExpr()->VARIABLE().at(0)))
+                slicedRoots.insert(rootOpt.value());
+        }
     }
 
-    if (const TypeInvoke *inv = dynamic_cast<const TypeInvoke *>(symOpt.value()->type))
+    // Populate the argument vector, breaking out of compilation if any argument fails to generate.
+    for (auto e : ctx->args)
     {
-        std::vector<const Type *> paramTypes = inv->getParamTypes();
+        if (args.size() < paramTypes.size())
+        {
+            if (const TypeSlice *slice = dynamic_cast<const TypeSlice *>(paramTypes.at(args.size())))
+            {
+                std::optional<Value *> sliceOpt = visitSliceArgument(e, slice);
+                if (!sliceOpt)
+                {
+                    errorHandler.addCodegenError(ctx, "Failed to generate code");
+                    return {};
+                }
 
-        // Create the argument vector
-        std::vector<llvm::Value *> args;
+                args.push_back(sliceOpt.value());
+                continue;
+            }
+        }
 
-        // Populate the argument vector, breaking out of compilation if any argument fails to generate.
-        for (auto e : ctx->args)
+        /*
+         * An aggregate held in a local variable can be passed by pointing directly at its storage. This isn't
+         * done for globals as the callee may update the global while still relying on the argument's value,
+         * nor for variables that are also passed as a slice as the callee may update them through it.
+         */
+        if (args.size() < paramTypes.size() && inv->takesByReference(module, paramTypes.at(args.size())))
         {
-            std::optional<Value *> valOpt = any2Value(e->accept(this));
-            if (!valOpt)
+            if (WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(e))
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code");
-                return {};
+                std::optional<Symbol *> rootOpt = props->getBinding(access->fieldAccessExpr()->VARIABLE().at(0));
+
+                if (rootOpt && !rootOpt.value()->isGlobal && !slicedRoots.count(rootOpt.value()))
+                {
+                    std::optional<Value *> addrOpt = visitFieldAccessAddr(access->fieldAccessExpr());
+
+                    if (addrOpt && addrOpt.value()->getType() == paramTypes.at(args.size())->getLLVMType(module)->getPointerTo())
+                    {
+                        args.push_back(addrOpt.value());
+                        continue;
+                    }
+                }
             }
+        }
+
+        std::optional<Value *> valOpt = any2Value(e->accept(this));
+        if (!valOpt)
+        {
+            errorHandler.addCodegenError(ctx, "Failed to generate code");
+            return {};
+        }
 
-            Value *val = valOpt.value();
+        Value *val = valOpt.value();
 
-            if (args.size() < paramTypes.size())
+        if (args.size() < paramTypes.size())
+        {
+            // TODO: METHODIZE!
+            if (const TypeSum *sum = dynamic_cast<const TypeSum *>(paramTypes.at(args.size())))
             {
-                // TODO: METHODIZE!
-                if (const TypeSum *sum = dynamic_cast<const TypeSum *>(paramTypes.at(args.size())))
-                {
-                    unsigned int index = sum->getIndex(module, val->getType());
+                unsigned int index = sum->getIndex(module, val->getType());
 
-                    if (index != 0)
-                    {
-                        llvm::Type *sumTy = sum->getLLVMType(module);
-                        llvm::AllocaInst *alloc = builder->CreateAlloca(sumTy, 0, "");
+                if (index != 0)
+                {
+                    llvm::Type *sumTy = sum->getLLVMType(module);
+                    llvm::AllocaInst *alloc = CreateEntryBlockAlloc(sumTy);
 
-                        Value *tagPtr = builder->CreateGEP(alloc, {Int32Zero, Int32Zero});
-                        builder->CreateStore(ConstantInt::get(Int32Ty, index, true), tagPtr);
-                        Value *valuePtr = builder->CreateGEP(alloc, {Int32Zero, Int32One});
-                        Value *corrected = builder->CreateBitCast(valuePtr, val->getType()->getPointerTo());
-                        builder->CreateStore(val, corrected);
+                    Value *tagPtr = builder->CreateGEP(alloc, {Int32Zero, Int32Zero});
+                    builder->CreateStore(ConstantInt::get(sum->getTagType(module), index, true), tagPtr);
+                    Value *valuePtr = builder->CreateGEP(alloc, {Int32Zero, Int32One});
+                    Value *corrected = builder->CreateBitCast(valuePtr, val->getType()->getPointerTo());
+                    builder->CreateStore(val, corrected);
 
-                        val = builder->CreateLoad(sumTy, alloc);
-                    }
+                    val = builder->CreateLoad(sumTy, alloc);
                 }
             }
 
-            args.push_back(val);
+            // Aggregates are passed as a pointer to storage; the callee copies it if it needs to make changes
+            if (inv->takesByReference(module, paramTypes.at(args.size())))
+            {
+                llvm::AllocaInst *alloc = CreateEntryBlockAlloc(val->getType());
+                builder->CreateStore(val, alloc);
+                val = alloc;
+            }
+        }
+
+        args.push_back(val);
+    }
+
+    return args;
+}
+
+std::optional<Value *> CodegenVisitor::visitSliceArgument(WPLParser::ExpressionContext *ctx, const TypeSlice *slice)
+{
+    // Arrays held in a variable are referred to where they are stored
+    Value *arrayPtr = nullptr;
+
+    if (WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(ctx))
+    {
+        // Dynamic arrays already have a pointer to their elements and a length, so they just drop their capacity
+        std::optional<Symbol *> rootOpt = props->getBinding(access->fieldAccessExpr()->VARIABLE().at(0));
+        if (rootOpt && access->fieldAccessExpr()->VARIABLE().size() == 1 && dynamic_cast<const TypeDynArray *>(rootOpt.value()->type))
+        {
+            std::optional<std::pair<Value *, Value *>> arrOpt = visitArrayElements(rootOpt.value(), ctx);
+            if (!arrOpt)
+                return {};
+
+            Value *ans = llvm::UndefValue::get(slice->getLLVMType(module));
+            ans = builder->CreateInsertValue(ans, arrOpt.value().first, 0);
+            ans = builder->CreateInsertValue(ans, arrOpt.value().second, 1);
+            return ans;
+        }
+
+        std::optional<Value *> addrOpt = visitFieldAccessAddr(access->fieldAccessExpr());
+        if (addrOpt && addrOpt.value()->getType()->isPointerTy() && addrOpt.value()->getType()->getPointerElementType()->isArrayTy())
+            arrayPtr = addrOpt.value();
+    }
+
+    if (!arrayPtr)
+    {
+        std::optional<Value *> valOpt = any2Value(ctx->accept(this));
+        if (!valOpt)
+            return {};
+
+        // Slices are passed along as they are
+        if (valOpt.value()->getType() == slice->getLLVMType(module))
+            return valOpt;
+
+        // Any other array (ie, one returned by a call) is given storage for the duration of the call
+        arrayPtr = CreateEntryBlockAlloc(valOpt.value()->getType());
+        builder->CreateStore(valOpt.value(), arrayPtr);
+    }
+
+    llvm::ArrayType *arrayTy = llvm::cast<llvm::ArrayType>(arrayPtr->getType()->getPointerElementType());
+
+    Value *ans = llvm::UndefValue::get(slice->getLLVMType(module));
+    ans = builder->CreateInsertValue(ans, builder->CreateGEP(arrayTy, arrayPtr, {Int32Zero, Int32Zero}), 0);
+    ans = builder->CreateInsertValue(ans, builder->getInt32(arrayTy->getNumElements()), 1);
+    return ans;
+}
+
+std::optional<std::pair<Value *, Value *>> CodegenVisitor::visitArrayElements(Symbol *sym, antlr4::ParserRuleContext *ctx)
+{
+    if (const TypeDynArray *dyn = dynamic_cast<const TypeDynArray *>(sym->type))
+    {
+        if (!sym->val)
+            return {};
+
+        llvm::Type *arrTy = dyn->getLLVMType(module);
+        Value *header = sym->val.value();
+
+        Value *elements = builder->CreateLoad(arrTy->getStructElementType(0), builder->CreateStructGEP(arrTy, header, 0));
+        Value *length = builder->CreateLoad(Int32Ty, builder->CreateStructGEP(arrTy, header, 1));
+        return std::make_pair(elements, length);
+    }
+
+    if (dynamic_cast<const TypeSlice *>(sym->type))
+    {
+        std::optional<Value *> sliceOpt = visitVariable(sym->identifier, sym, ctx);
+        if (!sliceOpt)
+            return {};
+
+        return std::make_pair(builder->CreateExtractValue(sliceOpt.value(), 0), builder->CreateExtractValue(sliceOpt.value(), 1));
+    }
+
+    const TypeArray *arr = dynamic_cast<const TypeArray *>(sym->type);
+    if (!arr)
+        return {};
+
+    // Fixed length arrays are used where they are stored (ie, a local, a global, or a parameter passed by reference)
+    Value *arrayPtr = sym->val ? sym->val.value() : module->getNamedGlobal(sym->identifier);
+
+    if (!arrayPtr || !arrayPtr->getType()->isPointerTy() || !arrayPtr->getType()->getPointerElementType()->isArrayTy())
+    {
+        std::optional<Value *> valOpt = visitVariable(sym->identifier, sym, ctx);
+        if (!valOpt)
+            return {};
+
+        arrayPtr = CreateEntryBlockAlloc(valOpt.value()->getType());
+        builder->CreateStore(valOpt.value(), arrayPtr);
+    }
+
+    Value *elements = builder->CreateGEP(arrayPtr->getType()->getPointerElementType(), arrayPtr, {Int32Zero, Int32Zero});
+    return std::make_pair(elements, builder->getInt32(arr->getLength()));
+}
+
+Value *CodegenVisitor::visitCountedLoop(Value *start, Value *end, unsigned int step, Value *init, std::function<Value *(Value *, Value *)> body)
+{
+    Function *parentFn = builder->GetInsertBlock()->getParent();
+    BasicBlock *preBlk = builder->GetInsertBlock();
+    BasicBlock *loopBlk = BasicBlock::Create(module->getContext(), "arrayloop", parentFn);
+    BasicBlock *exitBlk = BasicBlock::Create(module->getContext(), "arrayloopexit", parentFn);
+
+    builder->CreateCondBr(builder->CreateICmpSLT(start, end), loopBlk, exitBlk);
+
+    builder->SetInsertPoint(loopBlk);
+    llvm::PHINode *index = builder->CreatePHI(Int32Ty, 2);
+    llvm::PHINode *acc = init ? builder->CreatePHI(init->getType(), 2) : nullptr;
+
+    index->addIncoming(start, preBlk);
+    if (acc)
+        acc->addIncoming(init, preBlk);
+
+    Value *next = body(index, acc);
+
+    // As end - start is a multiple of the step, the index never passes the end (and so cannot overflow)
+    Value *nextIndex = builder->CreateNSWAdd(index, builder->getInt32(step));
+    BasicBlock *latchBlk = builder->GetInsertBlock();
+
+    index->addIncoming(nextIndex, latchBlk);
+    if (acc)
+        acc->addIncoming(next, latchBlk);
+
+    builder->CreateCondBr(builder->CreateICmpSLT(nextIndex, end), loopBlk, exitBlk);
+    builder->SetInsertPoint(exitBlk);
+
+    if (!acc)
+        return nullptr;
+
+    llvm::PHINode *ans = builder->CreatePHI(init->getType(), 2);
+    ans->addIncoming(init, preBlk);
+    ans->addIncoming(next, latchBlk);
+    return ans;
+}
+
+std::optional<Value *> CodegenVisitor::visitArrayMethod(WPLParser::InvocationContext *ctx, Symbol *sym)
+{
+    std::string method = ctx->field->fields.at(1)->getText();
+
+    if (method == "push" || method == "resize")
+        return visitDynArrayMethod(ctx, sym);
+
+    const Type *valueType = Types::getArrayValueType(sym->type);
+    std::optional<std::pair<Value *, Value *>> arrOpt = visitArrayElements(sym, ctx);
+
+    if (!arrOpt)
+    {
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
+        return {};
+    }
+
+    Value *elements = arrOpt.value().first;
+    Value *length = arrOpt.value().second;
+
+    llvm::Type *elemTy = valueType->getLLVMType(module);
+    const llvm::DataLayout &layout = module->getDataLayout();
+    llvm::Align align = layout.getABITypeAlign(elemTy);
+    uint64_t elemSize = layout.getTypeAllocSize(elemTy);
+
+    // Gets the size in bytes of the given number of elements
+    auto sizeOf = [this, elemSize](Value *count) { return builder->CreateMul(builder->CreateZExt(count, builder->getInt64Ty()), builder->getInt64(elemSize)); };
+
+    if (method == "fill")
+    {
+        std::optional<Value *> valOpt = any2Value(ctx->args.at(0)->accept(this));
+        if (!valOpt)
+            return {};
+
+        Value *val = valOpt.value();
+
+        // Filling with zeros (or bytes) is just a memset
+        llvm::Constant *constant = llvm::dyn_cast<llvm::Constant>(val);
+        if ((constant && constant->isNullValue()) || (elemTy->isIntegerTy() && elemSize == 1))
+        {
+            Value *byte = elemTy->isIntegerTy() ? builder->CreateZExtOrTrunc(val, Int8Ty) : builder->getInt8(0);
+            builder->CreateMemSet(elements, byte, sizeOf(length), align);
+            return {};
+        }
+
+        // Otherwise, integers can be stored a whole vector at a time
+        Value *vecEnd = Int32Zero;
+        if (elemTy->isIntegerTy())
+        {
+            unsigned int width = getVectorWidth(elemTy);
+            llvm::Type *vecTy = llvm::FixedVectorType::get(elemTy, width);
+            Value *splat = builder->CreateVectorSplat(width, val);
+
+            vecEnd = builder->CreateAnd(length, builder->getInt32(-width));
+            visitCountedLoop(Int32Zero, vecEnd, width, nullptr, [&](Value *i, Value *) {
+                Value *ptr = builder->CreateBitCast(builder->CreateGEP(elemTy, elements, i), vecTy->getPointerTo());
+                builder->CreateAlignedStore(splat, ptr, align);
+                return nullptr;
+            });
+        }
+
+        visitCountedLoop(vecEnd, length, 1, nullptr, [&](Value *i, Value *) {
+            builder->CreateAlignedStore(val, builder->CreateGEP(elemTy, elements, i), align);
+            return nullptr;
+        });
+        return {};
+    }
+
+    // The remaining methods either take no arguments, or another array whose elements are paired with our own
+    Value *otherElements = nullptr;
+    if (ctx->args.size())
+    {
+        TypeSlice sliceTy(valueType);
+        std::optional<Value *> otherOpt = visitSliceArgument(ctx->args.at(0), &sliceTy);
+        if (!otherOpt)
+        {
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->args.at(0)->getText(); });
+            return {};
+        }
+
+        otherElements = builder->CreateExtractValue(otherOpt.value(), 0);
+        length = builder->CreateBinaryIntrinsic(llvm::Intrinsic::smin, length, builder->CreateExtractValue(otherOpt.value(), 1));
+    }
+
+    // Arrays may overlap (ie, when passing a slice to itself), so copies must be moves
+    if (method == "copy")
+    {
+        builder->CreateMemMove(elements, align, otherElements, align, sizeOf(length));
+        return {};
+    }
+
+    /*
+     * Everything else operates on integers, so they are processed a vector at a time (of getVectorWidth() elements)
+     * followed by a scalar loop over any remaining elements. Reductions keep a vector of partial results which are
+     * combined once the vector loop completes, and then continue from there in the scalar loop.
+     */
+    const TypeInt *intType = static_cast<const TypeInt *>(valueType);
+    unsigned int bits = intType->getBits();
+    unsigned int width = getVectorWidth(elemTy);
+    llvm::Type *vecTy = llvm::FixedVectorType::get(elemTy, width);
+
+    // Loads (or stores) the elements starting at the index a vector at a time when given a vector type
+    auto load = [&](Value *base, Value *i, llvm::Type *ty) { return builder->CreateAlignedLoad(ty, builder->CreateBitCast(builder->CreateGEP(elemTy, base, i), ty->getPointerTo()), align); };
+    auto store = [&](Value *val, Value *i) { builder->CreateAlignedStore(val, builder->CreateBitCast(builder->CreateGEP(elemTy, elements, i), val->getType()->getPointerTo()), align); };
+
+    Value *vecEnd = builder->CreateAnd(length, builder->getInt32(-width));
+
+    if (method == "add" || method == "mul")
+    {
+        bool isAdd = method == "add";
+        auto body = [&](llvm::Type *ty) {
+            return [&, ty](Value *i, Value *) {
+                Value *mine = load(elements, i, ty);
+                Value *theirs = load(otherElements, i, ty);
+                store(isAdd ? builder->CreateAdd(mine, theirs) : builder->CreateMul(mine, theirs), i);
+                return nullptr;
+            };
+        };
+
+        visitCountedLoop(Int32Zero, vecEnd, width, nullptr, body(vecTy));
+        visitCountedLoop(vecEnd, length, 1, nullptr, body(elemTy));
+        return {};
+    }
+
+    // As with arithmetic on unsigned integers, reductions wrap around on overflow. Each starts from its identity, which is
+    // therefore the result for an empty array (ie, INT_MAX for min() and INT_MIN for max())
+    llvm::Intrinsic::ID combineId = llvm::Intrinsic::not_intrinsic;
+    llvm::APInt identity = llvm::APInt::getNullValue(bits);
+
+    if (method == "min")
+    {
+        combineId = intType->getIsSigned() ? llvm::Intrinsic::smin : llvm::Intrinsic::umin;
+        identity = intType->getIsSigned() ? llvm::APInt::getSignedMaxValue(bits) : llvm::APInt::getMaxValue(bits);
+    }
+    else if (method == "max")
+    {
+        combineId = intType->getIsSigned() ? llvm::Intrinsic::smax : llvm::Intrinsic::umax;
+        identity = intType->getIsSigned() ? llvm::APInt::getSignedMinValue(bits) : llvm::APInt::getMinValue(bits);
+    }
+
+    auto combine = [&](Value *acc, Value *val) { return combineId == llvm::Intrinsic::not_intrinsic ? builder->CreateAdd(acc, val) : builder->CreateBinaryIntrinsic(combineId, acc, val); };
+    auto body = [&](llvm::Type *ty) {
+        return [&, ty](Value *i, Value *acc) {
+            Value *val = load(elements, i, ty);
+            if (otherElements)
+                val = builder->CreateMul(val, load(otherElements, i, ty));
+            return combine(acc, val);
+        };
+    };
+
+    Value *init = ConstantInt::get(module->getContext(), identity);
+    Value *vecAcc = visitCountedLoop(Int32Zero, vecEnd, width, builder->CreateVectorSplat(width, init), body(vecTy));
+
+    Value *partial = nullptr;
+    if (method == "min")
+        partial = builder->CreateIntMinReduce(vecAcc, intType->getIsSigned());
+    else if (method == "max")
+        partial = builder->CreateIntMaxReduce(vecAcc, intType->getIsSigned());
+    else
+        partial = builder->CreateAddReduce(vecAcc);
+
+    return visitCountedLoop(vecEnd, length, 1, partial, body(elemTy));
+}
+
+std::optional<Value *> CodegenVisitor::visitDynArrayMethod(WPLParser::InvocationContext *ctx, Symbol *sym)
+{
+    const TypeDynArray *dyn = static_cast<const TypeDynArray *>(sym->type);
+    std::optional<Value *> argOpt = any2Value(ctx->args.at(0)->accept(this));
+
+    if (!sym->val || !argOpt)
+    {
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
+        return {};
+    }
+
+    Value *header = sym->val.value();
+
+    // Like fill and copy, neither method produces a value
+    if (ctx->field->fields.at(1)->getText() == "resize")
+    {
+        visitArrayResize(header, argOpt.value(), dyn);
+        return {};
+    }
+
+    /*
+     * Pushes only call into the runtime when the array is full. As the runtime at least doubles the
+     * capacity each time, this is rare, so the common case is just a store and an increment.
+     */
+    llvm::Type *arrTy = dyn->getLLVMType(module);
+    Value *lengthPtr = builder->CreateStructGEP(arrTy, header, 1);
+    Value *length = builder->CreateLoad(Int32Ty, lengthPtr);
+    Value *capacity = builder->CreateLoad(Int32Ty, builder->CreateStructGEP(arrTy, header, 2));
+    Value *newLength = builder->CreateNSWAdd(length, Int32One);
+
+    Function *parentFn = builder->GetInsertBlock()->getParent();
+    BasicBlock *growBlk = BasicBlock::Create(module->getContext(), "grow", parentFn);
+    BasicBlock *pushBlk = BasicBlock::Create(module->getContext(), "push", parentFn);
+
+    llvm::MDBuilder mdBuilder(module->getContext());
+    builder->CreateCondBr(builder->CreateICmpEQ(length, capacity), growBlk, pushBlk, mdBuilder.createBranchWeights(1, 1 << 4));
+
+    builder->SetInsertPoint(growBlk);
+    visitArrayResize(header, newLength, dyn);
+    builder->CreateBr(pushBlk);
+
+    builder->SetInsertPoint(pushBlk);
+    builder->CreateStore(newLength, lengthPtr);
+
+    Value *elements = builder->CreateLoad(arrTy->getStructElementType(0), builder->CreateStructGEP(arrTy, header, 0));
+    builder->CreateStore(argOpt.value(), builder->CreateGEP(dyn->getValueType()->getLLVMType(module), elements, length));
+    return {};
+}
+
+Value *CodegenVisitor::visitArrayResize(Value *header, Value *length, const TypeDynArray *dyn)
+{
+    uint64_t elemSize = module->getDataLayout().getTypeAllocSize(dyn->getValueType()->getLLVMType(module));
+    FunctionCallee resizeFn = module->getOrInsertFunction("_wplArrayResize", FunctionType::get(VoidTy, {i8p, Int32Ty, Int32Ty}, false));
+
+    return builder->CreateCall(resizeFn, {builder->CreateBitCast(header, i8p), length, builder->getInt32(elemSize)});
+}
+
+void CodegenVisitor::freeArrays(const std::vector<llvm::AllocaInst *> &arrays)
+{
+    if (arrays.empty())
+        return;
+
+    FunctionCallee freeFn = module->getOrInsertFunction("_wplArrayFree", FunctionType::get(VoidTy, {i8p}, false));
+
+    for (auto it = arrays.rbegin(); it != arrays.rend(); it++)
+        builder->CreateCall(freeFn, {builder->CreateBitCast(*it, i8p)});
+}
+
+std::optional<Value *> CodegenVisitor::TvisitInvocation(WPLParser::InvocationContext *ctx)
+{
+    // The built in methods of arrays (ie, xs.sum() or xs.push(1)) are bound to the array itself
+    if (!ctx->lam && ctx->field->VARIABLE().size() == 2)
+    {
+        std::optional<Symbol *> rootOpt = props->getBinding(ctx->field->VARIABLE().at(0));
+        if (rootOpt && Types::getArrayValueType(rootOpt.value()->type))
+            return visitArrayMethod(ctx, rootOpt.value());
+    }
+
+    std::optional<Symbol *> symOpt = props->getBinding((ctx->lam ? (antlr4::tree::ParseTree *)ctx->lam : (antlr4::tree::ParseTree *)ctx));
+    if (!symOpt)
+    {
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to lookup binding: " + ctx->getText(); });
+        return {};
+    }
+
+    if (const TypeInvoke *inv = dynamic_cast<const TypeInvoke *>(symOpt.value()->type))
+    {
+        std::optional<std::vector<Value *>> argsOpt = visitArguments(ctx, inv);
+        if (!argsOpt)
+            return {};
+
+        std::vector<Value *> args = argsOpt.value();
+
+        // Aggregates are returned by having the callee write them into storage that we provide
+        llvm::AllocaInst *structReturn = nullptr;
+        if (inv->hasStructReturn(module))
+        {
+            structReturn = CreateEntryBlockAlloc(inv->getReturnType()->getLLVMType(module));
+            args.insert(args.begin(), structReturn);
         }
 
         // Convert to an array ref, then find and execute the call.
@@ -274,19 +759,19 @@ std::optional<Value *> CodegenVisitor::TvisitInvocation(WPLParser::InvocationCon
             std::optional<Value *> callOpt = TvisitLambdaConstExpr(ctx->lam);
             if (!callOpt)
             {
-                errorHandler.addCodegenError(ctx->lam->getStart(), "Could not generate code for lambda");
+                errorHandler.addCodegenError(ctx->lam, "Could not generate code for lambda");
                 return {};
             }
             llvm::Function *call = (llvm::Function *)callOpt.value();
             Value *val = builder->CreateCall(call, ref); // Needs to be separate line because, C++
-            return val;
+            return structReturn ? builder->CreateLoad(structReturn->getAllocatedType(), structReturn) : val;
         }
 
         // llvm::Function *call = module->getFunction(ctx->VARIABLE()->getText());
         std::optional<Value *> fnOpt = any2Value(ctx->field->accept(this));
         if (!fnOpt)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Could not locate function for invocation: " + ctx->field->getText() + ". Has it been defined in IR yet?");
+            errorHandler.addCodegenError(ctx, [=]() { return "Could not locate function for invocation: " + ctx->field->getText() + ". Has it been defined in IR yet?"; });
             return {};
         }
 
@@ -298,16 +783,16 @@ std::optional<Value *> CodegenVisitor::TvisitInvocation(WPLParser::InvocationCon
         {
             llvm::Function *call = static_cast<llvm::Function *>(fnVal);
             Value *val = builder->CreateCall(call, ref); // Needs to be separate line because, C++
-            return val;
+            return structReturn ? builder->CreateLoad(structReturn->getAllocatedType(), structReturn) : val;
         }
 
         llvm::FunctionType *fnType = static_cast<llvm::FunctionType *>(ty->getPointerElementType());
 
         Value *val = builder->CreateCall(fnType, fnVal, ref);
-        return val;
+        return structReturn ? builder->CreateLoad(structReturn->getAllocatedType(), structReturn) : val;
     }
 
-    errorHandler.addCodegenError(ctx->getStart(), "Invocation got non-invokable type!");
+    errorHandler.addCodegenError(ctx, "Invocation got non-invokable type!");
     return {};
 }
 
@@ -320,7 +805,7 @@ std::optional<Value *> CodegenVisitor::TvisitInitProduct(WPLParser::InitProductC
         std::optional<Value *> valOpt = any2Value(e->accept(this));
         if (!valOpt)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code");
+            errorHandler.addCodegenError(ctx, "Failed to generate code");
             return {};
         }
 
@@ -334,7 +819,7 @@ std::optional<Value *> CodegenVisitor::TvisitInitProduct(WPLParser::InitProductC
     std::optional<Symbol *> varSymOpt = props->getBinding(ctx);
     if (!varSymOpt)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Incorrectly processed variable in assignment: " + ctx->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Incorrectly processed variable in assignment: " + ctx->getText(); });
         return {};
     }
 
@@ -343,7 +828,7 @@ std::optional<Value *> CodegenVisitor::TvisitInitProduct(WPLParser::InitProductC
     if (const TypeStruct *product = dynamic_cast<const TypeStruct *>(varSym->type))
     {
         llvm::Type *ty = varSym->type->getLLVMType(module);
-        llvm::AllocaInst *v = builder->CreateAlloca(ty, 0, "");
+        llvm::AllocaInst *v = CreateEntryBlockAlloc(ty);
         {
             unsigned i = 0;
             std::vector<std::pair<std::string, const Type *>> elements = product->getElements();
@@ -357,10 +842,10 @@ std::optional<Value *> CodegenVisitor::TvisitInitProduct(WPLParser::InitProductC
                     if (index != 0)
                     {
                         llvm::Type *sumTy = sum->getLLVMType(module);
-                        llvm::AllocaInst *alloc = builder->CreateAlloca(sumTy, 0, "");
+                        llvm::AllocaInst *alloc = CreateEntryBlockAlloc(sumTy);
 
                         Value *tagPtr = builder->CreateGEP(alloc, {Int32Zero, Int32Zero});
-                        builder->CreateStore(ConstantInt::get(Int32Ty, index, true), tagPtr);
+                        builder->CreateStore(ConstantInt::get(sum->getTagType(module), index, true), tagPtr);
                         Value *valuePtr = builder->CreateGEP(alloc, {Int32Zero, Int32One});
                         Value *corrected = builder->CreateBitCast(valuePtr, a->getType()->getPointerTo());
                         builder->CreateStore(a, corrected);
@@ -380,88 +865,693 @@ std::optional<Value *> CodegenVisitor::TvisitInitProduct(WPLParser::InitProductC
         return loaded;
     }
 
-    errorHandler.addCodegenError(ctx->getStart(), "Failed to gen init");
+    errorHandler.addCodegenError(ctx, "Failed to gen init");
     return {};
 }
 
-std::optional<Value *> CodegenVisitor::TvisitArrayAccess(WPLParser::ArrayAccessContext *ctx)
+std::optional<Value *> CodegenVisitor::visitFieldAccessAddr(WPLParser::FieldAccessExprContext *ctx)
 {
-    // Attempt to get the index Value
-    std::optional<Value *> index = any2Value(ctx->index->accept(this));
+    std::optional<Symbol *> symOpt = props->getBinding(ctx->VARIABLE().at(0));
 
-    if (!index)
-    {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code in TvisitArrayAccess for index!");
+    if (!symOpt || !symOpt.value()->type || dynamic_cast<const TypeInvoke *>(symOpt.value()->type))
         return {};
-    }
 
-    std::optional<Value *> arrayPtr = any2Value(ctx->field->accept(this));
-    if (!arrayPtr)
+    Symbol *sym = symOpt.value();
+
+    std::optional<Value *> rootAddr = {};
+
+    if (sym->val)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to locate array in access");
-        return {};
+        rootAddr = sym->val.value();
+    }
+    else if (sym->isGlobal)
+    {
+        if (llvm::GlobalVariable *glob = module->getNamedGlobal(sym->identifier))
+            rootAddr = glob;
     }
 
-    Value *baseValue = arrayPtr.value();
+    if (!rootAddr || ctx->fields.size() == 1)
+        return rootAddr;
 
-    llvm::AllocaInst *v = builder->CreateAlloca(baseValue->getType());
-    builder->CreateStore(baseValue, v);
+    // Build the indices for the chain of struct fields so that the whole chain can be resolved with a single GEP
+    std::vector<Value *> indices = {Int32Zero};
+    const Type *ty = sym->type;
 
-    auto ptr = builder->CreateGEP(v, {Int32Zero, index.value()});
-    Value *val = builder->CreateLoad(ptr->getType()->getPointerElementType(), ptr);
+    for (unsigned int i = 1; i < ctx->fields.size(); i++)
+    {
+        // Only structs have addressable fields (ie, array length does not)
+        if (!dynamic_cast<const TypeStruct *>(ty))
+            return {};
+
+        std::optional<unsigned int> indexOpt = props->getFieldIndex(ctx->VARIABLE().at(i));
+        std::optional<Symbol *> fieldOpt = props->getBinding(ctx->VARIABLE().at(i));
+
+        if (!indexOpt || !fieldOpt)
+            return {};
+
+        indices.push_back(ConstantInt::get(Int32Ty, indexOpt.value(), true));
+        ty = fieldOpt.value()->type;
+    }
+
+    return builder->CreateGEP(sym->type->getLLVMType(module), rootAddr.value(), indices);
+}
+
+std::optional<Value *> CodegenVisitor::visitArrayAccessAddr(WPLParser::ArrayAccessContext *ctx)
+{
+    std::optional<Symbol *> symOpt = props->getBinding(ctx->field->VARIABLE().at(ctx->field->VARIABLE().size() - 1));
+
+    if (!symOpt)
+        return {};
+
+    // Dynamic arrays hold a pointer to their elements on the heap, along with how many there are
+    if (const TypeDynArray *dyn = dynamic_cast<const TypeDynArray *>(symOpt.value()->type))
+    {
+        std::optional<Value *> index = any2Value(ctx->index->accept(this));
+
+        if (!symOpt.value()->val || !index)
+        {
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
+            return {};
+        }
+
+        llvm::Type *arrTy = dyn->getLLVMType(module);
+        Value *header = symOpt.value()->val.value();
+        Value *elements = builder->CreateLoad(arrTy->getStructElementType(0), builder->CreateStructGEP(arrTy, header, 0));
+
+        visitBoundsCheck(ctx, index.value(), builder->CreateLoad(Int32Ty, builder->CreateStructGEP(arrTy, header, 1)));
+
+        return builder->CreateGEP(dyn->getValueType()->getLLVMType(module), elements, index.value());
+    }
+
+    // Slices already hold a pointer to their elements, along with how many there are
+    if (const TypeSlice *slice = dynamic_cast<const TypeSlice *>(symOpt.value()->type))
+    {
+        std::optional<Value *> sliceVal = any2Value(ctx->field->accept(this));
+        std::optional<Value *> index = any2Value(ctx->index->accept(this));
+
+        if (!sliceVal || !index)
+        {
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
+            return {};
+        }
+
+        Value *elements = builder->CreateExtractValue(sliceVal.value(), 0);
+        visitBoundsCheck(ctx, index.value(), builder->CreateExtractValue(sliceVal.value(), 1));
+
+        return builder->CreateGEP(slice->getValueType()->getLLVMType(module), elements, index.value());
+    }
+
+    const TypeArray *arrayType = dynamic_cast<const TypeArray *>(symOpt.value()->type);
+    if (!arrayType)
+        return {};
+
+    std::optional<Value *> baseAddr = visitFieldAccessAddr(ctx->field);
+    if (!baseAddr)
+        return {};
+
+    std::optional<Value *> index = any2Value(ctx->index->accept(this));
+    if (!index)
+    {
+        errorHandler.addCodegenError(ctx, "Failed to generate code for array index!");
+        return {};
+    }
+
+    visitBoundsCheck(ctx, index.value(), arrayType->getLength());
+
+    return builder->CreateGEP(arrayType->getLLVMType(module), baseAddr.value(), {Int32Zero, index.value()});
+}
+
+void CodegenVisitor::visitBoundsCheck(WPLParser::ArrayAccessContext *ctx, Value *index, int length)
+{
+    if (!(flags & CompilerFlags::BOUNDS_CHECK) || isProvablyInBounds(ctx, length))
+        return;
+
+    visitBoundsCheck(ctx, index, ConstantInt::get(Int32Ty, length, true));
+}
+
+void CodegenVisitor::visitBoundsCheck(WPLParser::ArrayAccessContext *ctx, Value *index, Value *lengthVal)
+{
+    Function *parentFn = builder->GetInsertBlock()->getParent();
+
+    BasicBlock *inBoundsBlk = BasicBlock::Create(module->getContext(), "inbounds", parentFn);
+    BasicBlock *outOfBoundsBlk = BasicBlock::Create(module->getContext(), "outofbounds", parentFn);
+
+    // 64 bit indices are compared at their own width, so that indices that do not fit in an INT are caught rather than truncated
+    if (index->getType()->getIntegerBitWidth() > lengthVal->getType()->getIntegerBitWidth())
+        lengthVal = builder->CreateZExt(lengthVal, index->getType());
+
+    // An unsigned comparison also catches negative indices
+    Value *inBounds = builder->CreateICmpULT(index, lengthVal);
+
+    // The out of bounds path should essentially never be taken, so we mark it as such to keep it out of the way of the hot path
+    llvm::MDBuilder mdBuilder(module->getContext());
+    builder->CreateCondBr(inBounds, inBoundsBlk, outOfBoundsBlk, mdBuilder.createBranchWeights(1 << 20, 1));
+
+    builder->SetInsertPoint(outOfBoundsBlk);
+
+    // Attribute the failure to the access itself (rather than the statement it is in) when generating debug info
+    llvm::DebugLoc outerLoc = builder->getCurrentDebugLocation();
+    setDebugLocation(ctx);
+
+    if (flags & CompilerFlags::NO_RUNTIME)
+    {
+        // Without a runtime, there is no one to report the error, so just trap
+        builder->CreateCall(llvm::Intrinsic::getDeclaration(module, llvm::Intrinsic::trap));
+    }
+    else
+    {
+        FunctionCallee abortFn = module->getOrInsertFunction("_arrayIndexOutOfBounds", FunctionType::get(VoidTy, {Int32Ty, Int32Ty}, false));
+
+        if (Function *fn = llvm::dyn_cast<Function>(abortFn.getCallee()))
+        {
+            fn->addFnAttr(llvm::Attribute::NoReturn);
+            fn->addFnAttr(llvm::Attribute::Cold);
+        }
+
+        builder->CreateCall(abortFn, {index, lengthVal});
+    }
+
+    builder->CreateUnreachable();
+    builder->SetInsertPoint(inBoundsBlk);
+    builder->SetCurrentDebugLocation(outerLoc);
+}
+
+/**
+ * @brief Removes any parentheses surrounding an expression
+ *
+ * @param ctx The expression
+ * @return WPLParser::ExpressionContext* The expression within the parentheses
+ */
+static WPLParser::ExpressionContext *stripParens(WPLParser::ExpressionContext *ctx)
+{
+    while (WPLParser::ParenExprContext *paren = dynamic_cast<WPLParser::ParenExprContext *>(ctx))
+        ctx = paren->ex;
+
+    return ctx;
+}
+
+/**
+ * @brief Gets the value of an integer constant expression
+ *
+ * @param ctx The expression
+ * @return std::optional<int64_t> The value of the constant, or empty if the expression is not an integer constant
+ */
+static std::optional<int64_t> getIntConst(WPLParser::ExpressionContext *ctx)
+{
+    if (WPLParser::IConstExprContext *iConst = dynamic_cast<WPLParser::IConstExprContext *>(stripParens(ctx)))
+    {
+        // Constants too large to be an INT will not fit in an int64 either, so we can just not treat them as constants.
+        std::string text = iConst->i->getText();
+        if (text.length() > 10)
+            return {};
+
+        return std::stoll(text);
+    }
+
+    return {};
+}
+
+/**
+ * @brief Determines if a PROC returns immediately after a statement completes: either because the statement is followed
+ * by a return, or because it is the last statement along every path to the end of the PROC.
+ *
+ * @param ctx The statement
+ * @return true If nothing is executed between the statement and the PROC returning
+ * @return false Otherwise (including within loops and lambdas)
+ */
+static bool isTailStatement(antlr4::ParserRuleContext *ctx)
+{
+    while (ctx->parent)
+    {
+        if (WPLParser::BlockContext *block = dynamic_cast<WPLParser::BlockContext *>(ctx->parent))
+        {
+            auto it = std::find(block->stmts.begin(), block->stmts.end(), ctx);
+            if (it == block->stmts.end())
+                return false;
+
+            if (++it != block->stmts.end())
+            {
+                WPLParser::ReturnStatementContext *ret = dynamic_cast<WPLParser::ReturnStatementContext *>(*it);
+                return ret && !ret->expression();
+            }
+
+            if (WPLParser::FuncDefContext *def = dynamic_cast<WPLParser::FuncDefContext *>(block->parent))
+                return def->PROC();
+
+            // Once the block completes, control continues after the enclosing if/else or block statement
+            if (!dynamic_cast<WPLParser::ConditionalStatementContext *>(block->parent) && !dynamic_cast<WPLParser::BlockStatementContext *>(block->parent))
+                return false;
+
+            ctx = dynamic_cast<antlr4::ParserRuleContext *>(block->parent);
+        }
+        else if (dynamic_cast<WPLParser::SelectAlternativeContext *>(ctx->parent) || dynamic_cast<WPLParser::MatchAlternativeContext *>(ctx->parent))
+        {
+            // Once an alternative completes, control continues after the enclosing select/match
+            ctx = dynamic_cast<antlr4::ParserRuleContext *>(ctx->parent->parent);
+        }
+        else
+        {
+            return false;
+        }
+
+        if (!ctx)
+            return false;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Determines if a pointer may refer to the current function's stack allocations
+ *
+ * @param val The pointer
+ * @return true If the pointer is (or is derived from) an alloca
+ * @return false Otherwise
+ */
+static bool pointsToStack(Value *val)
+{
+    // Slices are built by inserting a pointer to their elements into a struct
+    while (llvm::InsertValueInst *insert = llvm::dyn_cast<llvm::InsertValueInst>(val))
+    {
+        if (pointsToStack(insert->getInsertedValueOperand()))
+            return true;
+
+        val = insert->getAggregateOperand();
+    }
+
+    val = val->stripPointerCasts();
+    while (llvm::GEPOperator *gep = llvm::dyn_cast<llvm::GEPOperator>(val))
+        val = gep->getPointerOperand()->stripPointerCasts();
+
+    return llvm::isa<llvm::AllocaInst>(val);
+}
+
+bool CodegenVisitor::visitSelfTailCall(WPLParser::InvocationContext *ctx)
+{
+    if (!selfTail || ctx->lam)
+        return false;
+
+    std::optional<Symbol *> symOpt = props->getBinding(ctx);
+    if (!symOpt)
+        return false;
+
+    /*
+     * Only calls which name the current PROC/FUNC itself are handled. A variable holding a function shares the exact type
+     * of whatever it was initialized with, but may since have been assigned a different function of the same type.
+     */
+    const TypeInvoke *inv = dynamic_cast<const TypeInvoke *>(symOpt.value()->type);
+    if (!inv || symOpt.value() != selfTail->definition || ctx->args.size() != selfTail->params.size())
+        return false;
+
+    /*
+     * Parameters passed by reference that are never mutated refer directly to the caller's storage, so we cannot assign
+     * to them. These can only be handled if the parameter is being passed along unchanged.
+     */
+    for (unsigned int i = 0; i < selfTail->params.size(); i++)
+    {
+        Symbol *param = selfTail->params.at(i);
+
+        // A slice must not refer to our own variables, as their lifetimes end before the jump
+        if (dynamic_cast<const TypeSlice *>(param->type))
+        {
+            WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(ctx->args.at(i));
+            std::optional<Symbol *> argOpt = access ? props->getBinding(access->fieldAccessExpr()->VARIABLE().at(0)) : std::nullopt;
+            if (!argOpt || access->fieldAccessExpr()->VARIABLE().size() != 1 || !dynamic_cast<const TypeSlice *>(argOpt.value()->type))
+                return false;
+        }
+
+        if (!param->val || llvm::isa<llvm::AllocaInst>(param->val.value()))
+            continue;
+
+        WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(ctx->args.at(i));
+        if (!access || access->fieldAccessExpr()->VARIABLE().size() != 1)
+            return false;
+
+        std::optional<Symbol *> argOpt = props->getBinding(access->fieldAccessExpr()->VARIABLE().at(0));
+        if (!argOpt || argOpt.value() != param)
+            return false;
+    }
+
+    std::optional<std::vector<Value *>> argsOpt = visitArguments(ctx, inv);
+    if (!argsOpt)
+        return true;
+
+    std::vector<Value *> args = argsOpt.value();
+
+    // Every argument is read before any parameter is assigned as the arguments may depend on the parameters
+    std::vector<Value *> vals;
+    for (unsigned int i = 0; i < args.size(); i++)
+    {
+        llvm::AllocaInst *alloc = llvm::dyn_cast_or_null<llvm::AllocaInst>(selfTail->params.at(i)->val.value_or(nullptr));
+        if (alloc && args.at(i)->getType() != alloc->getAllocatedType())
+            vals.push_back(builder->CreateLoad(alloc->getAllocatedType(), args.at(i)));
+        else
+            vals.push_back(args.at(i));
+    }
+
+    for (unsigned int i = 0; i < vals.size(); i++)
+    {
+        if (llvm::AllocaInst *alloc = llvm::dyn_cast_or_null<llvm::AllocaInst>(selfTail->params.at(i)->val.value_or(nullptr)))
+            builder->CreateStore(vals.at(i), alloc);
+    }
+
+    // As we are leaving every nested scope, their dynamic arrays are freed and their variables' lifetimes end here
+    freeAllArrays();
+
+    for (auto scope = scopedAllocs.rbegin(); scope != scopedAllocs.rend(); scope++)
+    {
+        for (auto it = scope->rbegin(); it != scope->rend(); it++)
+            builder->CreateLifetimeEnd(*it);
+    }
+
+    builder->CreateBr(selfTail->header);
+    return true;
+}
+
+bool CodegenVisitor::markTailCall(Value *val)
+{
+    llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(val);
+    BasicBlock *current = builder->GetInsertBlock();
+
+    if (!call || call->getParent() != current || &current->back() != call)
+        return false;
+
+    // The callee may not be given access to our frame, and an sret caller must still write the result into its argument
+    Function *fn = current->getParent();
+    if (fn->hasStructRetAttr())
+        return false;
+
+    for (Value *arg : call->args())
+    {
+        if (pointsToStack(arg))
+            return false;
+    }
+
+    bool guaranteed = call->getFunctionType() == fn->getFunctionType() && call->getCallingConv() == fn->getCallingConv();
+    call->setTailCallKind(guaranteed ? llvm::CallInst::TCK_MustTail : llvm::CallInst::TCK_Tail);
+    return guaranteed;
+}
+
+bool CodegenVisitor::isProvablyInBounds(WPLParser::ArrayAccessContext *ctx, int length)
+{
+    if (std::optional<int64_t> constIndex = getIntConst(ctx->index))
+        return constIndex.value() < length;
+
+    if (WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(stripParens(ctx->index)))
+    {
+        if (access->fieldAccessExpr()->fields.size() != 1)
+            return false;
+
+        std::optional<Symbol *> symOpt = props->getBinding(access->fieldAccessExpr()->VARIABLE().at(0));
+        if (!symOpt)
+            return false;
+
+        for (auto bound : loopIndexBounds)
+        {
+            if (bound.first == symOpt.value() && bound.second <= length)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+std::optional<std::pair<Symbol *, int64_t>> CodegenVisitor::getLoopIndexBound(WPLParser::LoopStatementContext *ctx)
+{
+    // Helper to get the symbol for an expression that is just a local INT variable
+    auto getLocalInt = [this](WPLParser::ExpressionContext *ex) -> std::optional<Symbol *>
+    {
+        WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(stripParens(ex));
+        if (!access || access->fieldAccessExpr()->fields.size() != 1)
+            return {};
+
+        std::optional<Symbol *> symOpt = props->getBinding(access->fieldAccessExpr()->VARIABLE().at(0));
+        if (!symOpt || symOpt.value()->isGlobal || symOpt.value()->type != Types::INT)
+            return {};
+
+        return symOpt;
+    };
+
+    /*
+     * The condition must be of the form i < n or i <= n
+     */
+    WPLParser::BinaryRelExprContext *cond = dynamic_cast<WPLParser::BinaryRelExprContext *>(stripParens(ctx->check->ex));
+    if (!cond || (cond->op->getType() != WPLParser::LESS && cond->op->getType() != WPLParser::LESS_EQ))
+        return {};
+
+    std::optional<Symbol *> symOpt = getLocalInt(cond->left);
+    if (!symOpt)
+        return {};
+
+    Symbol *sym = symOpt.value();
+
+    std::optional<int64_t> bound = getIntConst(cond->right);
+
+    if (!bound)
+    {
+        // Otherwise, the bound must be an array's length
+        WPLParser::FieldAccessContext *lenAccess = dynamic_cast<WPLParser::FieldAccessContext *>(stripParens(cond->right));
+        if (!lenAccess)
+            return {};
+
+        WPLParser::FieldAccessExprContext *lenExpr = lenAccess->fieldAccessExpr();
+        if (lenExpr->fields.size() < 2 || lenExpr->fields.at(lenExpr->fields.size() - 1)->getText() != "length")
+            return {};
+
+        std::optional<Symbol *> arrOpt = props->getBinding(lenExpr->VARIABLE().at(lenExpr->VARIABLE().size() - 2));
+        if (!arrOpt)
+            return {};
+
+        const TypeArray *arrayType = dynamic_cast<const TypeArray *>(arrOpt.value()->type);
+        if (!arrayType)
+            return {};
+
+        bound = arrayType->getLength();
+    }
+
+    // i <= n means that i < n + 1
+    if (cond->op->getType() == WPLParser::LESS_EQ)
+        bound = bound.value() + 1;
+
+    /*
+     * The statement immediately before the loop must set the variable to a non-negative constant
+     */
+    WPLParser::BlockContext *parentBlk = dynamic_cast<WPLParser::BlockContext *>(ctx->parent);
+    if (!parentBlk)
+        return {};
+
+    auto loopPos = std::find(parentBlk->stmts.begin(), parentBlk->stmts.end(), ctx);
+    if (loopPos == parentBlk->stmts.begin() || loopPos == parentBlk->stmts.end())
+        return {};
+
+    WPLParser::StatementContext *prev = *(loopPos - 1);
+    bool initialized = false;
+
+    if (WPLParser::VarDeclStatementContext *decl = dynamic_cast<WPLParser::VarDeclStatementContext *>(prev))
+    {
+        for (auto a : decl->assignments)
+        {
+            for (auto var : a->VARIABLE())
+            {
+                std::optional<Symbol *> varSym = props->getBinding(var);
+                if (varSym && varSym.value() == sym && a->ex && getIntConst(a->ex))
+                    initialized = true;
+            }
+        }
+    }
+    else if (WPLParser::AssignStatementContext *assign = dynamic_cast<WPLParser::AssignStatementContext *>(prev))
+    {
+        std::optional<Symbol *> varSym = props->getBinding(assign->to);
+        initialized = assign->to->VARIABLE() && varSym && varSym.value() == sym && getIntConst(assign->ex);
+    }
+
+    if (!initialized)
+        return {};
+
+    /*
+     * Within the body, the variable may only be assigned by the final statement, which must be of the form i <- i + c
+     */
+    std::vector<WPLParser::StatementContext *> stmts = ctx->block()->stmts;
+
+    std::function<bool(antlr4::tree::ParseTree *)> assignsSym = [&](antlr4::tree::ParseTree *tree) -> bool
+    {
+        if (WPLParser::AssignStatementContext *assign = dynamic_cast<WPLParser::AssignStatementContext *>(tree))
+        {
+            std::optional<Symbol *> varSym = props->getBinding(assign->to);
+            if (assign->to->VARIABLE() && varSym && varSym.value() == sym)
+                return true;
+        }
+
+        for (auto child : tree->children)
+        {
+            if (assignsSym(child))
+                return true;
+        }
+
+        return false;
+    };
+
+    for (unsigned int i = 0; i < stmts.size(); i++)
+    {
+        if (!assignsSym(stmts.at(i)))
+            continue;
+
+        if (i + 1 != stmts.size())
+            return {};
+
+        WPLParser::AssignStatementContext *step = dynamic_cast<WPLParser::AssignStatementContext *>(stmts.at(i));
+        if (!step)
+            return {};
+
+        WPLParser::BinaryArithExprContext *sum = dynamic_cast<WPLParser::BinaryArithExprContext *>(stripParens(step->ex));
+        if (!sum || sum->op->getType() != WPLParser::PLUS)
+            return {};
+
+        std::optional<Symbol *> leftSym = getLocalInt(sum->left);
+        std::optional<Symbol *> rightSym = getLocalInt(sum->right);
+        std::optional<int64_t> increment = (leftSym && leftSym.value() == sym) ? getIntConst(sum->right)
+                                         : (rightSym && rightSym.value() == sym) ? getIntConst(sum->left)
+                                                                                 : std::nullopt;
+
+        // Ensure the increment cannot overflow past the bound (thereby wrapping around to a negative value)
+        if (!increment || bound.value() + increment.value() > INT32_MAX)
+            return {};
+    }
+
+    return std::make_pair(sym, bound.value());
+}
+
+std::optional<Value *> CodegenVisitor::visitConstant(antlr4::tree::ParseTree *ctx)
+{
+    std::optional<ConstValue> valOpt = props->getConstant(ctx);
+
+    if (!valOpt)
+        return {};
+
+    if (std::holds_alternative<bool>(valOpt.value()))
+    {
+        Value *val = std::get<bool>(valOpt.value()) ? builder->getTrue() : builder->getFalse();
+        return val;
+    }
+
+    // Integer constants are generated with the type they were found to have (ie, INT64 for 3000000000 + 1)
+    const TypeInt *ty = props->getConstantType(ctx).value_or(static_cast<const TypeInt *>(Types::INT));
+    Value *val = ConstantInt::get(ty->getLLVMType(module), std::get<int64_t>(valOpt.value()), true);
+    return val;
+}
+
+std::optional<Value *> CodegenVisitor::TvisitArrayAccess(WPLParser::ArrayAccessContext *ctx)
+{
+    // Read the element directly from the array's storage when possible (slices and dynamic arrays can only be read this way)
+    std::optional<Symbol *> arraySym = props->getBinding(ctx->field->VARIABLE().at(ctx->field->VARIABLE().size() - 1));
+    bool inPlaceOnly = arraySym && (dynamic_cast<const TypeSlice *>(arraySym.value()->type) || dynamic_cast<const TypeDynArray *>(arraySym.value()->type));
+
+    if (std::optional<Value *> elementPtr = visitArrayAccessAddr(ctx))
+    {
+        const Type *valueType = Types::getArrayValueType(arraySym.value()->type);
+        Value *val = builder->CreateLoad(valueType->getLLVMType(module), elementPtr.value());
+        return val;
+    }
+
+    if (inPlaceOnly)
+        return {};
+
+    // Otherwise, the array has no storage of its own, so copy its value to the stack and index into that
+    // Attempt to get the index Value
+    std::optional<Value *> index = any2Value(ctx->index->accept(this));
+
+    if (!index)
+    {
+        errorHandler.addCodegenError(ctx, "Failed to generate code in TvisitArrayAccess for index!");
+        return {};
+    }
+
+    std::optional<Value *> arrayPtr = any2Value(ctx->field->accept(this));
+    if (!arrayPtr)
+    {
+        errorHandler.addCodegenError(ctx, "Failed to locate array in access");
+        return {};
+    }
+
+    Value *baseValue = arrayPtr.value();
+
+    if (llvm::ArrayType *arrayTy = llvm::dyn_cast<llvm::ArrayType>(baseValue->getType()))
+        visitBoundsCheck(ctx, index.value(), arrayTy->getNumElements());
+
+    llvm::AllocaInst *v = CreateEntryBlockAlloc(baseValue->getType());
+    builder->CreateStore(baseValue, v);
+
+    auto ptr = builder->CreateGEP(v, {Int32Zero, index.value()});
+    Value *val = builder->CreateLoad(ptr->getType()->getPointerElementType(), ptr);
     return val;
 }
 
 std::optional<Value *> CodegenVisitor::TvisitIConstExpr(WPLParser::IConstExprContext *ctx)
 {
-    int i = std::stoi(ctx->i->getText());
+    // Semantic analysis gives literals which do not fit in an INT the type INT64
+    std::string text = ctx->i->getText();
+    if (text.length() > 10 || std::stoll(text) > INT32_MAX)
+        return builder->getInt64(std::stoll(text));
+
+    int i = std::stoi(text);
     Value *v = builder->getInt32(i);
     return v;
 }
 
-std::optional<Value *> CodegenVisitor::TvisitArrayAccessExpr(WPLParser::ArrayAccessExprContext *ctx)
+std::optional<Value *> CodegenVisitor::TvisitIntCastExpr(WPLParser::IntCastExprContext *ctx)
 {
-    return this->TvisitArrayAccess(ctx->arrayAccess());
+    // The conversion itself is recorded on (and so performed when visiting) the inner expression
+    return any2Value(ctx->ex->accept(this));
 }
 
-std::optional<Value *> CodegenVisitor::TvisitSConstExpr(WPLParser::SConstExprContext *ctx)
+std::optional<Value *> CodegenVisitor::visitIntConversion(WPLParser::ExpressionContext *ctx, std::optional<Value *> val)
 {
-    // TODO: do this better, ensure that we can only escape these chars...
-    std::string full(ctx->s->getText());
-    std::string actual = full.substr(1, full.length() - 2);
+    std::optional<std::pair<const TypeInt *, const TypeInt *>> conversion = props->getIntConversion(ctx);
+
+    if (!val || !conversion)
+        return val;
+
+    const TypeInt *from = conversion.value().first;
+    const TypeInt *to = conversion.value().second;
+    llvm::Type *toTy = to->getLLVMType(module);
 
-    std::vector<std::pair<std::regex, std::string>> replacements;
+    // Integers of the same size only differ in how their bits are interpreted
+    if (from->getBits() == to->getBits())
+        return val;
+
+    // Constants are converted directly so that they remain constants (ie, for use as a global's initializer)
+    if (llvm::Constant *constant = llvm::dyn_cast<llvm::Constant>(val.value()))
+        return llvm::ConstantExpr::getIntegerCast(constant, toTy, from->getIsSigned());
+
+    if (from->getBits() > to->getBits())
+        return builder->CreateTrunc(val.value(), toTy);
+
+    return from->getIsSigned() ? builder->CreateSExt(val.value(), toTy) : builder->CreateZExt(val.value(), toTy);
+}
 
-    // Reference of all escape characters: https://en.cppreference.com/w/cpp/language/escape
-    std::regex SQ("\\\\'");
-    std::regex DQ("\\\\\"");
-    std::regex QM("\\\\\\?");
-    std::regex SL("\\\\\\\\");
-    std::regex AB("\\\\a");
-    std::regex BS("\\\\b");
-    std::regex FF("\\\\f");
-    std::regex NL("\\\\n");
-    std::regex CR("\\\\r");
-    std::regex HT("\\\\t");
-    std::regex VT("\\\\v");
+std::optional<Value *> CodegenVisitor::TvisitArrayAccessExpr(WPLParser::ArrayAccessExprContext *ctx)
+{
+    return this->TvisitArrayAccess(ctx->arrayAccess());
+}
 
-    replacements.push_back({SQ, "\'"});
-    replacements.push_back({DQ, "\""});
-    replacements.push_back({QM, "\?"});
-    replacements.push_back({AB, "\a"});
-    replacements.push_back({BS, "\b"});
-    replacements.push_back({FF, "\f"});
-    replacements.push_back({NL, "\n"});
-    replacements.push_back({CR, "\r"});
-    replacements.push_back({HT, "\t"});
-    replacements.push_back({VT, "\v"});
-    replacements.push_back({SL, "\\"});
+std::optional<Value *> CodegenVisitor::TvisitSConstExpr(WPLParser::SConstExprContext *ctx)
+{
+    // The escape sequences were already decoded during semantic analysis
+    std::optional<std::string> strOpt = props->getString(ctx);
+    if (!strOpt)
+    {
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to find contents of string literal: " + ctx->getText(); });
+        return {};
+    }
 
-    std::string out = actual;
+    std::string out = strOpt.value();
 
-    for (auto e : replacements)
+    // Identical literals can share the same global as they are never written to
+    if (flags & CompilerFlags::STRING_POOL)
     {
-        out = regex_replace(out, e.first, e.second);
+        auto pooled = stringPool.find(out);
+        if (pooled != stringPool.end())
+            return pooled->second;
     }
 
     // Create a constant to represent our string (now with the escape characters corrected)
@@ -483,16 +1573,26 @@ std::optional<Value *> CodegenVisitor::TvisitSConstExpr(WPLParser::SConstExprCon
     // Here, we can deal with the pointer later (just as if it were a normal variable)
     llvm::Constant *Indices[] = {Int32Zero, Int32Zero};
 
-    Value *val = llvm::ConstantExpr::getInBoundsGetElementPtr(
+    llvm::Constant *val = llvm::ConstantExpr::getInBoundsGetElementPtr(
         glob->getValueType(),
         glob,
         Indices);
 
+    if (flags & CompilerFlags::STRING_POOL)
+        stringPool.insert({out, val});
+
     return val;
 }
 
-std::optional<Value *> CodegenVisitor::TvisitUnaryExpr(WPLParser::UnaryExprContext *ctx)
-{
+std::optional<Value *> CodegenVisitor::TvisitUnaryExpr(WPLParser::UnaryExprContext *ctx)
+{
+    // Constant expressions can be generated directly when folding
+    if (flags & CompilerFlags::CONST_FOLD)
+    {
+        if (std::optional<Value *> constVal = visitConstant(ctx))
+            return constVal;
+    }
+
     switch (ctx->op->getType())
     {
     case WPLParser::MINUS:
@@ -501,11 +1601,13 @@ std::optional<Value *> CodegenVisitor::TvisitUnaryExpr(WPLParser::UnaryExprConte
 
         if (!innerVal)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
             return {};
         }
 
-        Value *v = builder->CreateNSWSub(builder->getInt32(0), innerVal.value());
+        // Unsigned negation wraps around, so it cannot be marked as having no signed overflow
+        Value *zero = ConstantInt::get(innerVal.value()->getType(), 0);
+        Value *v = hasUnsignedOperands(ctx) ? builder->CreateSub(zero, innerVal.value()) : builder->CreateNSWSub(zero, innerVal.value());
         return v;
     }
 
@@ -515,7 +1617,7 @@ std::optional<Value *> CodegenVisitor::TvisitUnaryExpr(WPLParser::UnaryExprConte
 
         if (!v)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
             return {};
         }
 
@@ -524,21 +1626,44 @@ std::optional<Value *> CodegenVisitor::TvisitUnaryExpr(WPLParser::UnaryExprConte
     }
     }
 
-    errorHandler.addCodegenError(ctx->getStart(), "Unknown unary operator: " + ctx->op->getText());
+    errorHandler.addCodegenError(ctx, [=]() { return "Unknown unary operator: " + ctx->op->getText(); });
     return {};
 }
 
 std::optional<Value *> CodegenVisitor::TvisitBinaryArithExpr(WPLParser::BinaryArithExprContext *ctx)
 {
+    // Constant expressions can be generated directly when folding
+    if (flags & CompilerFlags::CONST_FOLD)
+    {
+        if (std::optional<Value *> constVal = visitConstant(ctx))
+            return constVal;
+    }
+
     std::optional<Value *> lhs = any2Value(ctx->left->accept(this));
     std::optional<Value *> rhs = any2Value(ctx->right->accept(this));
 
     if (!lhs || !rhs)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
         return {};
     }
 
+    // Unsigned arithmetic wraps around
+    if (hasUnsignedOperands(ctx))
+    {
+        switch (ctx->op->getType())
+        {
+        case WPLParser::PLUS:
+            return builder->CreateAdd(lhs.value(), rhs.value());
+        case WPLParser::MINUS:
+            return builder->CreateSub(lhs.value(), rhs.value());
+        case WPLParser::MULTIPLY:
+            return builder->CreateMul(lhs.value(), rhs.value());
+        case WPLParser::DIVIDE:
+            return builder->CreateUDiv(lhs.value(), rhs.value());
+        }
+    }
+
     switch (ctx->op->getType())
     {
     case WPLParser::PLUS:
@@ -551,18 +1676,25 @@ std::optional<Value *> CodegenVisitor::TvisitBinaryArithExpr(WPLParser::BinaryAr
         return builder->CreateSDiv(lhs.value(), rhs.value());
     }
 
-    errorHandler.addCodegenError(ctx->getStart(), "Unknown arith op: " + ctx->op->getText());
+    errorHandler.addCodegenError(ctx, [=]() { return "Unknown arith op: " + ctx->op->getText(); });
     return {};
 }
 
 std::optional<Value *> CodegenVisitor::TvisitEqExpr(WPLParser::EqExprContext *ctx)
 {
+    // Constant expressions can be generated directly when folding
+    if (flags & CompilerFlags::CONST_FOLD)
+    {
+        if (std::optional<Value *> constVal = visitConstant(ctx))
+            return constVal;
+    }
+
     std::optional<Value *> lhs = any2Value(ctx->left->accept(this));
     std::optional<Value *> rhs = any2Value(ctx->right->accept(this));
 
     if (!lhs || !rhs)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
         return {};
     }
 
@@ -583,7 +1715,7 @@ std::optional<Value *> CodegenVisitor::TvisitEqExpr(WPLParser::EqExprContext *ct
     }
     }
 
-    errorHandler.addCodegenError(ctx->getStart(), "Unknown equality operator: " + ctx->op->getText());
+    errorHandler.addCodegenError(ctx, [=]() { return "Unknown equality operator: " + ctx->op->getText(); });
     return {};
 }
 
@@ -597,6 +1729,13 @@ std::optional<Value *> CodegenVisitor::TvisitEqExpr(WPLParser::EqExprContext *ct
  */
 std::optional<Value *> CodegenVisitor::TvisitLogAndExpr(WPLParser::LogAndExprContext *ctx)
 {
+    // Constant expressions can be generated directly when folding
+    if (flags & CompilerFlags::CONST_FOLD)
+    {
+        if (std::optional<Value *> constVal = visitConstant(ctx))
+            return constVal;
+    }
+
     // TODO: DO BETTER W/ AST
     std::vector<WPLParser::ExpressionContext *> toVisit = ctx->exprs;
     std::vector<WPLParser::ExpressionContext *> toGen;
@@ -632,20 +1771,41 @@ std::optional<Value *> CodegenVisitor::TvisitLogAndExpr(WPLParser::LogAndExprCon
 
     if (!first)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + toGen.at(0)->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + toGen.at(0)->getText(); });
         return {};
     }
 
     Value *lastValue = first.value();
 
     auto parent = current->getParent();
-    phi->addIncoming(lastValue, current);
 
     BasicBlock *falseBlk;
+    bool branched = false;
 
     // Branch on the lhs value
     for (unsigned int i = 1; i < toGen.size(); i++)
     {
+        /*
+         * Operands which are cheap and have no side effects are cheaper to evaluate
+         * unconditionally than to branch around, so combine them with the previous value
+         */
+        if ((flags & CompilerFlags::BRANCHLESS_LOGIC) && props->isSpeculatable(toGen.at(i)))
+        {
+            std::optional<Value *> rhs = any2Value(toGen.at(i)->accept(this));
+
+            if (!rhs)
+            {
+                errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + toGen.at(i)->getText(); });
+                return {};
+            }
+
+            lastValue = builder->CreateAnd(lastValue, rhs.value());
+            continue;
+        }
+
+        phi->addIncoming(lastValue, builder->GetInsertBlock());
+        branched = true;
+
         falseBlk = BasicBlock::Create(module->getContext(), "prevTrueAnd", parent);
         builder->CreateCondBr(lastValue, falseBlk, mergeBlk);
 
@@ -658,16 +1818,22 @@ std::optional<Value *> CodegenVisitor::TvisitLogAndExpr(WPLParser::LogAndExprCon
 
         if (!rhs)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + toGen.at(i)->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + toGen.at(i)->getText(); });
             return {};
         }
         lastValue = rhs.value();
 
-        falseBlk = builder->GetInsertBlock();
-        parent = falseBlk->getParent();
-        phi->addIncoming(lastValue, falseBlk);
+        parent = builder->GetInsertBlock()->getParent();
+    }
+
+    // Nothing was short-circuited, so there is nothing to merge
+    if (!branched)
+    {
+        delete mergeBlk;
+        return lastValue;
     }
 
+    phi->addIncoming(lastValue, builder->GetInsertBlock());
     builder->CreateBr(mergeBlk);
     // falseBlk = builder->GetInsertBlock();
 
@@ -691,6 +1857,13 @@ std::optional<Value *> CodegenVisitor::TvisitLogAndExpr(WPLParser::LogAndExprCon
  */
 std::optional<Value *> CodegenVisitor::TvisitLogOrExpr(WPLParser::LogOrExprContext *ctx)
 {
+    // Constant expressions can be generated directly when folding
+    if (flags & CompilerFlags::CONST_FOLD)
+    {
+        if (std::optional<Value *> constVal = visitConstant(ctx))
+            return constVal;
+    }
+
     // TODO: DO BETTER W/ AST
     std::vector<WPLParser::ExpressionContext *> toVisit = ctx->exprs;
     std::vector<WPLParser::ExpressionContext *> toGen;
@@ -726,20 +1899,41 @@ std::optional<Value *> CodegenVisitor::TvisitLogOrExpr(WPLParser::LogOrExprConte
 
     if (!first)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + toGen.at(0)->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + toGen.at(0)->getText(); });
         return {};
     }
 
     Value *lastValue = first.value();
 
     auto parent = current->getParent();
-    phi->addIncoming(lastValue, current);
 
     BasicBlock *falseBlk;
+    bool branched = false;
 
     // Branch on the lhs value
     for (unsigned int i = 1; i < toGen.size(); i++)
     {
+        /*
+         * Operands which are cheap and have no side effects are cheaper to evaluate
+         * unconditionally than to branch around, so combine them with the previous value
+         */
+        if ((flags & CompilerFlags::BRANCHLESS_LOGIC) && props->isSpeculatable(toGen.at(i)))
+        {
+            std::optional<Value *> rhs = any2Value(toGen.at(i)->accept(this));
+
+            if (!rhs)
+            {
+                errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + toGen.at(i)->getText(); });
+                return {};
+            }
+
+            lastValue = builder->CreateOr(lastValue, rhs.value());
+            continue;
+        }
+
+        phi->addIncoming(lastValue, builder->GetInsertBlock());
+        branched = true;
+
         falseBlk = BasicBlock::Create(module->getContext(), "prevFalseOr", parent);
         builder->CreateCondBr(lastValue, mergeBlk, falseBlk);
 
@@ -752,16 +1946,22 @@ std::optional<Value *> CodegenVisitor::TvisitLogOrExpr(WPLParser::LogOrExprConte
 
         if (!rhs)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + toGen.at(i)->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + toGen.at(i)->getText(); });
             return {};
         }
         lastValue = rhs.value();
 
-        falseBlk = builder->GetInsertBlock();
-        parent = falseBlk->getParent();
-        phi->addIncoming(lastValue, falseBlk);
+        parent = builder->GetInsertBlock()->getParent();
     }
 
+    // Nothing was short-circuited, so there is nothing to merge
+    if (!branched)
+    {
+        delete mergeBlk;
+        return lastValue;
+    }
+
+    phi->addIncoming(lastValue, builder->GetInsertBlock());
     builder->CreateBr(mergeBlk);
 
     /*
@@ -786,7 +1986,7 @@ std::optional<Value *> CodegenVisitor::TvisitFieldAccessExpr(WPLParser::FieldAcc
 
     if (!symOpt)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Unbound symbol in field access: " + ctx->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Unbound symbol in field access: " + ctx->getText(); });
         return {};
     }
 
@@ -794,7 +1994,7 @@ std::optional<Value *> CodegenVisitor::TvisitFieldAccessExpr(WPLParser::FieldAcc
 
     if (!sym->type)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Improperly initialized symbol in field access: " + ctx->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Improperly initialized symbol in field access: " + ctx->getText(); });
         return {};
     }
 
@@ -812,6 +2012,42 @@ std::optional<Value *> CodegenVisitor::TvisitFieldAccessExpr(WPLParser::FieldAcc
 
                 return v;
             }
+
+            // Dynamic arrays keep their current length alongside their elements
+            if (const TypeDynArray *dyn = dynamic_cast<const TypeDynArray *>(modOpt.value()->type))
+            {
+                if (!modOpt.value()->val)
+                    return {};
+
+                Value *v = builder->CreateLoad(Int32Ty, builder->CreateStructGEP(dyn->getLLVMType(module), modOpt.value()->val.value(), 1));
+                return v;
+            }
+
+            // Slices (which can only be parameters) carry their length with them
+            if (dynamic_cast<const TypeSlice *>(modOpt.value()->type))
+            {
+                std::optional<Value *> sliceVal = visitVariable(ctx->VARIABLE().at(0)->getText(), modOpt, ctx);
+                if (!sliceVal)
+                    return {};
+
+                Value *v = builder->CreateExtractValue(sliceVal.value(), 1);
+                return v;
+            }
+        }
+    }
+
+    // Read struct fields directly from the root variable's storage when possible
+    if (ctx->fields.size() > 1)
+    {
+        std::optional<Symbol *> fieldOpt = props->getBinding(ctx->VARIABLE().at(ctx->VARIABLE().size() - 1));
+
+        if (fieldOpt)
+        {
+            if (std::optional<Value *> fieldPtr = visitFieldAccessAddr(ctx))
+            {
+                Value *val = builder->CreateLoad(fieldOpt.value()->type->getLLVMType(module), fieldPtr.value());
+                return val;
+            }
         }
     }
 
@@ -825,16 +2061,16 @@ std::optional<Value *> CodegenVisitor::TvisitFieldAccessExpr(WPLParser::FieldAcc
         {
             if (!baseOpt)
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Failed to generate field access partial: " + ctx->fields.at(i - 1)->getText());
+                errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate field access partial: " + ctx->fields.at(i - 1)->getText(); });
                 return {};
             }
 
             std::string field = ctx->fields.at(i)->getText();
-            std::optional<unsigned int> indexOpt = s->getIndex(field);
+            std::optional<unsigned int> indexOpt = props->getFieldIndex(ctx->VARIABLE().at(i));
 
             if (!indexOpt)
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Could not lookup " + field);
+                errorHandler.addCodegenError(ctx, "Could not lookup " + field);
                 return {};
             }
 
@@ -844,14 +2080,14 @@ std::optional<Value *> CodegenVisitor::TvisitFieldAccessExpr(WPLParser::FieldAcc
 
             if (!fieldOpt)
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Could not get binding for " + field);
+                errorHandler.addCodegenError(ctx, "Could not get binding for " + field);
                 return {};
             }
 
             Value *baseValue = baseOpt.value();
 
             Symbol *fieldSym = fieldOpt.value();
-            llvm::AllocaInst *v = builder->CreateAlloca(baseValue->getType());
+            llvm::AllocaInst *v = CreateEntryBlockAlloc(baseValue->getType());
             builder->CreateStore(baseValue, v);
             Value *valPtr = builder->CreateGEP(v, {Int32Zero, ConstantInt::get(Int32Ty, index, true)});
 
@@ -865,7 +2101,7 @@ std::optional<Value *> CodegenVisitor::TvisitFieldAccessExpr(WPLParser::FieldAcc
 
     if (!baseOpt)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate field access: " + ctx->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate field access: " + ctx->getText(); });
         return {};
     }
 
@@ -879,6 +2115,13 @@ std::optional<Value *> CodegenVisitor::TvisitParenExpr(WPLParser::ParenExprConte
 
 std::optional<Value *> CodegenVisitor::TvisitBinaryRelExpr(WPLParser::BinaryRelExprContext *ctx)
 {
+    // Constant expressions can be generated directly when folding
+    if (flags & CompilerFlags::CONST_FOLD)
+    {
+        if (std::optional<Value *> constVal = visitConstant(ctx))
+            return constVal;
+    }
+
     // Generate code for LHS and RHS
     std::optional<Value *> lhs = any2Value(ctx->left->accept(this));
     std::optional<Value *> rhs = any2Value(ctx->right->accept(this));
@@ -886,29 +2129,30 @@ std::optional<Value *> CodegenVisitor::TvisitBinaryRelExpr(WPLParser::BinaryRelE
     // Ensure we successfully generated LHS and RHS
     if (!lhs || !rhs)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
         return {};
     }
 
     Value *v1;
+    bool isUnsigned = hasUnsignedOperands(ctx);
 
     switch (ctx->op->getType())
     {
     case WPLParser::LESS:
-        v1 = builder->CreateICmpSLT(lhs.value(), rhs.value());
+        v1 = isUnsigned ? builder->CreateICmpULT(lhs.value(), rhs.value()) : builder->CreateICmpSLT(lhs.value(), rhs.value());
         break;
     case WPLParser::LESS_EQ:
-        v1 = builder->CreateICmpSLE(lhs.value(), rhs.value());
+        v1 = isUnsigned ? builder->CreateICmpULE(lhs.value(), rhs.value()) : builder->CreateICmpSLE(lhs.value(), rhs.value());
         break;
     case WPLParser::GREATER:
-        v1 = builder->CreateICmpSGT(lhs.value(), rhs.value());
+        v1 = isUnsigned ? builder->CreateICmpUGT(lhs.value(), rhs.value()) : builder->CreateICmpSGT(lhs.value(), rhs.value());
         break;
     case WPLParser::GREATER_EQ:
-        v1 = builder->CreateICmpSGE(lhs.value(), rhs.value());
+        v1 = isUnsigned ? builder->CreateICmpUGE(lhs.value(), rhs.value()) : builder->CreateICmpSGE(lhs.value(), rhs.value());
         break;
 
     default:
-        errorHandler.addCodegenError(ctx->getStart(), "Unknown rel operator: " + ctx->op->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Unknown rel operator: " + ctx->op->getText(); });
         return {};
     }
 
@@ -925,13 +2169,32 @@ std::optional<Value *> CodegenVisitor::TvisitCondition(WPLParser::ConditionConte
     return any2Value(ctx->ex->accept(this));
 }
 
+void CodegenVisitor::declareImports(std::vector<Symbol *> imports)
+{
+    for (Symbol *symbol : imports)
+    {
+        // Imported FUNC/PROCs are declared just like externs
+        if (const TypeInvoke *type = dynamic_cast<const TypeInvoke *>(symbol->type))
+        {
+            llvm::FunctionType *fnType = static_cast<llvm::FunctionType *>(type->getLLVMType(module)->getPointerElementType());
+            Function *fn = Function::Create(fnType, GlobalValue::ExternalLinkage, symbol->identifier, module);
+            type->setName(fn->getName().str());
+        }
+        // Imported globals are declared without an initializer as they are defined in the other module
+        else if (symbol->isGlobal && !symbol->isDefinition)
+        {
+            new llvm::GlobalVariable(*module, symbol->type->getLLVMType(module), false, GlobalValue::ExternalLinkage, nullptr, symbol->identifier);
+        }
+    }
+}
+
 std::optional<Value *> CodegenVisitor::TvisitExternStatement(WPLParser::ExternStatementContext *ctx)
 {
     std::optional<Symbol *> optSym = props->getBinding(ctx);
 
     if (!optSym)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Incorrectly bound symbol in extern statement. Probably a compiler error.");
+        errorHandler.addCodegenError(ctx, "Incorrectly bound symbol in extern statement. Probably a compiler error.");
         return {};
     }
 
@@ -939,7 +2202,7 @@ std::optional<Value *> CodegenVisitor::TvisitExternStatement(WPLParser::ExternSt
 
     if (!symbol->type)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Type for extern statement not correctly bound! Probably a compiler errror.");
+        errorHandler.addCodegenError(ctx, "Type for extern statement not correctly bound! Probably a compiler errror.");
         return {};
     }
 
@@ -953,16 +2216,17 @@ std::optional<Value *> CodegenVisitor::TvisitExternStatement(WPLParser::ExternSt
         {
             Function *fn = Function::Create(fnType, GlobalValue::ExternalLinkage, ctx->name->getText(), module);
             type->setName(fn->getName().str());
+            addEffectAttributes(fn, type, ctx);
         }
         else
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Could not treat extern type as function.");
+            errorHandler.addCodegenError(ctx, "Could not treat extern type as function.");
             return {};
         }
     }
     else
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Extern statement bound to: " + generalType->toString() + ". Requires Invokable!");
+        errorHandler.addCodegenError(ctx, "Extern statement bound to: " + generalType->toString() + ". Requires Invokable!");
     }
 
     return {};
@@ -981,7 +2245,7 @@ std::optional<Value *> CodegenVisitor::TvisitAssignStatement(WPLParser::AssignSt
     // Check that the expression generated
     if (!exprVal)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->ex->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->ex->getText(); });
         return {};
     }
 
@@ -989,7 +2253,7 @@ std::optional<Value *> CodegenVisitor::TvisitAssignStatement(WPLParser::AssignSt
     std::optional<Symbol *> varSymOpt = props->getBinding(ctx->to);
     if (!varSymOpt)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Incorrectly processed variable in assignment: " + ctx->to->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Incorrectly processed variable in assignment: " + ctx->to->getText(); });
         return {};
     }
 
@@ -998,8 +2262,11 @@ std::optional<Value *> CodegenVisitor::TvisitAssignStatement(WPLParser::AssignSt
     // Get the allocation instruction for the symbol
     std::optional<Value *> val = varSym->val;
 
+    // Array elements are addressed through the array's own storage (which may be a struct field) instead of through the symbol
+    bool addressElement = !ctx->to->VARIABLE();
+
     // If the symbol is global
-    if (varSym->isGlobal)
+    if (varSym->isGlobal && !addressElement)
     {
         // Find the global variable that corresponds to our symbol
         llvm::GlobalVariable *glob = module->getNamedGlobal(varSym->identifier);
@@ -1007,37 +2274,33 @@ std::optional<Value *> CodegenVisitor::TvisitAssignStatement(WPLParser::AssignSt
         // If we can't find it, then throw an error.
         if (!glob)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Unable to find global variable: " + varSym->identifier);
+            errorHandler.addCodegenError(ctx, "Unable to find global variable: " + varSym->identifier);
             return {};
         }
 
-        // Load a pointer to the global variable
-        val = builder->CreateLoad(glob)->getPointerOperand();
+        // The global itself is a pointer to its storage
+        val = glob;
     }
 
     // Sanity check to ensure that we now have a value for the variable
-    if (!val)
+    if (!val && !addressElement)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Improperly initialized variable in assignment: " + ctx->to->getText() + "@" + varSym->identifier);
+        errorHandler.addCodegenError(ctx, [=]() { return "Improperly initialized variable in assignment: " + ctx->to->getText() + "@" + varSym->identifier; });
         return {};
     }
 
     // Checks to see if we are dealing with an array
-    if (!ctx->to->VARIABLE())
+    if (addressElement)
     {
-        // As this is an array access, we need to determine the index we will be accessing
-        std::optional<Value *> index = any2Value(ctx->to->array->index->accept(this));
+        std::optional<Value *> elementPtr = visitArrayAccessAddr(ctx->to->array);
 
-        // Ensure we built an index
-        if (!index)
+        if (!elementPtr)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->to->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->to->getText(); });
             return {};
         }
 
-        // Create a GEP to the index based on our previously calculated value and index
-        Value *built = builder->CreateGEP(val.value(), {Int32Zero, index.value()});
-        val = built;
+        val = elementPtr;
     }
 
     // Store the expression's value
@@ -1057,7 +2320,7 @@ std::optional<Value *> CodegenVisitor::TvisitAssignStatement(WPLParser::AssignSt
 
         Value *tagPtr = builder->CreateGEP(v, {Int32Zero, Int32Zero});
 
-        builder->CreateStore(ConstantInt::get(Int32Ty, index, true), tagPtr);
+        builder->CreateStore(ConstantInt::get(sum->getTagType(module), index, true), tagPtr);
         Value *valuePtr = builder->CreateGEP(v, {Int32Zero, Int32One});
 
         Value *corrected = builder->CreateBitCast(valuePtr, stoVal->getType()->getPointerTo());
@@ -1081,8 +2344,16 @@ std::optional<Value *> CodegenVisitor::TvisitVarDeclStatement(WPLParser::VarDecl
 
         std::optional<Value *> exVal = std::nullopt;
 
+        // Global variables must be initialized to constants, so use the value found by semantic analysis rather than generating instructions for it
+        std::optional<Symbol *> firstSym = e->VARIABLE().size() ? props->getBinding(e->VARIABLE().at(0)) : std::nullopt;
+        bool isGlobal = firstSym && firstSym.value()->isGlobal;
+
         // If the declaration has a value, attempt to generate that value
-        if (e->ex)
+        if (e->ex && isGlobal && props->getConstant(e->ex))
+        {
+            exVal = visitIntConversion(e->ex, visitConstant(e->ex));
+        }
+        else if (e->ex)
         {
             std::any anyVal = e->ex->accept(this);
 
@@ -1092,14 +2363,14 @@ std::optional<Value *> CodegenVisitor::TvisitVarDeclStatement(WPLParser::VarDecl
             }
             else
             {
-                errorHandler.addCodegenError(e->ex->getStart(), "Could not generate code for: " + e->ex->getText());
+                errorHandler.addCodegenError(e->ex, [=]() { return "Could not generate code for: " + e->ex->getText(); });
                 return {};
             }
         }
 
         if ((e->ex) && !exVal)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + e->ex->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + e->ex->getText(); });
             return {};
         }
 
@@ -1112,7 +2383,7 @@ std::optional<Value *> CodegenVisitor::TvisitVarDeclStatement(WPLParser::VarDecl
 
             if (!varSymbolOpt)
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Issue creating variable: " + var->getText());
+                errorHandler.addCodegenError(ctx, [=]() { return "Issue creating variable: " + var->getText(); });
                 return {};
             }
 
@@ -1134,18 +2405,24 @@ std::optional<Value *> CodegenVisitor::TvisitVarDeclStatement(WPLParser::VarDecl
                 glob->setLinkage(GlobalValue::ExternalLinkage);
                 glob->setDSOLocal(true);
 
+                if (dibuilder)
+                {
+                    if (llvm::DIType *diTy = getDebugType(varSymbol->type))
+                        glob->addDebugInfo(dibuilder->createGlobalVariableExpression(compileUnit, var->getText(), var->getText(), debugFile, var->getSymbol()->getLine(), diTy, false));
+                }
+
                 // If we had an expression to set the var equal to
                 if (e->ex)
                 {
                     // Ensure that the value is a constant, then, if so, initialize it.
-                    if (llvm::Constant *constant = static_cast<llvm::Constant *>(exVal.value()))
+                    if (llvm::Constant *constant = llvm::dyn_cast<llvm::Constant>(exVal.value()))
                     {
                         glob->setInitializer(constant);
                     }
                     else
                     {
                         // Should already be checked in semantic, and I don't think we could get here anyways, but still might as well have it.
-                        errorHandler.addCodegenError(ctx->getStart(), "Global variable can only be initalized to a constant!");
+                        errorHandler.addCodegenError(ctx, "Global variable can only be initalized to a constant!");
                         return {};
                     }
                 }
@@ -1159,8 +2436,29 @@ std::optional<Value *> CodegenVisitor::TvisitVarDeclStatement(WPLParser::VarDecl
             else
             {
                 //  As this is a local var we can just create an allocation for it
-                llvm::AllocaInst *v = builder->CreateAlloca(ty, 0, var->getText());
+                llvm::AllocaInst *v = CreateScopedAlloc(ty, var->getText());
                 varSymbol->val = v;
+                declareDebugVariable(v, varSymbol->type, var->getSymbol());
+
+                // Dynamic arrays start out empty (or with the given number of zeroed elements), and are freed when the block is exited
+                if (const TypeDynArray *dyn = dynamic_cast<const TypeDynArray *>(varSymbol->type))
+                {
+                    builder->CreateStore(llvm::Constant::getNullValue(ty), v);
+                    scopedArrays.back().push_back(v);
+
+                    WPLParser::ArrayTypeContext *arrCtx = static_cast<WPLParser::ArrayTypeContext *>(ctx->typeOrVar()->type());
+                    if (arrCtx->len)
+                    {
+                        std::optional<Value *> lenOpt = any2Value(arrCtx->len->accept(this));
+                        if (!lenOpt)
+                        {
+                            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + arrCtx->len->getText(); });
+                            return {};
+                        }
+
+                        visitArrayResize(v, lenOpt.value(), dyn);
+                    }
+                }
 
                 // Similarly, if we have an expression for the local var, we can store it. Otherwise, we can leave it undefined.
                 if (e->ex)
@@ -1179,7 +2477,7 @@ std::optional<Value *> CodegenVisitor::TvisitVarDeclStatement(WPLParser::VarDecl
 
                         Value *tagPtr = builder->CreateGEP(v, {Int32Zero, Int32Zero});
 
-                        builder->CreateStore(ConstantInt::get(Int32Ty, index, true), tagPtr);
+                        builder->CreateStore(ConstantInt::get(sum->getTagType(module), index, true), tagPtr);
                         Value *valuePtr = builder->CreateGEP(v, {Int32Zero, Int32One});
 
                         Value *corrected = builder->CreateBitCast(valuePtr, stoVal->getType()->getPointerTo());
@@ -1196,47 +2494,263 @@ std::optional<Value *> CodegenVisitor::TvisitVarDeclStatement(WPLParser::VarDecl
     return {};
 }
 
+llvm::DIType *CodegenVisitor::getDebugType(const Type *ty)
+{
+    // Variables declared with var are described as whatever type they were inferred to be
+    if (const TypeInfer *inf = dynamic_cast<const TypeInfer *>(ty))
+    {
+        std::optional<const Type *> valOpt = inf->getValueType();
+        return valOpt ? getDebugType(valOpt.value()) : nullptr;
+    }
+
+    auto prev = debugTypes.find(ty);
+    if (prev != debugTypes.end())
+        return prev->second;
+
+    const llvm::DataLayout &layout = module->getDataLayout();
+    llvm::DIType *ans = nullptr;
+
+    if (const TypeInt *i = dynamic_cast<const TypeInt *>(ty))
+    {
+        // Named as they are in WPL (ie, int, uint8)
+        std::string name = (i->getIsSigned() ? "int" : "uint") + (i->getBits() == 32 && i->getIsSigned() ? "" : std::to_string(i->getBits()));
+        ans = dibuilder->createBasicType(name, i->getBits(), i->getIsSigned() ? llvm::dwarf::DW_ATE_signed : llvm::dwarf::DW_ATE_unsigned);
+    }
+    else if (dynamic_cast<const TypeBool *>(ty))
+    {
+        // Booleans are i1s, but they take up a byte in memory
+        ans = dibuilder->createBasicType("boolean", 8, llvm::dwarf::DW_ATE_boolean);
+    }
+    else if (dynamic_cast<const TypeStr *>(ty))
+    {
+        llvm::DIType *charTy = dibuilder->createBasicType("char", 8, llvm::dwarf::DW_ATE_signed_char);
+        ans = dibuilder->createPointerType(charTy, layout.getPointerSizeInBits(), 0, llvm::None, "str");
+    }
+    else if (const TypeArray *arr = dynamic_cast<const TypeArray *>(ty))
+    {
+        if (llvm::DIType *valTy = getDebugType(arr->getValueType()))
+        {
+            llvm::DINodeArray subscripts = dibuilder->getOrCreateArray({dibuilder->getOrCreateSubrange(0, arr->getLength())});
+            ans = dibuilder->createArrayType(layout.getTypeAllocSizeInBits(arr->getLLVMType(module)), 0, valTy, subscripts);
+        }
+    }
+    else if (dynamic_cast<const TypeSlice *>(ty) || dynamic_cast<const TypeDynArray *>(ty))
+    {
+        // Slices and dynamic arrays are both a pointer to their elements followed by a length (and, for dynamic arrays, a capacity)
+        if (llvm::DIType *valTy = getDebugType(Types::getArrayValueType(ty)))
+        {
+            llvm::StructType *headerTy = llvm::cast<llvm::StructType>(ty->getLLVMType(module));
+            const llvm::StructLayout *headerLayout = layout.getStructLayout(headerTy);
+
+            llvm::DIType *dataTy = dibuilder->createPointerType(valTy, layout.getPointerSizeInBits());
+            std::vector<llvm::Metadata *> members = {
+                dibuilder->createMemberType(compileUnit, "data", debugFile, 0, layout.getPointerSizeInBits(), 0, 0, llvm::DINode::FlagZero, dataTy),
+                dibuilder->createMemberType(compileUnit, "length", debugFile, 0, 32, 0, headerLayout->getElementOffsetInBits(1), llvm::DINode::FlagZero, getDebugType(Types::INT))};
+
+            if (headerTy->getNumElements() > 2)
+                members.push_back(dibuilder->createMemberType(compileUnit, "capacity", debugFile, 0, 32, 0, headerLayout->getElementOffsetInBits(2), llvm::DINode::FlagZero, getDebugType(Types::INT)));
+
+            ans = dibuilder->createStructType(compileUnit, ty->toString(), debugFile, 0, headerLayout->getSizeInBits(), 0,
+                                              llvm::DINode::FlagZero, nullptr, dibuilder->getOrCreateArray(members));
+        }
+    }
+    else if (const TypeStruct *product = dynamic_cast<const TypeStruct *>(ty))
+    {
+        llvm::StructType *structTy = llvm::cast<llvm::StructType>(product->getLLVMType(module));
+        const llvm::StructLayout *structLayout = layout.getStructLayout(structTy);
+
+        std::vector<llvm::Metadata *> members;
+        std::vector<std::pair<std::string, const Type *>> elements = product->getElements();
+        for (unsigned int i = 0; i < elements.size(); i++)
+        {
+            llvm::DIType *memberTy = getDebugType(elements.at(i).second);
+            if (!memberTy)
+                continue;
+
+            members.push_back(dibuilder->createMemberType(
+                compileUnit, elements.at(i).first, debugFile, 0,
+                layout.getTypeAllocSizeInBits(structTy->getElementType(i)), 0,
+                structLayout->getElementOffsetInBits(i), llvm::DINode::FlagZero, memberTy));
+        }
+
+        ans = dibuilder->createStructType(compileUnit, product->toString(), debugFile, 0, structLayout->getSizeInBits(), 0,
+                                          llvm::DINode::FlagZero, nullptr, dibuilder->getOrCreateArray(members));
+    }
+
+    debugTypes.insert({ty, ans});
+    return ans;
+}
+
+void CodegenVisitor::beginDebugFunction(Function *fn, const TypeInvoke *inv, std::string name, antlr4::ParserRuleContext *ctx)
+{
+    if (!dibuilder)
+        return;
+
+    // The first element of a subroutine type is its return type, where null represents void
+    std::vector<llvm::Metadata *> types = {getDebugType(inv->getReturnType())};
+    for (const Type *param : inv->getParamTypes())
+        types.push_back(getDebugType(param));
+
+    unsigned int line = ctx->getStart()->getLine();
+    llvm::DISubprogram::DISPFlags spFlags = llvm::DISubprogram::SPFlagDefinition;
+    if (fn->hasLocalLinkage())
+        spFlags |= llvm::DISubprogram::SPFlagLocalToUnit;
+
+    llvm::DISubprogram *sp = dibuilder->createFunction(
+        debugFile, name, fn->getName(), debugFile, line,
+        dibuilder->createSubroutineType(dibuilder->getOrCreateTypeArray(types)),
+        line, llvm::DINode::FlagPrototyped, spFlags);
+
+    fn->setSubprogram(sp);
+    builder->SetCurrentDebugLocation(llvm::DILocation::get(module->getContext(), line, ctx->getStart()->getCharPositionInLine() + 1, sp));
+}
+
+void CodegenVisitor::declareDebugVariable(Value *storage, const Type *ty, antlr4::Token *tok, unsigned int argNo)
+{
+    if (!dibuilder)
+        return;
+
+    BasicBlock *current = builder->GetInsertBlock();
+    llvm::DISubprogram *sp = current && current->getParent() ? current->getParent()->getSubprogram() : nullptr;
+    llvm::DIType *diTy = getDebugType(ty);
+
+    if (!sp || !diTy)
+        return;
+
+    unsigned int line = tok->getLine();
+    llvm::DILocalVariable *var = argNo ? dibuilder->createParameterVariable(sp, tok->getText(), argNo, debugFile, line, diTy)
+                                       : dibuilder->createAutoVariable(sp, tok->getText(), debugFile, line, diTy);
+
+    dibuilder->insertDeclare(storage, var, dibuilder->createExpression(),
+                             llvm::DILocation::get(module->getContext(), line, tok->getCharPositionInLine() + 1, sp), current);
+}
+
+llvm::MDNode *CodegenVisitor::getLoopMetadata(WPLParser::LoopStatementContext *ctx)
+{
+    if (ctx->hints.empty())
+        return nullptr;
+
+    LLVMContext &context = module->getContext();
+
+    // The first operand of a loop ID is always a reference to itself; this gets filled in once the node is created
+    std::vector<llvm::Metadata *> ops = {nullptr};
+
+    auto addCount = [&](std::string property, unsigned int count)
+    {
+        ops.push_back(llvm::MDNode::get(context, {llvm::MDString::get(context, property), llvm::ConstantAsMetadata::get(builder->getInt32(count))}));
+    };
+
+    for (WPLParser::LoopHintContext *hint : ctx->hints)
+    {
+        std::string name = hint->name->getText();
+        unsigned int count = std::stoul(hint->value->getText());
+
+        if (name == "unroll")
+        {
+            // Unrolling by one is not unrolling at all
+            if (count == 1)
+                ops.push_back(llvm::MDNode::get(context, {llvm::MDString::get(context, "llvm.loop.unroll.disable")}));
+            else
+                addCount("llvm.loop.unroll.count", count);
+        }
+        else if (name == "vectorize")
+        {
+            // A width of one prevents vectorization
+            if (count != 1)
+                ops.push_back(llvm::MDNode::get(context, {llvm::MDString::get(context, "llvm.loop.vectorize.enable"), llvm::ConstantAsMetadata::get(builder->getTrue())}));
+            addCount("llvm.loop.vectorize.width", count);
+        }
+        else if (name == "interleave")
+        {
+            addCount("llvm.loop.interleave.count", count);
+        }
+    }
+
+    llvm::MDNode *loopID = llvm::MDNode::getDistinct(context, ops);
+    loopID->replaceOperandWith(0, loopID);
+    return loopID;
+}
+
 std::optional<Value *> CodegenVisitor::TvisitLoopStatement(WPLParser::LoopStatementContext *ctx)
 {
     // Very similar to conditionals
+    auto parent = builder->GetInsertBlock()->getParent();
+
+    BasicBlock *loopBlk = BasicBlock::Create(module->getContext(), "loop");
+    BasicBlock *restBlk = BasicBlock::Create(module->getContext(), "rest");
+
+    /*
+     * With SINGLE_TEST_LOOPS, the condition is only generated once: in a header block that the
+     * code before the loop and the end of each iteration both branch to. Otherwise, it is generated
+     * both before the loop and again at the end of each iteration.
+     */
+    BasicBlock *condBlk = nullptr;
+    if (flags & CompilerFlags::SINGLE_TEST_LOOPS)
+    {
+        condBlk = BasicBlock::Create(module->getContext(), "loopcond", parent);
+        builder->CreateBr(condBlk);
+        builder->SetInsertPoint(condBlk);
+    }
 
     std::optional<Value *> check = this->TvisitCondition(ctx->check); // any2Value(ctx->check->accept(this));
 
     if (!check)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->check->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->check->getText(); });
         return {};
     }
 
-    auto parent = builder->GetInsertBlock()->getParent();
-
-    BasicBlock *loopBlk = BasicBlock::Create(module->getContext(), "loop", parent);
-    BasicBlock *restBlk = BasicBlock::Create(module->getContext(), "rest");
-
     builder->CreateCondBr(check.value(), loopBlk, restBlk);
 
     // Need to add here otherwise we will overwrite it
-    // parent->getBasicBlockList().push_back(loopBlk);
+    parent->getBasicBlockList().push_back(loopBlk);
 
     /*
      * In the loop block
      */
     builder->SetInsertPoint(loopBlk);
+    beginScope();
+
+    // If we know the range of the loop's induction variable, then array accesses using it may not need to be bounds checked
+    std::optional<std::pair<Symbol *, int64_t>> indexBound = (flags & CompilerFlags::BOUNDS_CHECK) ? getLoopIndexBound(ctx) : std::nullopt;
+    if (indexBound)
+        loopIndexBounds.push_back(indexBound.value());
+
     for (auto e : ctx->block()->stmts)
     {
         e->accept(this);
     }
 
-    // Re-calculate the loop condition
-    check = this->TvisitCondition(ctx->check);
-    if (!check)
+    if (indexBound)
+        loopIndexBounds.pop_back();
+
+    endScope();
+
+    // The branch back to the start of the loop carries any hints that were given for the loop
+    llvm::Instruction *latch = nullptr;
+    if (condBlk)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->check->getText());
-        return {};
+        if (!builder->GetInsertBlock()->getTerminator())
+            latch = builder->CreateBr(condBlk);
+    }
+    else
+    {
+        // Re-calculate the loop condition
+        check = this->TvisitCondition(ctx->check);
+        if (!check)
+        {
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->check->getText(); });
+            return {};
+        }
+        // Check if we need to loop back again...
+        latch = builder->CreateCondBr(check.value(), loopBlk, restBlk);
+    }
+
+    if (latch)
+    {
+        if (llvm::MDNode *loopID = getLoopMetadata(ctx))
+            latch->setMetadata(LLVMContext::MD_loop, loopID);
     }
-    // Check if we need to loop back again...
-    builder->CreateCondBr(check.value(), loopBlk, restBlk);
-    loopBlk = builder->GetInsertBlock();
 
     /*
      * Out of loop
@@ -1254,7 +2768,7 @@ std::optional<Value *> CodegenVisitor::TvisitConditionalStatement(WPLParser::Con
 
     if (!cond)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->check->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->check->getText(); });
         return {};
     }
 
@@ -1276,10 +2790,12 @@ std::optional<Value *> CodegenVisitor::TvisitConditionalStatement(WPLParser::Con
      * Then block
      */
     builder->SetInsertPoint(thenBlk);
+    beginScope();
     for (auto e : ctx->trueBlk->stmts)
     {
         e->accept(this);
     }
+    endScope();
 
     // If the block ends in a return, then we can't make the branch; things would break
     if (!CodegenVisitor::blockEndsInReturn(ctx->trueBlk))
@@ -1298,10 +2814,12 @@ std::optional<Value *> CodegenVisitor::TvisitConditionalStatement(WPLParser::Con
     if (ctx->falseBlk) // If we have an else branch
     {
         // Generate the code for the else block; follows the same logic as the then block.
+        beginScope();
         for (auto e : ctx->falseBlk->stmts)
         {
             e->accept(this);
         }
+        endScope();
 
         if (!CodegenVisitor::blockEndsInReturn(ctx->falseBlk))
         {
@@ -1318,8 +2836,80 @@ std::optional<Value *> CodegenVisitor::TvisitConditionalStatement(WPLParser::Con
     return {};
 }
 
+std::optional<Value *> CodegenVisitor::visitSelectSwitch(WPLParser::SelectStatementContext *ctx, antlr4::tree::ParseTree *scrutinee)
+{
+    std::optional<Value *> valOpt = any2Value(scrutinee->accept(this));
+    if (!valOpt)
+    {
+        errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + scrutinee->getText(); });
+        return {};
+    }
+
+    auto parent = builder->GetInsertBlock()->getParent();
+    BasicBlock *mergeBlk = BasicBlock::Create(module->getContext(), "selectcont");
+
+    // The last alternative may be a default (ie, true : ...); if so, it is handled by the switch's default destination
+    WPLParser::SelectAlternativeContext *last = ctx->cases.at(ctx->cases.size() - 1);
+    std::optional<ConstValue> lastVal = props->getConstant(stripParens(last->check));
+
+    bool hasDefault = lastVal && lastVal.value() == ConstValue(true);
+    BasicBlock *defaultBlk = hasDefault ? BasicBlock::Create(module->getContext(), "default") : mergeBlk;
+
+    llvm::SwitchInst *switchInst = builder->CreateSwitch(valOpt.value(), defaultBlk, ctx->cases.size());
+    std::set<int64_t> seen;
+
+    for (WPLParser::SelectAlternativeContext *evalCase : ctx->cases)
+    {
+        BasicBlock *caseBlk;
+
+        if (hasDefault && evalCase == last)
+        {
+            caseBlk = defaultBlk;
+        }
+        else
+        {
+            // Find the constant side of the comparison (semantic analysis has ensured there is exactly one)
+            WPLParser::EqExprContext *eq = static_cast<WPLParser::EqExprContext *>(stripParens(evalCase->check));
+            std::optional<ConstValue> caseVal = props->getConstant(eq->left) ? props->getConstant(eq->left) : props->getConstant(eq->right);
+            int64_t i = std::get<int64_t>(caseVal.value());
+
+            // A repeated value can never be reached as the first alternative with it will always be taken
+            if (!seen.insert(i).second)
+                continue;
+
+            caseBlk = BasicBlock::Create(module->getContext(), "case");
+            switchInst->addCase(ConstantInt::get(llvm::cast<llvm::IntegerType>(valOpt.value()->getType()), i, true), caseBlk);
+        }
+
+        parent->getBasicBlockList().push_back(caseBlk);
+        builder->SetInsertPoint(caseBlk);
+
+        evalCase->eval->accept(this);
+
+        // Merge back in unless the alternative returned
+        bool returns = dynamic_cast<WPLParser::ReturnStatementContext *>(evalCase->eval) ||
+                       (dynamic_cast<WPLParser::BlockStatementContext *>(evalCase->eval) &&
+                        CodegenVisitor::blockEndsInReturn(static_cast<WPLParser::BlockStatementContext *>(evalCase->eval)->block()));
+
+        if (!returns)
+            builder->CreateBr(mergeBlk);
+    }
+
+    parent->getBasicBlockList().push_back(mergeBlk);
+    builder->SetInsertPoint(mergeBlk);
+
+    return {};
+}
+
 std::optional<Value *> CodegenVisitor::TvisitSelectStatement(WPLParser::SelectStatementContext *ctx)
 {
+    // If every alternative compares the same value against a constant, then we can use a switch instead of a chain of branches
+    if (flags & CompilerFlags::SELECT_SWITCH)
+    {
+        if (std::optional<antlr4::tree::ParseTree *> scrutinee = props->getSwitch(ctx))
+            return visitSelectSwitch(ctx, scrutinee.value());
+    }
+
     /*
      * Set up the merge block that all cases go to after the select statement
      */
@@ -1340,7 +2930,7 @@ std::optional<Value *> CodegenVisitor::TvisitSelectStatement(WPLParser::SelectSt
             // Check that the optional, in fact, has a value. Otherwise, something went wrong.
             if (!optVal)
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + evalCase->getText());
+                errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + evalCase->getText(); });
                 return {};
             }
 
@@ -1417,13 +3007,44 @@ std::optional<Value *> CodegenVisitor::TvisitSelectStatement(WPLParser::SelectSt
 }
 
 // Passthrough function
-std::optional<Value *> CodegenVisitor::TvisitCallStatement(WPLParser::CallStatementContext *ctx) { return this->TvisitInvocation(ctx->call); }
+std::optional<Value *> CodegenVisitor::TvisitCallStatement(WPLParser::CallStatementContext *ctx)
+{
+    if (!(flags & CompilerFlags::TAIL_CALLS) || !isTailStatement(ctx))
+        return this->TvisitInvocation(ctx->call);
+
+    /*
+     * As the PROC returns as soon as the call completes, we can either jump back to its start (for a call to itself) or
+     * return right after the call so that it can reuse our frame. Any code generated after this (ie, branches to the
+     * end of an if) is unreachable, so it is placed in a block of its own.
+     */
+    if (!visitSelfTailCall(ctx->call))
+    {
+        // Dynamic arrays still need to be freed after the call, so it cannot be the last thing we do
+        std::optional<Value *> valOpt = this->TvisitInvocation(ctx->call);
+        if (!valOpt || hasLiveArrays() || !markTailCall(valOpt.value()))
+            return valOpt;
+
+        builder->CreateRetVoid();
+    }
+
+    BasicBlock *rest = BasicBlock::Create(module->getContext(), "aftertail", builder->GetInsertBlock()->getParent());
+    builder->SetInsertPoint(rest);
+    return {};
+}
 
 std::optional<Value *> CodegenVisitor::TvisitReturnStatement(WPLParser::ReturnStatementContext *ctx)
 {
     // Check if we are returning an expression or not
     if (ctx->expression())
     {
+        // Returning the result of a call to ourself can be done by jumping back to the start of the function
+        if (flags & CompilerFlags::TAIL_CALLS)
+        {
+            WPLParser::CallExprContext *callCtx = dynamic_cast<WPLParser::CallExprContext *>(stripParens(ctx->expression()));
+            if (callCtx && visitSelfTailCall(callCtx->call))
+                return {};
+        }
+
         // If we are, then visit that expression
         std::any anyInner = ctx->expression()->accept(this);
 
@@ -1432,7 +3053,7 @@ std::optional<Value *> CodegenVisitor::TvisitReturnStatement(WPLParser::ReturnSt
         {
             if (!innerOpt)
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->getText());
+                errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
                 return {};
             }
 
@@ -1441,7 +3062,7 @@ std::optional<Value *> CodegenVisitor::TvisitReturnStatement(WPLParser::ReturnSt
             std::optional<Symbol *> symOpt = props->getBinding(ctx);
             if (!symOpt)
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Unable to find binding for return");
+                errorHandler.addCodegenError(ctx, "Unable to find binding for return");
                 return {};
             }
 
@@ -1455,10 +3076,10 @@ std::optional<Value *> CodegenVisitor::TvisitReturnStatement(WPLParser::ReturnSt
                 if (index != 0)
                 {
                     llvm::Type *sumTy = sum->getLLVMType(module);
-                    llvm::AllocaInst *alloc = builder->CreateAlloca(sumTy, 0, "");
+                    llvm::AllocaInst *alloc = CreateEntryBlockAlloc(sumTy);
 
                     Value *tagPtr = builder->CreateGEP(alloc, {Int32Zero, Int32Zero});
-                    builder->CreateStore(ConstantInt::get(Int32Ty, index, true), tagPtr);
+                    builder->CreateStore(ConstantInt::get(sum->getTagType(module), index, true), tagPtr);
                     Value *valuePtr = builder->CreateGEP(alloc, {Int32Zero, Int32One});
                     Value *corrected = builder->CreateBitCast(valuePtr, inner->getType()->getPointerTo());
                     builder->CreateStore(inner, corrected);
@@ -1467,6 +3088,21 @@ std::optional<Value *> CodegenVisitor::TvisitReturnStatement(WPLParser::ReturnSt
                 }
             }
             
+            // Aggregates are returned by writing them into the storage the caller passed as the sret argument
+            llvm::Function *fn = builder->GetInsertBlock()->getParent();
+            if (fn->hasStructRetAttr())
+            {
+                builder->CreateStore(inner, fn->getArg(0));
+                freeAllArrays();
+                return builder->CreateRetVoid();
+            }
+
+            // Dynamic arrays are freed once the value being returned has been computed, so a call cannot be the last thing we do
+            if ((flags & CompilerFlags::TAIL_CALLS) && !hasLiveArrays())
+                markTailCall(inner);
+
+            freeAllArrays();
+
             // As the code was generated correctly, build the return statement; we ensure no following code due to how block visitors work in semantic analysis.
             Value *v = builder->CreateRet(inner);
 
@@ -1474,12 +3110,13 @@ std::optional<Value *> CodegenVisitor::TvisitReturnStatement(WPLParser::ReturnSt
         }
         else
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Failed to generate code for: " + ctx->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Failed to generate code for: " + ctx->getText(); });
             return {};
         }
     }
 
     // If there is no value, return void. We ensure no following code and type-correctness in the semantic pass.
+    freeAllArrays();
     Value *v = builder->CreateRetVoid();
     return v;
 }
@@ -1495,11 +3132,15 @@ std::optional<Value *> CodegenVisitor::TvisitBlockStatement(WPLParser::BlockStat
 
 std::optional<Value *> CodegenVisitor::TvisitBlock(WPLParser::BlockContext *ctx)
 {
+    beginScope();
+
     for (auto e : ctx->stmts)
     {
         e->accept(this);
     }
 
+    endScope();
+
     return {};
 }
 
@@ -1513,7 +3154,7 @@ std::optional<Value *> CodegenVisitor::TvisitLambdaConstExpr(WPLParser::LambdaCo
 
     if (!symOpt)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Unbound lambda: " + ctx->getText());
+        errorHandler.addCodegenError(ctx, [=]() { return "Unbound lambda: " + ctx->getText(); });
         return {};
     }
 
@@ -1521,7 +3162,7 @@ std::optional<Value *> CodegenVisitor::TvisitLambdaConstExpr(WPLParser::LambdaCo
 
     if (!sym->type)
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Symbol in lambda missing type. Probably compiler error.");
+        errorHandler.addCodegenError(ctx, "Symbol in lambda missing type. Probably compiler error.");
         return {};
     }
 
@@ -1538,35 +3179,25 @@ std::optional<Value *> CodegenVisitor::TvisitLambdaConstExpr(WPLParser::LambdaCo
         BasicBlock *bBlk = BasicBlock::Create(module->getContext(), "entry", fn);
         builder->SetInsertPoint(bBlk);
 
-        // Bind all of the arguments
-        for (auto &arg : fn->args())
-        {
-            // Get the argumengt number (just seems easier than making my own counter)
-            int argNumber = arg.getArgNo();
-
-            // Get the argument's type
-            llvm::Type *type = fnType->params()[argNumber];
+        llvm::DebugLoc outerLoc = builder->getCurrentDebugLocation();
+        beginDebugFunction(fn, static_cast<const TypeInvoke *>(type), "lambda", ctx);
 
-            // Get the argument name (This even works for arrays!)
-            std::string argName = paramList->params.at(argNumber)->getText();
+        // Bind all of the arguments
+        bindArguments(fn, static_cast<const TypeInvoke *>(type), paramList, ctx, "lambda");
+        addEffectAttributes(fn, static_cast<const TypeInvoke *>(type), ctx);
 
-            // Create an allocation for the argumentr
-            llvm::AllocaInst *v = builder->CreateAlloca(type, 0, argName);
+        // The lambda's variables belong to its own function, not to the scopes (or loops) we are generating the lambda within
+        std::vector<std::vector<llvm::AllocaInst *>> outerScopes;
+        std::swap(outerScopes, scopedAllocs);
 
-            // Try to find the parameter's bnding to determine what value to bind to it.
-            std::optional<Symbol *> symOpt = props->getBinding(paramList->params.at(argNumber));
+        std::vector<std::vector<llvm::AllocaInst *>> outerArrays(1);
+        std::swap(outerArrays, scopedArrays);
 
-            if (!symOpt)
-            {
-                errorHandler.addCodegenError(ctx->getStart(), "Unable to generate parameter for lambda: " + argName);
-            }
-            else
-            {
-                symOpt.value()->val = v;
+        std::vector<std::pair<Symbol *, int64_t>> outerLoops;
+        std::swap(outerLoops, loopIndexBounds);
 
-                builder->CreateStore(&arg, v);
-            }
-        }
+        std::optional<SelfTailTarget> outerTail;
+        std::swap(outerTail, selfTail);
 
         // Generate code for the block
         for (auto e : ctx->block()->stmts)
@@ -1574,16 +3205,25 @@ std::optional<Value *> CodegenVisitor::TvisitLambdaConstExpr(WPLParser::LambdaCo
             e->accept(this);
         }
 
+        if (!builder->GetInsertBlock()->getTerminator())
+            freeArrays(scopedArrays.front());
+
+        std::swap(outerScopes, scopedAllocs);
+        std::swap(outerArrays, scopedArrays);
+        std::swap(outerLoops, loopIndexBounds);
+        std::swap(outerTail, selfTail);
+
         // NOTE HOW WE DONT NEED TO CREATE RET VOID EVER BC NO FN!
 
         // Return to original insert point
         builder->SetInsertPoint(ins);
+        builder->SetCurrentDebugLocation(outerLoc);
 
         return fn;
     }
     else
     {
-        errorHandler.addCodegenError(ctx->getStart(), "Invocation type could not be cast to function!");
+        errorHandler.addCodegenError(ctx, "Invocation type could not be cast to function!");
     }
 
     // Return to original insert point
@@ -1602,42 +3242,42 @@ std::optional<Value *> CodegenVisitor::TvisitLambdaConstExpr(WPLParser::LambdaCo
  */
 std::optional<Value *> CodegenVisitor::TvisitTypeOrVar(WPLParser::TypeOrVarContext *ctx)
 {
-    errorHandler.addCodegenError(ctx->getStart(), "TypeOrVar fragment should never be visited directly by codegen!");
+    errorHandler.addCodegenError(ctx, "TypeOrVar fragment should never be visited directly by codegen!");
     return {};
 }
 
 std::optional<Value *> CodegenVisitor::TvisitAssignment(WPLParser::AssignmentContext *ctx)
 {
-    errorHandler.addCodegenError(ctx->getStart(), "Assignment fragment should never be visited directly during codegen!");
+    errorHandler.addCodegenError(ctx, "Assignment fragment should never be visited directly during codegen!");
     return {};
 }
 
 std::optional<Value *> CodegenVisitor::TvisitParameterList(WPLParser::ParameterListContext *ctx)
 {
-    errorHandler.addCodegenError(ctx->getStart(), "Unknown error: Codegen should not have to visits parameter list!");
+    errorHandler.addCodegenError(ctx, "Unknown error: Codegen should not have to visits parameter list!");
     return {};
 }
 
 std::optional<Value *> CodegenVisitor::TvisitParameter(WPLParser::ParameterContext *ctx)
 {
-    errorHandler.addCodegenError(ctx->getStart(), "Unknown error: Codegen should not have to visit parameter!");
+    errorHandler.addCodegenError(ctx, "Unknown error: Codegen should not have to visit parameter!");
     return {};
 }
 
 std::optional<Value *> CodegenVisitor::TvisitType(WPLParser::TypeContext *ctx)
 {
-    errorHandler.addCodegenError(ctx->getStart(), "Unknown error: Codegen should never directly visit types looking for values!");
+    errorHandler.addCodegenError(ctx, "Unknown error: Codegen should never directly visit types looking for values!");
     return {};
 }
 
 std::optional<Value *> CodegenVisitor::TvisitArrayOrVar(WPLParser::ArrayOrVarContext *ctx)
 {
-    errorHandler.addCodegenError(ctx->getStart(), "Unknown Error: Codegen should never directly visit ArrayOrVar!");
+    errorHandler.addCodegenError(ctx, "Unknown Error: Codegen should never directly visit ArrayOrVar!");
     return {};
 }
 
 std::optional<Value *> CodegenVisitor::TvisitSelectAlternative(WPLParser::SelectAlternativeContext *ctx)
 {
-    errorHandler.addCodegenError(ctx->getStart(), "Unknown Error: Codegen should never directly visit SelectAlternative!");
+    errorHandler.addCodegenError(ctx, "Unknown Error: Codegen should never directly visit SelectAlternative!");
     return {};
 }
@@ -24,12 +24,16 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/NoFolder.h"
+#include "llvm/IR/ConstantFolder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/DIBuilder.h"
 
 #include <any>
 #include <string>
-#include <regex>
 
 #include <variant>
+#include <set>
 
 // using namespace llvm;
 using llvm::ArrayRef;
@@ -69,8 +73,27 @@ public:
         context = new LLVMContext();
         module = new Module(moduleName, *context);
 
-        // Use the NoFolder to turn off constant folding
-        builder = new IRBuilder<NoFolder>(module->getContext());
+        // Must be known before any sum is lowered as it determines their layout
+        if (flags & CompilerFlags::COMPACT_SUMS)
+            module->addModuleFlag(llvm::Module::Error, TypeSum::COMPACT_LAYOUT_FLAG, 1);
+
+        // Similarly, must be known before any invokable is lowered as it determines their signatures
+        if (flags & CompilerFlags::AGGREGATE_REFS)
+            module->addModuleFlag(llvm::Module::Error, TypeInvoke::AGGREGATE_REFS_FLAG, 1);
+
+        // The compile unit itself is created once we know which file we are compiling (see TvisitCompilationUnit)
+        if (flags & CompilerFlags::DEBUG_INFO)
+        {
+            module->addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+            module->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+            dibuilder = new llvm::DIBuilder(*module);
+        }
+
+        // Use the NoFolder to turn off constant folding unless it was requested
+        if (flags & CompilerFlags::CONST_FOLD)
+            builder = new IRBuilder<llvm::ConstantFolder>(module->getContext());
+        else
+            builder = new IRBuilder<NoFolder>(module->getContext());
 
         // LLVM Types
         VoidTy = llvm::Type::getVoidTy(module->getContext());
@@ -92,6 +115,187 @@ public:
     std::optional<Value *> TvisitArrayAccess(WPLParser::ArrayAccessContext *ctx);
     std::optional<Value *> TvisitArrayOrVar(WPLParser::ArrayOrVarContext *ctx);
 
+    /**
+     * @brief Determines the address of a field access's storage without loading its value. For a plain variable this is its
+     * allocation or global; for a chain of struct fields (ie, a.b.c) this is a single GEP from the root variable's storage.
+     *
+     * @param ctx The FieldAccessExprContext to find the address of
+     * @return std::optional<Value *> Pointer to the storage, or empty if the access has no storage to address
+     */
+    std::optional<Value *> visitFieldAccessAddr(WPLParser::FieldAccessExprContext *ctx);
+
+    /**
+     * @brief Generates the arguments of an invocation, converting each to the representation its parameter expects
+     * (ie, wrapping values in sums and passing aggregates by reference).
+     *
+     * @param ctx The InvocationContext whose arguments should be generated
+     * @param inv The type of the PROC/FUNC being invoked
+     * @return std::optional<std::vector<Value *>> The arguments, or empty if any failed to generate
+     */
+    std::optional<std::vector<Value *>> visitArguments(WPLParser::InvocationContext *ctx, const TypeInvoke *inv);
+
+    /**
+     * @brief Generates an invocation of one of an array's built in methods (see SemanticVisitor::visitArrayMethod). Bulk
+     * operations on integers are generated as explicit vector loops followed by a scalar loop for the remaining elements,
+     * while fills and copies use memset/memmove where possible.
+     *
+     * @param ctx The InvocationContext
+     * @param sym The array the method is invoked on
+     * @return std::optional<Value *> The result of reductions (and dot); empty for methods which do not produce a value
+     */
+    std::optional<Value *> visitArrayMethod(WPLParser::InvocationContext *ctx, Symbol *sym);
+
+    /**
+     * @brief Generates an invocation of one of a dynamic array's built in methods: push(value) or resize(length)
+     *
+     * @param ctx The InvocationContext
+     * @param sym The dynamic array the method is invoked on
+     * @return std::optional<Value *> Always empty, as neither method produces a value
+     */
+    std::optional<Value *> visitDynArrayMethod(WPLParser::InvocationContext *ctx, Symbol *sym);
+
+    /**
+     * @brief Gets a pointer to the first element of an array held in a variable, along with its length
+     *
+     * @param sym The array (fixed, dynamic, or slice)
+     * @param ctx The context the array is used in
+     * @return std::optional<std::pair<Value *, Value *>> The elements and length, or empty if the array could not be found
+     */
+    std::optional<std::pair<Value *, Value *>> visitArrayElements(Symbol *sym, antlr4::ParserRuleContext *ctx);
+
+    /**
+     * @brief Generates a loop over [start, end) in increments of step, where end - start is a multiple of step. The body
+     * is given the index and the value of the accumulator (if there is one), and produces the next accumulator.
+     *
+     * @param start The first index
+     * @param end The index to stop at
+     * @param step How much to increment the index by
+     * @param init The initial value of the accumulator, or nullptr if there is none
+     * @param body Generates the body of the loop
+     * @return Value* The final value of the accumulator (or nullptr if there is none)
+     */
+    Value *visitCountedLoop(Value *start, Value *end, unsigned int step, Value *init, std::function<Value *(Value *, Value *)> body);
+
+    // The number of elements of the given integer type that fit in a vector register (of VECTOR_BITS)
+    unsigned int getVectorWidth(llvm::Type *elemTy) { return std::max(2u, VECTOR_BITS / elemTy->getIntegerBitWidth()); }
+
+    /**
+     * @brief Generates a call to the runtime to set the length of a dynamic array
+     *
+     * @param header The storage of the dynamic array
+     * @param length The new length
+     * @param dyn The type of the dynamic array
+     * @return Value* The call to the runtime
+     */
+    Value *visitArrayResize(Value *header, Value *length, const TypeDynArray *dyn);
+
+    /**
+     * @brief Generates an argument for a slice parameter. Arrays are passed as a pointer to their first element
+     * (in their own storage when they are held in a variable) along with their length; slices are passed as they are.
+     *
+     * @param ctx The argument
+     * @param slice The type of the parameter
+     * @return std::optional<Value *> The slice, or empty if the argument failed to generate
+     */
+    std::optional<Value *> visitSliceArgument(WPLParser::ExpressionContext *ctx, const TypeSlice *slice);
+
+    /**
+     * @brief If the invocation is a direct call to the PROC/FUNC currently being generated, generates it as a jump back to
+     * the start of the function with the parameters set to the new arguments. Should only be used on calls in tail position.
+     *
+     * @param ctx The InvocationContext in tail position
+     * @return true If the call was generated as a jump (the current block is then terminated)
+     * @return false If nothing was generated as the call must be made normally
+     */
+    bool visitSelfTailCall(WPLParser::InvocationContext *ctx);
+
+    /**
+     * @brief Marks a call that is immediately followed by a return as a tail call, provided that it is not passed any of
+     * the caller's stack allocations. The call is marked musttail when the caller and callee prototypes match.
+     *
+     * @param val The value that is about to be returned
+     * @return true If the call is guaranteed to reuse the caller's frame
+     * @return false Otherwise
+     */
+    bool markTailCall(Value *val);
+
+    /**
+     * @brief Builds a pointer to an array element by GEPing into the array's own storage, avoiding a copy of the array.
+     *
+     * @param ctx The ArrayAccessContext to build a pointer for
+     * @return std::optional<Value *> Pointer to the element, or empty if the array has no storage to address
+     */
+    std::optional<Value *> visitArrayAccessAddr(WPLParser::ArrayAccessContext *ctx);
+
+    /**
+     * @brief Applies the integer conversion (if any) that semantic analysis recorded for an expression
+     *
+     * @param ctx The expression
+     * @param val The value generated for the expression
+     * @return std::optional<Value *> The converted value, or val if no conversion is needed
+     */
+    std::optional<Value *> visitIntConversion(WPLParser::ExpressionContext *ctx, std::optional<Value *> val);
+
+    /**
+     * @brief Determines if an arithmetic or relational expression operates on unsigned integers
+     *
+     * @param ctx The expression
+     * @return true if the operands are unsigned
+     * @return false if the operands are signed
+     */
+    bool hasUnsignedOperands(antlr4::tree::ParseTree *ctx)
+    {
+        std::optional<const TypeInt *> ty = props->getOperandType(ctx);
+        return ty && !ty.value()->getIsSigned();
+    }
+
+    /**
+     * @brief Generates the value of an expression that semantic analysis found to be constant.
+     *
+     * @param ctx The expression to generate the value of
+     * @return std::optional<Value *> The constant, or empty if the expression is not constant
+     */
+    std::optional<Value *> visitConstant(antlr4::tree::ParseTree *ctx);
+
+    /**
+     * @brief Generates a select statement as a switch. Should only be used on selects that semantic analysis found to
+     * compare the same value against a constant in every alternative.
+     *
+     * @param ctx The SelectStatementContext to generate
+     * @param scrutinee The expression being compared in each alternative
+     * @return std::optional<Value *> Empty as this is a statement
+     */
+    std::optional<Value *> visitSelectSwitch(WPLParser::SelectStatementContext *ctx, antlr4::tree::ParseTree *scrutinee);
+
+    /**
+     * @brief Builds the llvm.loop metadata for the hints (ie, @unroll(4)) given before a loop.
+     *
+     * @param ctx The LoopStatementContext whose hints should be used
+     * @return llvm::MDNode* The loop ID to attach to the loop's latch, or nullptr if the loop has no hints
+     */
+    llvm::MDNode *getLoopMetadata(WPLParser::LoopStatementContext *ctx);
+
+    /**
+     * @brief If BOUNDS_CHECK is set, generates a check that the index is within [0, length). When it is not, control
+     * branches to a cold path which aborts the program. No check is generated when the index is provably in range.
+     *
+     * @param ctx The ArrayAccessContext being checked
+     * @param index The index being accessed
+     * @param length The length of the array being accessed
+     */
+    void visitBoundsCheck(WPLParser::ArrayAccessContext *ctx, Value *index, int length);
+
+    /**
+     * @brief Generates a check that the index is within [0, length) for a slice or dynamic array, whose length is only
+     * known at runtime. Unlike for fixed length arrays, this is done even if BOUNDS_CHECK is not set as nothing else
+     * keeps these accesses in range.
+     *
+     * @param ctx The ArrayAccessContext being checked
+     * @param index The index being accessed
+     * @param lengthVal The length of the array being accessed
+     */
+    void visitBoundsCheck(WPLParser::ArrayAccessContext *ctx, Value *index, Value *lengthVal);
+
     std::optional<Value *> TvisitIConstExpr(WPLParser::IConstExprContext *ctx);
     std::optional<Value *> TvisitArrayAccessExpr(WPLParser::ArrayAccessExprContext *ctx);
     std::optional<Value *> TvisitSConstExpr(WPLParser::SConstExprContext *ctx);
@@ -104,6 +308,7 @@ public:
     // std::optional<Value *> TvisitVariableExpr(WPLParser::VariableExprContext *ctx);
     std::optional<Value *> TvisitFieldAccessExpr(WPLParser::FieldAccessExprContext *ctx);
     std::optional<Value *> TvisitParenExpr(WPLParser::ParenExprContext *ctx);
+    std::optional<Value *> TvisitIntCastExpr(WPLParser::IntCastExprContext *ctx);
     std::optional<Value *> TvisitBinaryRelExpr(WPLParser::BinaryRelExprContext *ctx);
     std::optional<Value *> TvisitBConstExpr(WPLParser::BConstExprContext *ctx);
     std::optional<Value *> TvisitBlock(WPLParser::BlockContext *ctx);
@@ -140,18 +345,20 @@ public:
     std::any visitArrayAccess(WPLParser::ArrayAccessContext *ctx) override { return TvisitArrayAccess(ctx); };
     std::any visitArrayOrVar(WPLParser::ArrayOrVarContext *ctx) override { return TvisitArrayOrVar(ctx); };
 
-    std::any visitIConstExpr(WPLParser::IConstExprContext *ctx) override { return TvisitIConstExpr(ctx); };
-    std::any visitArrayAccessExpr(WPLParser::ArrayAccessExprContext *ctx) override { return TvisitArrayAccessExpr(ctx); };
+    std::any visitIConstExpr(WPLParser::IConstExprContext *ctx) override { return visitIntConversion(ctx, TvisitIConstExpr(ctx)); };
+    std::any visitArrayAccessExpr(WPLParser::ArrayAccessExprContext *ctx) override { return visitIntConversion(ctx, TvisitArrayAccessExpr(ctx)); };
     std::any visitSConstExpr(WPLParser::SConstExprContext *ctx) override { return TvisitSConstExpr(ctx); };
-    std::any visitUnaryExpr(WPLParser::UnaryExprContext *ctx) override { return TvisitUnaryExpr(ctx); };
-    std::any visitBinaryArithExpr(WPLParser::BinaryArithExprContext *ctx) override { return TvisitBinaryArithExpr(ctx); };
+    std::any visitUnaryExpr(WPLParser::UnaryExprContext *ctx) override { return visitIntConversion(ctx, TvisitUnaryExpr(ctx)); };
+    std::any visitBinaryArithExpr(WPLParser::BinaryArithExprContext *ctx) override { return visitIntConversion(ctx, TvisitBinaryArithExpr(ctx)); };
     std::any visitEqExpr(WPLParser::EqExprContext *ctx) override { return TvisitEqExpr(ctx); };
     std::any visitLogAndExpr(WPLParser::LogAndExprContext *ctx) override { return TvisitLogAndExpr(ctx); };
     std::any visitLogOrExpr(WPLParser::LogOrExprContext *ctx) override { return TvisitLogOrExpr(ctx); };
-    std::any visitCallExpr(WPLParser::CallExprContext *ctx) override { return TvisitCallExpr(ctx); };
+    std::any visitCallExpr(WPLParser::CallExprContext *ctx) override { return visitIntConversion(ctx, TvisitCallExpr(ctx)); };
     // std::any visitVariableExpr(WPLParser::VariableExprContext *ctx) override { return TvisitVariableExpr(ctx); };
     std::any visitFieldAccessExpr(WPLParser::FieldAccessExprContext *ctx) override { return TvisitFieldAccessExpr(ctx); };
-    std::any visitParenExpr(WPLParser::ParenExprContext *ctx) override { return TvisitParenExpr(ctx); };
+    std::any visitFieldAccess(WPLParser::FieldAccessContext *ctx) override { return visitIntConversion(ctx, TvisitFieldAccessExpr(ctx->fieldAccessExpr())); };
+    std::any visitIntCastExpr(WPLParser::IntCastExprContext *ctx) override { return visitIntConversion(ctx, TvisitIntCastExpr(ctx)); };
+    std::any visitParenExpr(WPLParser::ParenExprContext *ctx) override { return visitIntConversion(ctx, TvisitParenExpr(ctx)); };
     std::any visitBinaryRelExpr(WPLParser::BinaryRelExprContext *ctx) override { return TvisitBinaryRelExpr(ctx); };
     std::any visitBConstExpr(WPLParser::BConstExprContext *ctx) override { return TvisitBConstExpr(ctx); };
     std::any visitBlock(WPLParser::BlockContext *ctx) override { return TvisitBlock(ctx); };
@@ -162,13 +369,13 @@ public:
     std::any visitAssignment(WPLParser::AssignmentContext *ctx) override { return TvisitAssignment(ctx); };
     std::any visitExternStatement(WPLParser::ExternStatementContext *ctx) override { return TvisitExternStatement(ctx); };
     std::any visitFuncDef(WPLParser::FuncDefContext *ctx) override { return TvisitFuncDef(ctx); };
-    std::any visitAssignStatement(WPLParser::AssignStatementContext *ctx) override { return TvisitAssignStatement(ctx); };
-    std::any visitVarDeclStatement(WPLParser::VarDeclStatementContext *ctx) override { return TvisitVarDeclStatement(ctx); };
-    std::any visitLoopStatement(WPLParser::LoopStatementContext *ctx) override { return TvisitLoopStatement(ctx); };
-    std::any visitConditionalStatement(WPLParser::ConditionalStatementContext *ctx) override { return TvisitConditionalStatement(ctx); };
-    std::any visitSelectStatement(WPLParser::SelectStatementContext *ctx) override { return TvisitSelectStatement(ctx); };
-    std::any visitCallStatement(WPLParser::CallStatementContext *ctx) override { return TvisitCallStatement(ctx); };
-    std::any visitReturnStatement(WPLParser::ReturnStatementContext *ctx) override { return TvisitReturnStatement(ctx); };
+    std::any visitAssignStatement(WPLParser::AssignStatementContext *ctx) override { setDebugLocation(ctx); return TvisitAssignStatement(ctx); };
+    std::any visitVarDeclStatement(WPLParser::VarDeclStatementContext *ctx) override { setDebugLocation(ctx); return TvisitVarDeclStatement(ctx); };
+    std::any visitLoopStatement(WPLParser::LoopStatementContext *ctx) override { setDebugLocation(ctx); return TvisitLoopStatement(ctx); };
+    std::any visitConditionalStatement(WPLParser::ConditionalStatementContext *ctx) override { setDebugLocation(ctx); return TvisitConditionalStatement(ctx); };
+    std::any visitSelectStatement(WPLParser::SelectStatementContext *ctx) override { setDebugLocation(ctx); return TvisitSelectStatement(ctx); };
+    std::any visitCallStatement(WPLParser::CallStatementContext *ctx) override { setDebugLocation(ctx); return TvisitCallStatement(ctx); };
+    std::any visitReturnStatement(WPLParser::ReturnStatementContext *ctx) override { setDebugLocation(ctx); return TvisitReturnStatement(ctx); };
     std::any visitBlockStatement(WPLParser::BlockStatementContext *ctx) override { return TvisitBlockStatement(ctx); };
     std::any visitTypeOrVar(WPLParser::TypeOrVarContext *ctx) override { return TvisitTypeOrVar(ctx); };
     // std::any visitType(WPLParser::TypeContext *ctx) override { return TvisitType(ctx); };
@@ -176,17 +383,154 @@ public:
 
     std::any visitLambdaConstExpr(WPLParser::LambdaConstExprContext *ctx) override { return TvisitLambdaConstExpr(ctx); }
     // std::any visitDefineEnum(WPLParser::DefineEnumContext *ctx) override { return TvisitDefineEnum(ctx); }
-    std::any visitMatchStatement(WPLParser::MatchStatementContext *ctx) override { return TvisitMatchStatement(ctx); }
+    std::any visitMatchStatement(WPLParser::MatchStatementContext *ctx) override { setDebugLocation(ctx); return TvisitMatchStatement(ctx); }
     std::any visitInitProduct(WPLParser::InitProductContext *ctx) override { return TvisitInitProduct(ctx); }
 
     bool hasErrors(int flags) { return errorHandler.hasErrors(flags); }
     std::string getErrors() { return errorHandler.errorList(); }
+    std::string getErrors(DiagnosticFormat format) { return errorHandler.errorList(format); }
+    std::vector<std::string> getErrorEntries(DiagnosticFormat format) { return errorHandler.errorEntries(format); }
+    void setErrorLimit(unsigned int limit, unsigned int prior = 0) { errorHandler.setErrorLimit(limit, prior); }
 
     PropertyManager *getProperties() { return props; }
 
     Module *getModule() { return module; }
     void modPrint() { module->print(llvm::outs(), nullptr); }
 
+    /**
+     * @brief Declares the FUNC/PROCs and global variables imported from module interfaces so that they can be referenced in the IR. Should be used before visiting the compilation unit.
+     *
+     * @param imports The symbols loaded from the module interfaces
+     */
+    void declareImports(std::vector<Symbol *> imports);
+
+    /**
+     * @brief Attaches the attributes implied by an invokable's effects (as found by semantic analysis) to its function.
+     * Does nothing unless FUNCTION_ATTRS is set.
+     *
+     * @param fn The function to add attributes to
+     * @param inv The type of the function
+     * @param ctx The context which defines the function
+     */
+    void addEffectAttributes(Function *fn, const TypeInvoke *inv, antlr4::tree::ParseTree *ctx)
+    {
+        if (!(flags & CompilerFlags::FUNCTION_ATTRS))
+            return;
+
+        std::optional<InvokeEffects> effectsOpt = props->getEffects(ctx);
+        if (!effectsOpt)
+            return;
+
+        InvokeEffects effects = effectsOpt.value();
+
+        if (effects.noUnwind)
+            fn->addFnAttr(llvm::Attribute::NoUnwind);
+
+        if (effects.noRecurse)
+            fn->addFnAttr(llvm::Attribute::NoRecurse);
+
+        // A failed bounds check does not return, and reports the error (which may write to memory). Slices and
+        // dynamic arrays are checked even without BOUNDS_CHECK
+        if (effects.mayAbort || (effects.indexesArrays && (flags & CompilerFlags::BOUNDS_CHECK)))
+            return;
+
+        if (effects.willReturn)
+            fn->addFnAttr(llvm::Attribute::WillReturn);
+
+        // Returning through an sret argument writes to memory
+        if (effects.writesMemory || inv->hasStructReturn(module))
+            return;
+
+        // Aggregates passed by reference are read through their pointer
+        bool readsArguments = false;
+        for (const Type *param : inv->getParamTypes())
+            readsArguments |= inv->takesByReference(module, param);
+
+        fn->addFnAttr((effects.readsMemory || readsArguments) ? llvm::Attribute::ReadOnly : llvm::Attribute::ReadNone);
+    }
+
+    /**
+     * @brief Binds the arguments of a PROC/FUNC/lambda to the symbols of its parameters. Arguments passed directly are
+     * stored into their own allocation. Aggregates passed by reference are used in place unless the body assigns to them,
+     * in which case they are copied so that the caller's value is unaffected.
+     *
+     * @param fn The function being generated
+     * @param inv The type of the function
+     * @param paramList The parameters of the function (may be null if there are none)
+     * @param ctx The context to report errors on
+     * @param kind Description of the function for error messages (ie, function or lambda)
+     */
+    void bindArguments(Function *fn, const TypeInvoke *inv, WPLParser::ParameterListContext *paramList, antlr4::ParserRuleContext *ctx, std::string kind)
+    {
+        llvm::FunctionType *fnType = fn->getFunctionType();
+
+        // An sret argument comes before all of the parameters
+        unsigned int offset = 0;
+        if (inv->hasStructReturn(module))
+        {
+            fn->addParamAttr(0, llvm::Attribute::getWithStructRetType(module->getContext(), inv->getReturnType()->getLLVMType(module)));
+            fn->addParamAttr(0, llvm::Attribute::NoAlias);
+            offset = 1;
+        }
+
+        for (auto &arg : fn->args())
+        {
+            if (arg.getArgNo() < offset)
+                continue;
+
+            // Get the argumengt number (just seems easier than making my own counter)
+            int argNumber = arg.getArgNo() - offset;
+
+            // Get the argument's type
+            llvm::Type *type = fnType->params()[arg.getArgNo()];
+
+            // Get the argument name (This even works for arrays!)
+            std::string argName = paramList->params.at(argNumber)->getText();
+
+            // Try to find the parameter's bnding to determine what value to bind to it.
+            std::optional<Symbol *> symOpt = props->getBinding(paramList->params.at(argNumber));
+
+            if (!symOpt)
+            {
+                errorHandler.addCodegenError(ctx, "Unable to generate parameter for " + kind + ": " + argName);
+                continue;
+            }
+
+            Symbol *sym = symOpt.value();
+
+            if (inv->takesByReference(module, sym->type))
+            {
+                // As we never write through the pointer (see below), the caller can rely on its value being unchanged
+                llvm::Type *valueType = type->getPointerElementType();
+                fn->addParamAttr(arg.getArgNo(), llvm::Attribute::NoAlias);
+                fn->addParamAttr(arg.getArgNo(), llvm::Attribute::NoCapture);
+                fn->addParamAttr(arg.getArgNo(), llvm::Attribute::ReadOnly);
+                fn->addDereferenceableParamAttr(arg.getArgNo(), module->getDataLayout().getTypeAllocSize(valueType));
+
+                if (!props->isMutated(sym))
+                {
+                    sym->val = &arg;
+                    declareDebugVariable(&arg, sym->type, paramList->params.at(argNumber)->name, argNumber + 1);
+                    continue;
+                }
+
+                llvm::AllocaInst *v = CreateEntryBlockAlloc(valueType, argName);
+                sym->val = v;
+                declareDebugVariable(v, sym->type, paramList->params.at(argNumber)->name, argNumber + 1);
+
+                builder->CreateStore(builder->CreateLoad(valueType, &arg), v);
+                continue;
+            }
+
+            // Create an allocation for the argumentr
+            llvm::AllocaInst *v = CreateEntryBlockAlloc(type, argName);
+            sym->val = v;
+            declareDebugVariable(v, sym->type, paramList->params.at(argNumber)->name, argNumber + 1);
+
+            builder->CreateStore(&arg, v);
+        }
+    }
+
     /**
      * @brief Generates the code for an InvokeableType (PROC/FUNC)
      *
@@ -206,14 +550,14 @@ public:
         // If we couldn't find the function, throw an error.
         if (!symOpt)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Unbound function: " + funcId);
+            errorHandler.addCodegenError(ctx, "Unbound function: " + funcId);
             return {};
         }
 
         Symbol *sym = symOpt.value();
         if (!sym->type)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Symbol in invocation missing type. Probably compiler error.");
+            errorHandler.addCodegenError(ctx, "Symbol in invocation missing type. Probably compiler error.");
             return {};
         }
 
@@ -235,39 +579,53 @@ public:
                 BasicBlock *bBlk = BasicBlock::Create(module->getContext(), "entry", fn);
                 builder->SetInsertPoint(bBlk);
 
-                // Bind all of the arguments
-                for (auto &arg : fn->args())
-                {
-                    // Get the argumengt number (just seems easier than making my own counter)
-                    int argNumber = arg.getArgNo();
-
-                    // Get the argument's type
-                    llvm::Type *type = fnType->params()[argNumber];
-
-                    // Get the argument name (This even works for arrays!)
-                    std::string argName = paramList->params.at(argNumber)->getText();
+                llvm::DebugLoc outerLoc = builder->getCurrentDebugLocation();
+                beginDebugFunction(fn, inv, funcId, ctx);
 
-                    // Create an allocation for the argumentr
-                    llvm::AllocaInst *v = builder->CreateAlloca(type, 0, argName);
+                // Bind all of the arguments
+                bindArguments(fn, inv, paramList, ctx, "function");
+                addEffectAttributes(fn, inv, ctx);
 
-                    // Try to find the parameter's bnding to determine what value to bind to it.
-                    std::optional<Symbol *> symOpt = props->getBinding(paramList->params.at(argNumber));
+                /*
+                 * Self tail calls re-assign the parameters and jump back to just after the entry block. This requires the
+                 * function's allocations to be in the entry block, otherwise each iteration would grow the stack.
+                 */
+                std::optional<SelfTailTarget> outerTail;
+                std::swap(outerTail, selfTail);
 
-                    if (!symOpt)
+                if ((flags & CompilerFlags::TAIL_CALLS) && !inv->hasStructReturn(module))
+                {
+                    std::vector<Symbol *> params;
+                    if (paramList)
                     {
-                        errorHandler.addCodegenError(ctx->getStart(), "Unable to generate parameter for function: " + argName);
+                        for (auto param : paramList->params)
+                        {
+                            std::optional<Symbol *> paramOpt = props->getBinding(param);
+                            if (paramOpt)
+                                params.push_back(paramOpt.value());
+                        }
                     }
-                    else
-                    {
-                        symOpt.value()->val = v;
 
-                        builder->CreateStore(&arg, v);
+                    if (params.size() == inv->getParamTypes().size())
+                    {
+                        BasicBlock *header = BasicBlock::Create(module->getContext(), "tailrecurse", fn);
+                        builder->CreateBr(header);
+                        builder->SetInsertPoint(header);
+                        selfTail = {fn, header, params, sym};
                     }
                 }
 
                 // Get the codeblock for the PROC/FUNC
                 WPLParser::BlockContext *block = ctx->block();
 
+                // The function's top-level variables live for the whole call, so they are not part of any nested scope
+                std::vector<std::vector<llvm::AllocaInst *>> outerScopes;
+                std::swap(outerScopes, scopedAllocs);
+
+                // Its top-level dynamic arrays are still freed when it returns
+                std::vector<std::vector<llvm::AllocaInst *>> outerArrays(1);
+                std::swap(outerArrays, scopedArrays);
+
                 // Generate code for the block
                 for (auto e : block->stmts)
                 {
@@ -277,17 +635,24 @@ public:
                 // If we are a PROC, make sure to add a return type (if we don't already have one)
                 if (ctx->PROC() && !CodegenVisitor::blockEndsInReturn(block))
                 {
+                    freeAllArrays();
                     builder->CreateRetVoid();
                 }
+
+                std::swap(outerScopes, scopedAllocs);
+                std::swap(outerArrays, scopedArrays);
+                std::swap(outerTail, selfTail);
+
+                builder->SetCurrentDebugLocation(outerLoc);
             }
             else
             {
-                errorHandler.addCodegenError(ctx->getStart(), "Invocation type could not be cast to function!");
+                errorHandler.addCodegenError(ctx, "Invocation type could not be cast to function!");
             }
         }
         else 
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Could not generate a function call for type of: " + type->toString()); 
+            errorHandler.addCodegenError(ctx, "Could not generate a function call for type of: " + type->toString());
         }
 
         builder->SetInsertPoint(ins);
@@ -301,7 +666,7 @@ public:
         // If the symbol could not be found, raise an error
         if (!symOpt)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Undefined variable access: " + id);
+            errorHandler.addCodegenError(ctx, "Undefined variable access: " + id);
             return {};
         }
 
@@ -311,7 +676,7 @@ public:
         llvm::Type *type = sym->type->getLLVMType(module);
         if (!type)
         {
-            errorHandler.addCodegenError(ctx->getStart(), "Unable to find type for variable: " + ctx->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Unable to find type for variable: " + ctx->getText(); });
             return {};
         }
 
@@ -322,7 +687,7 @@ public:
             if (const TypeInvoke* inv = dynamic_cast<const TypeInvoke *>(sym->type))
             {
                 if(!inv->getLLVMName()) {
-                    errorHandler.addCodegenError(ctx->getStart(), "Could not locate IR name for function " + sym->toString());
+                    errorHandler.addCodegenError(ctx, "Could not locate IR name for function " + sym->toString());
                     return {}; 
                 }
 
@@ -338,7 +703,7 @@ public:
                 // Check that we found the variable. If not, throw an error.
                 if (!glob)
                 {
-                    errorHandler.addCodegenError(ctx->getStart(), "Unable to find global variable: " + id);
+                    errorHandler.addCodegenError(ctx, "Unable to find global variable: " + id);
                     return {};
                 }
 
@@ -347,7 +712,7 @@ public:
                 return val;
             }
 
-            errorHandler.addCodegenError(ctx->getStart(), "Unable to find allocation for variable: " + ctx->getText());
+            errorHandler.addCodegenError(ctx, [=]() { return "Unable to find allocation for variable: " + ctx->getText(); });
             return {};
         }
 
@@ -379,16 +744,218 @@ protected:
         return ctx->stmts.size() > 0 && dynamic_cast<WPLParser::ReturnStatementContext *>(ctx->stmts.at(ctx->stmts.size() - 1));
     }
 
+    /**
+     * @brief Creates a stack allocation for the current function. The allocation is placed
+     * alongside the others at the start of the function's entry block. This way, allocations made inside of loops
+     * only happen once per call (instead of once per iteration), and mem2reg/SROA are able to promote them.
+     *
+     * @param ty The type to allocate
+     * @param identifier Name to give the allocation in the IR
+     * @return llvm::AllocaInst*
+     */
+    llvm::AllocaInst *CreateEntryBlockAlloc(llvm::Type *ty, std::string identifier = "")
+    {
+        BasicBlock *current = builder->GetInsertBlock();
+
+        if (!current || !current->getParent())
+            return builder->CreateAlloca(ty, 0, identifier);
+
+        // Insert after any existing allocations so that they stay in the order they were created
+        BasicBlock &entry = current->getParent()->getEntryBlock();
+        llvm::BasicBlock::iterator insertPt = entry.begin();
+        while (insertPt != entry.end() && llvm::isa<llvm::AllocaInst>(*insertPt))
+            insertPt++;
+
+        IRBuilder<NoFolder> entryBuilder(&entry, insertPt);
+        return entryBuilder.CreateAlloca(ty, 0, identifier);
+    }
+
+    /**
+     * @brief Creates an allocation for a variable that is only live within the current lexical scope. If we are
+     * within a nested scope, this also marks the start of the variable's lifetime; the end is marked when the scope
+     * is exited via endScope().
+     *
+     * @param ty The type to allocate
+     * @param identifier Name to give the allocation in the IR
+     * @return llvm::AllocaInst*
+     */
+    llvm::AllocaInst *CreateScopedAlloc(llvm::Type *ty, std::string identifier)
+    {
+        llvm::AllocaInst *v = CreateEntryBlockAlloc(ty, identifier);
+
+        if (!scopedAllocs.empty())
+        {
+            builder->CreateLifetimeStart(v);
+            scopedAllocs.back().push_back(v);
+        }
+
+        return v;
+    }
+
+    /**
+     * @brief Determines if an array access is provably within the bounds of the array. This is the case when the
+     * index is a constant less than the array's length, or when it is the induction variable of an enclosing loop
+     * whose bound does not exceed the array's length.
+     *
+     * @param ctx The ArrayAccessContext to check
+     * @param length The length of the array being accessed
+     * @return true If the index is known to be in range
+     * @return false If the index may be out of range
+     */
+    bool isProvablyInBounds(WPLParser::ArrayAccessContext *ctx, int length);
+
+    /**
+     * @brief Determines the range of a loop's induction variable. We recognize loops of the form:
+     *
+     *      i <- k; (or int i <- k;)
+     *      while i < n do {
+     *          ...
+     *          i <- i + c;
+     *      }
+     *
+     * where k and c are non-negative constants, n is either a constant or the length of an array, and i is
+     * a local INT that is not otherwise assigned in the loop. Within the loop body, i is then always in [0, n).
+     *
+     * @param ctx The LoopStatementContext to analyze
+     * @return std::optional<std::pair<Symbol *, int64_t>> The induction variable and its exclusive upper bound, if found
+     */
+    std::optional<std::pair<Symbol *, int64_t>> getLoopIndexBound(WPLParser::LoopStatementContext *ctx);
+
+    /**
+     * @brief Gets the debug info type describing a WPL type.
+     *
+     * @param ty The type to describe
+     * @return llvm::DIType* The debug info type, or nullptr if the type is not described in debug info (ie, sums and invokables)
+     */
+    llvm::DIType *getDebugType(const Type *ty);
+
+    /**
+     * @brief If DEBUG_INFO is set, attaches a DISubprogram to a FUNC/PROC/lambda and attributes the instructions that
+     * follow (ie, its prologue) to the start of its definition.
+     *
+     * @param fn The function being defined
+     * @param inv The type of the function
+     * @param name The name of the function in the source
+     * @param ctx The context defining the function
+     */
+    void beginDebugFunction(Function *fn, const TypeInvoke *inv, std::string name, antlr4::ParserRuleContext *ctx);
+
+    /**
+     * @brief If DEBUG_INFO is set, describes a local variable or parameter stored at the given address
+     *
+     * @param storage The address of the variable's storage
+     * @param ty The type of the variable
+     * @param tok The token naming the variable
+     * @param argNo One more than the index of the parameter, or 0 if this is not a parameter
+     */
+    void declareDebugVariable(Value *storage, const Type *ty, antlr4::Token *tok, unsigned int argNo = 0);
+
+    // Attributes the instructions generated from here on to the start of the context (when DEBUG_INFO is set)
+    void setDebugLocation(antlr4::ParserRuleContext *ctx)
+    {
+        if (!dibuilder)
+            return;
+
+        // Only functions with a subprogram (ie, not the generated main) can have locations within them
+        BasicBlock *current = builder->GetInsertBlock();
+        llvm::DISubprogram *sp = current && current->getParent() ? current->getParent()->getSubprogram() : nullptr;
+
+        if (sp)
+            builder->SetCurrentDebugLocation(llvm::DILocation::get(module->getContext(), ctx->getStart()->getLine(), ctx->getStart()->getCharPositionInLine() + 1, sp));
+        else
+            builder->SetCurrentDebugLocation(llvm::DebugLoc());
+    }
+
+    // Begins a nested scope whose variables' lifetimes should end with it
+    void beginScope()
+    {
+        scopedAllocs.push_back({});
+        scopedArrays.push_back({});
+    }
+
+    // Ends the current nested scope, freeing its dynamic arrays and marking the end of its variables' lifetimes (unless control flow has already left the block)
+    void endScope()
+    {
+        BasicBlock *current = builder->GetInsertBlock();
+        if (current && !current->getTerminator())
+        {
+            freeArrays(scopedArrays.back());
+
+            for (auto it = scopedAllocs.back().rbegin(); it != scopedAllocs.back().rend(); it++)
+                builder->CreateLifetimeEnd(*it);
+        }
+
+        scopedAllocs.pop_back();
+        scopedArrays.pop_back();
+    }
+
+    /**
+     * @brief Frees the elements of dynamic arrays (most recently declared first)
+     *
+     * @param arrays The storage of the arrays to free
+     */
+    void freeArrays(const std::vector<llvm::AllocaInst *> &arrays);
+
+    // Frees the dynamic arrays of every scope in the current function (ie, as it is about to return)
+    void freeAllArrays()
+    {
+        for (auto scope = scopedArrays.rbegin(); scope != scopedArrays.rend(); scope++)
+            freeArrays(*scope);
+    }
+
+    // Determines if any dynamic arrays would need to be freed were the current function to return here
+    bool hasLiveArrays()
+    {
+        for (auto &scope : scopedArrays)
+        {
+            if (!scope.empty())
+                return true;
+        }
+
+        return false;
+    }
+
 private:
     PropertyManager *props;
     int flags;
 
+    // The size of the vectors used by array builtins. Every target we support has registers at least this wide
+    static const unsigned int VECTOR_BITS = 128;
+
+    // Allocations for the variables declared in each nested scope of the function currently being generated
+    std::vector<std::vector<llvm::AllocaInst *>> scopedAllocs;
+
+    // The dynamic arrays declared in each scope of the function currently being generated (starting with its top level)
+    std::vector<std::vector<llvm::AllocaInst *>> scopedArrays;
+
+    // Induction variables (and their exclusive upper bounds) of the loops whose bodies are currently being generated
+    std::vector<std::pair<Symbol *, int64_t>> loopIndexBounds;
+
+    // The PROC/FUNC currently being generated, the block its self tail calls jump back to, its parameters' symbols, and its definition's symbol
+    struct SelfTailTarget
+    {
+        llvm::Function *fn;
+        BasicBlock *header;
+        std::vector<Symbol *> params;
+        Symbol *definition;
+    };
+    std::optional<SelfTailTarget> selfTail;
+
+    // Only created when DEBUG_INFO is set
+    llvm::DIBuilder *dibuilder = nullptr;
+    llvm::DICompileUnit *compileUnit = nullptr;
+    llvm::DIFile *debugFile = nullptr;
+    std::map<const Type *, llvm::DIType *> debugTypes;
+
+    // The globals generated for each string literal's contents, so that identical literals can share one (see STRING_POOL)
+    std::map<std::string, llvm::Constant *> stringPool;
+
     WPLErrorHandler errorHandler;
 
     // LLVM
     LLVMContext *context;
     Module *module;
-    IRBuilder<NoFolder> *builder;
+    llvm::IRBuilderBase *builder;
 
     // Commonly used types
     llvm::Type *VoidTy;
@@ -0,0 +1,102 @@
+/**
+ * @file ProfilePipeline.h
+ * @author Alex Friedman (ahfriedman.com)
+ * @brief Runs LLVM's optimization pipeline to instrument a module for (or apply) an execution profile
+ * @version 0.1
+ * @date 2022-12-04
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#pragma once
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
+#include "llvm/Passes/PassBuilder.h" // Also provides llvm::PGOOptions
+#include "llvm/Target/TargetMachine.h"
+
+#include <optional>
+#include <string>
+
+// LLVM 14 moved the optimization levels out of the PassBuilder
+#if LLVM_VERSION_MAJOR >= 14
+using PipelineOptLevel = llvm::OptimizationLevel;
+#else
+using PipelineOptLevel = llvm::PassBuilder::OptimizationLevel;
+#endif
+
+/**
+ * @brief Collects the errors reported while running the pipeline. By default, LLVM exits as
+ * soon as it sees an error (ie, a profile that is malformed), which would take the compiler with it.
+ *
+ */
+struct ProfileDiagnosticHandler : public llvm::DiagnosticHandler
+{
+    std::string errors;
+
+    bool handleDiagnostics(const llvm::DiagnosticInfo &DI) override
+    {
+        // Leave warnings and remarks to the default handler
+        if (DI.getSeverity() != llvm::DS_Error)
+            return false;
+
+        llvm::raw_string_ostream stream(errors);
+        llvm::DiagnosticPrinterRawOStream printer(stream);
+        DI.print(printer);
+        stream << "\n";
+        return true;
+    }
+};
+
+/**
+ * @brief Runs LLVM's optimization pipeline for the given level over the module, instrumenting it for (or applying) a profile.
+ *
+ * @param module The module to optimize
+ * @param tm The target machine the module is being compiled for (may be null)
+ * @param pgo Whether to instrument the module or use an existing profile
+ * @param optLevel The optimization level (0-3) to run the pipeline at
+ * @return std::optional<std::string> The errors reported by the pipeline (ie, if the profile could not be read); empty if there were none
+ */
+inline std::optional<std::string> runProfilePipeline(llvm::Module *module, llvm::TargetMachine *tm, llvm::PGOOptions pgo, unsigned int optLevel)
+{
+    llvm::LLVMContext &context = module->getContext();
+
+    // Report errors back to the caller instead of letting LLVM exit
+    std::unique_ptr<llvm::DiagnosticHandler> prevHandler = context.getDiagnosticHandler();
+    context.setDiagnosticHandler(std::make_unique<ProfileDiagnosticHandler>());
+
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+#if LLVM_VERSION_MAJOR >= 13
+    llvm::PassBuilder PB(tm, llvm::PipelineTuningOptions(), pgo);
+#else
+    llvm::PassBuilder PB(false, tm, llvm::PipelineTuningOptions(), pgo);
+#endif
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    PipelineOptLevel level = (optLevel == 0)   ? PipelineOptLevel::O0
+                             : (optLevel == 1) ? PipelineOptLevel::O1
+                             : (optLevel == 2) ? PipelineOptLevel::O2
+                                               : PipelineOptLevel::O3;
+
+    // The -O0 pipeline still adds the instrumentation (or profile annotations), just without optimizing
+    llvm::ModulePassManager MPM = (optLevel == 0) ? PB.buildO0DefaultPipeline(level) : PB.buildPerModuleDefaultPipeline(level);
+    MPM.run(*module, MAM);
+
+    std::string errors = static_cast<const ProfileDiagnosticHandler *>(context.getDiagHandlerPtr())->errors;
+    context.setDiagnosticHandler(std::move(prevHandler));
+
+    if (errors.empty())
+        return {};
+
+    return errors;
+}
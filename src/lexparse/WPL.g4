@@ -42,8 +42,10 @@ arrayOrVar          : var=VARIABLE | array=arrayAccess  ;
  *              because WPL does not appear to have this functionality, it is easier to require
  *              the use of variables instead of expressions for array access
  *      11-14. Typical boolean and variable constants. 
+ *      15. Integer conversions such as: int8(x), uint32(i), int64(a) * int64(b)
  */
 expression          : LPAR ex=expression RPAR                       # ParenExpr
+                    | ty=(TYPE_INT | TYPE_INT8 | TYPE_INT16 | TYPE_INT64 | TYPE_UINT8 | TYPE_UINT16 | TYPE_UINT32 | TYPE_UINT64) LPAR ex=expression RPAR # IntCastExpr
                     | fieldAccessExpr                               # FieldAccess
                     | <assoc=right> op=(MINUS | NOT) ex=expression  # UnaryExpr 
                     | left=expression op=(MULTIPLY | DIVIDE) right=expression # BinaryArithExpr
@@ -78,6 +80,9 @@ condition           : (LPAR ex=expression RPAR) | ex=expression ;
 selectAlternative   : check=expression ':' eval=statement ; 
 matchAlternative    : check=type name=VARIABLE '=>' eval=statement ;
 
+//Used to model the hints (ie, @unroll(4)) that can be given before a loop to guide how it is optimized
+loopHint            : '@' name=VARIABLE LPAR value=INTEGER RPAR ;
+
 
 /*
  * Helps to consistently manage parameters. 
@@ -109,8 +114,8 @@ assignment : v+=VARIABLE (',' v+=VARIABLE)* (ASSIGN ex=expression)? ; //FIXME: N
  * 2. Definition of functions
  * 3. Definition of procedures
  * 4. Assignments (updates to existing variables) such as: a <- 2; 
- * 5. Variable definitions such as: var a; int [5] b; var a, b; var a, b <- 1; var a, b <- 1, c, d, e <- 2; etc.
- * 6. Looping statements (while loops)
+ * 5. Variable definitions such as: var a; int [5] b; int [* n] c; var a, b; var a, b <- 1; var a, b <- 1, c, d, e <- 2; etc.
+ * 6. Looping statements (while loops, optionally preceded by loop hints)
  * 7. Conditional statements (if with optional else)
  * 8. Select statements (which require at least one select alternative)
  * 9. Calls to Procedures (as they do not return a value)
@@ -120,7 +125,7 @@ assignment : v+=VARIABLE (',' v+=VARIABLE)* (ASSIGN ex=expression)? ; //FIXME: N
 statement           : ((ty=type FUNC) | PROC) name=VARIABLE LPAR (paramList=parameterList)? RPAR block   # FuncDef 
                     | <assoc=right> to=arrayOrVar ASSIGN ex=expression ';'                  # AssignStatement 
                     | <assoc=right> ty=typeOrVar assignments+=assignment (',' assignments+=assignment)* ';'   # VarDeclStatement
-                    | WHILE check=condition DO block                                    # LoopStatement 
+                    | (hints+=loopHint)* WHILE check=condition DO block                 # LoopStatement 
                     | IF check=condition IF_THEN? trueBlk=block (ELSE falseBlk=block)?  # ConditionalStatement
                     | SELECT LSQB (cases+=selectAlternative)* '}'                        # SelectStatement  
                     | MATCH check=condition LSQB (cases+=matchAlternative)* '}'          # MatchStatement
@@ -167,15 +172,23 @@ ELLIPSIS  :     '...'   ;
 //Used for when we can either provide a type or a variable (needed bc var arrays are not allowed).
 typeOrVar       : type | 'var'  ;
 
-//Allows us to have a type of ints, bools, or strings with the option for them to become 1d arrays. 
-type            :    ty=type LBRC len=INTEGER RBRC                                  # ArrayType
-                |    ty=(TYPE_INT | TYPE_BOOL | TYPE_STR)                           # BaseType
+//Allows us to have a type of ints, bools, or strings with the option for them to become 1d arrays (or, without a length, slices of arrays).
+//Arrays marked with a * are dynamic: they live on the heap, and their length (if given) can be computed at runtime.
+type            :    ty=type LBRC dyn=MULTIPLY? len=expression? RBRC                # ArrayType
+                |    ty=(TYPE_INT | TYPE_INT8 | TYPE_INT16 | TYPE_INT64 | TYPE_UINT8 | TYPE_UINT16 | TYPE_UINT32 | TYPE_UINT64 | TYPE_BOOL | TYPE_STR) # BaseType
                 |    paramTypes+=type (',' paramTypes+=type)* '->' returnType=type  # LambdaType
                 |    LPAR type ('+' type)+ RPAR                                     # SumType 
                 |    VARIABLE                                                       # CustomType
                 ;
 
 TYPE_INT        :   'int' ; 
+TYPE_INT8       :   'int8' ;
+TYPE_INT16      :   'int16' ;
+TYPE_INT64      :   'int64' ;
+TYPE_UINT8      :   'uint8' ;
+TYPE_UINT16     :   'uint16' ;
+TYPE_UINT32     :   'uint32' ;
+TYPE_UINT64     :   'uint64' ;
 TYPE_BOOL       :   'boolean' ;
 TYPE_STR        :   'str' ; 
 
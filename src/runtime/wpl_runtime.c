@@ -11,6 +11,10 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "wpl_runtime.h"
 
 // The WPL program entry function
 int program();
@@ -67,4 +71,69 @@ int getIntArg(int i) {
     exit(-1);
   }
   return atoi(args[i]);
+}
+
+/**
+ * @brief Reports an out of bounds array access and aborts. Called by
+ *  programs compiled with -fbounds-check.
+ * 
+ * @param index The index that was accessed
+ * @param length The length of the array
+ */
+void _arrayIndexOutOfBounds(int index, int length) {
+  fprintf(stderr, "Array index %d out of bounds for length %d -- aborting!\n", index, length);
+  exit(-1);
+}
+
+/**
+ * @brief Sets the length of a dynamic array, zeroing any new elements.
+ *  When more room is needed, the capacity is at least doubled so that
+ *  growing an array one element at a time takes amortized constant time.
+ * 
+ * @param arr The array to resize
+ * @param length The new length of the array
+ * @param elemSize The size of each element in bytes
+ */
+void _wplArrayResize(WplArray *arr, int length, int elemSize) {
+  if (length < 0) {
+    fprintf(stderr, "Cannot resize array to negative length %d -- aborting!\n", length);
+    exit(-1);
+  }
+
+  if (length > arr->capacity) {
+    long long capacity = arr->capacity > 0 ? arr->capacity : 1;
+    while (capacity < length) {
+      capacity *= 2;
+    }
+    if (capacity > INT_MAX) {
+      capacity = INT_MAX;
+    }
+
+    void *data = realloc(arr->data, (size_t)capacity * elemSize);
+    if (!data) {
+      fprintf(stderr, "Out of memory resizing array to length %d -- aborting!\n", length);
+      exit(-1);
+    }
+
+    arr->data = data;
+    arr->capacity = (int)capacity;
+  }
+
+  if (length > arr->length) {
+    memset((char *)arr->data + (size_t)arr->length * elemSize, 0, (size_t)(length - arr->length) * elemSize);
+  }
+  arr->length = length;
+}
+
+/**
+ * @brief Releases the elements of a dynamic array. Called when the
+ *  array goes out of scope.
+ * 
+ * @param arr The array to free
+ */
+void _wplArrayFree(WplArray *arr) {
+  free(arr->data);
+  arr->data = NULL;
+  arr->length = 0;
+  arr->capacity = 0;
 }
\ No newline at end of file
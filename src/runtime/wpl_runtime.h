@@ -9,4 +9,18 @@
  */
 int getArgCount();
 char *getStrArg(int i);
-int getIntArg(int i);
\ No newline at end of file
+int getIntArg(int i);
+void _arrayIndexOutOfBounds(int index, int length);
+
+/**
+ * @brief The layout of a dynamic array (ie, int [*] xs) as generated
+ *  by the compiler.
+ */
+typedef struct {
+  void *data;
+  int length;
+  int capacity;
+} WplArray;
+
+void _wplArrayResize(WplArray *arr, int length, int elemSize);
+void _wplArrayFree(WplArray *arr);
\ No newline at end of file
@@ -1,9 +1,18 @@
 #include "SemanticVisitor.h"
 
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <memory>
+
 const Type *SemanticVisitor::visitCtx(WPLParser::CompilationUnitContext *ctx)
 {
-    // Enter initial scope
-    stmgr->enterScope();
+    // Subtype queries are only cached for the current compilation
+    SubtypeCache::clear();
+
+    // Enter initial scope (unless one already exists due to imported module interfaces)
+    if (!stmgr->getCurrentScope())
+        stmgr->enterScope();
 
     for (auto e : ctx->defs)
     {
@@ -27,7 +36,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::CompilationUnitContext *ctx)
 
             if (opt)
             {
-                errorHandler.addSemanticError(ctx->getStart(), "Unsupported redeclaration of " + id);
+                errorHandler.addSemanticError(ctx, "Unsupported redeclaration of " + id);
                 // return Types::UNDEFINED;
             }
 
@@ -52,13 +61,24 @@ const Type *SemanticVisitor::visitCtx(WPLParser::CompilationUnitContext *ctx)
     }
 
     // Visit the statements contained in the unit
-    for (auto e : ctx->stmts)
+    if (flags & CompilerFlags::PARALLEL_SEMANTIC)
     {
-        if (!(dynamic_cast<WPLParser::FuncDefContext *>(e) || dynamic_cast<WPLParser::VarDeclStatementContext *>(e)))
+        visitStmtsParallel(ctx);
+    }
+    else
+    {
+        for (auto e : ctx->stmts)
         {
-            errorHandler.addSemanticCritWarning(ctx->getStart(), "Currently, only FUNC, PROC, EXTERN, and variable declarations allowed at top-level. Not: " + e->getText());
+            // Stop early if we've already reported as many errors as we are allowed to
+            if (errorHandler.isFull())
+                break;
+
+            if (!(dynamic_cast<WPLParser::FuncDefContext *>(e) || dynamic_cast<WPLParser::VarDeclStatementContext *>(e)))
+            {
+                errorHandler.addSemanticCritWarning(ctx, [=]() { return "Currently, only FUNC, PROC, EXTERN, and variable declarations allowed at top-level. Not: " + e->getText(); });
+            }
+            e->accept(this);
         }
-        e->accept(this);
     }
 
     /*******************************************
@@ -74,7 +94,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::CompilationUnitContext *ctx)
 
         if (stmgr->lookup("main"))
         {
-            errorHandler.addSemanticError(ctx->getStart(), "When compiling with no-runtime, main is reserved!");
+            errorHandler.addSemanticError(ctx, "When compiling with no-runtime, main is reserved!");
         }
 
         // Check that program is invokeable and correctly defined.
@@ -82,7 +102,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::CompilationUnitContext *ctx)
             std::optional<Symbol *> opt = stmgr->lookup("program");
             if (!opt)
             {
-                errorHandler.addSemanticError(ctx->getStart(), "When compiling with no-runtime, program() must be defined!");
+                errorHandler.addSemanticError(ctx, "When compiling with no-runtime, program() must be defined!");
             }
             else
             {
@@ -92,26 +112,28 @@ const Type *SemanticVisitor::visitCtx(WPLParser::CompilationUnitContext *ctx)
                 {
                     if (inv->getParamTypes().size() != 0)
                     {
-                        errorHandler.addSemanticError(ctx->getStart(), "When compiling with no-runtime, program must not require arguments!");
+                        errorHandler.addSemanticError(ctx, "When compiling with no-runtime, program must not require arguments!");
                     }
 
                     {
                         std::optional<const Type *> retOpt = inv->getReturnType();
 
-                        if (!retOpt || !dynamic_cast<const TypeInt *>(retOpt.value()))
+                        if (!retOpt || retOpt.value()->isNotSubtype(Types::INT))
                         {
-                            errorHandler.addSemanticError(ctx->getStart(), "When compiling with no-runtime, program() must return INT");
+                            errorHandler.addSemanticError(ctx, "When compiling with no-runtime, program() must return INT");
                         }
                     }
                 }
                 else
                 {
-                    errorHandler.addSemanticError(ctx->getStart(), "When compiling with no-runtime, program() must be an invokable!");
+                    errorHandler.addSemanticError(ctx, "When compiling with no-runtime, program() must be an invokable!");
                 }
             }
         }
     }
 
+    resolveEffects(ctx);
+
     std::vector<const Symbol *> uninf = stmgr->getCurrentScope().value()->getUninferred(); // TODO: shouldn't ever be an issue, but still.
 
     // If there are any uninferred symbols, then add it as a compiler error as we won't be able to resolve them
@@ -125,14 +147,302 @@ const Type *SemanticVisitor::visitCtx(WPLParser::CompilationUnitContext *ctx)
             details << e->toString() << "; ";
         }
 
-        errorHandler.addSemanticError(ctx->getStart(), "Uninferred types in context: " + details.str());
+        errorHandler.addSemanticError(ctx, "Uninferred types in context: " + details.str());
     }
     // Return UNDEFINED as this should be viewed as a statement and not something assignable
     return Types::UNDEFINED;
 }
 
+void SemanticVisitor::visitStmtsParallel(WPLParser::CompilationUnitContext *ctx)
+{
+    /*
+     * Phase 1: Walk the top-level statements in order, declaring globals and checking the
+     * signature of each FUNC/PROC, but deferring its body. The errors from each statement
+     * are set aside so that they can later be merged with those of its body in source order.
+     */
+    struct BodyJob
+    {
+        unsigned int stmtIdx;
+        WPLParser::FuncDefContext *fnCtx;
+        std::pair<const TypeInvoke *, Symbol *> decl;
+
+        std::unique_ptr<PropertyManager> bindings = std::make_unique<PropertyManager>();
+        std::vector<WPLError *> errors = {};
+    };
+
+    std::vector<BodyJob> jobs;
+    std::vector<std::vector<WPLError *>> stmtErrors(ctx->stmts.size());
+    std::map<const Symbol *, unsigned int> globalOrder; // Statement index at which each global was declared
+
+    std::vector<WPLError *> &errors = errorHandler.getErrors();
+
+    for (unsigned int i = 0; i < ctx->stmts.size(); i++)
+    {
+        auto e = ctx->stmts.at(i);
+        unsigned int mark = errors.size();
+
+        if (WPLParser::FuncDefContext *fnCtx = dynamic_cast<WPLParser::FuncDefContext *>(e))
+        {
+            std::optional<std::pair<const TypeInvoke *, Symbol *>> pairOpt = invokableHelper(fnCtx, fnCtx->name->getText(), fnCtx->paramList, fnCtx->ty);
+
+            if (pairOpt && declareInvokeable(fnCtx, fnCtx->name->getText(), pairOpt.value()))
+            {
+                BodyJob job = {i, fnCtx, pairOpt.value()};
+                jobs.push_back(std::move(job));
+            }
+        }
+        else
+        {
+            if (!dynamic_cast<WPLParser::VarDeclStatementContext *>(e))
+            {
+                errorHandler.addSemanticCritWarning(ctx, [=]() { return "Currently, only FUNC, PROC, EXTERN, and variable declarations allowed at top-level. Not: " + e->getText(); });
+            }
+            e->accept(this);
+
+            if (WPLParser::VarDeclStatementContext *declCtx = dynamic_cast<WPLParser::VarDeclStatementContext *>(e))
+            {
+                for (auto a : declCtx->assignments)
+                {
+                    for (auto var : a->VARIABLE())
+                    {
+                        std::optional<Symbol *> symOpt = bindings->getBinding(var);
+                        if (symOpt)
+                            globalOrder.insert({symOpt.value(), i});
+                    }
+                }
+            }
+        }
+
+        stmtErrors.at(i).assign(errors.begin() + mark, errors.end());
+        errors.resize(mark);
+    }
+
+    /*
+     * A global VAR keeps its TypeInfer, which is updated (by path compression, and by unification when
+     * a body infers it) every time its type is looked at. As the bodies would all share (and write to)
+     * it, we cannot check them independently if there is such a global, so fall back to checking them in order.
+     */
+    bool canParallelize = true;
+    for (auto &global : globalOrder)
+    {
+        if (dynamic_cast<const TypeInfer *>(global.first->type))
+            canParallelize = false;
+    }
+
+    /*
+     * Phase 2: Check each body in its own visitor with its own scope stack layered over the
+     * (now frozen) global scope. Globals declared after a FUNC/PROC are hidden from its body
+     * so that the results match those of checking the file in order.
+     */
+    Scope *global = stmgr->getCurrentScope().value();
+
+    auto checkBody = [this, global, &globalOrder](BodyJob &job)
+    {
+        unsigned int stmtIdx = job.stmtIdx;
+        // The bindings are kept until they are merged, but the scopes are only needed while checking the body
+        std::unique_ptr<STManager> localStmgr = std::make_unique<STManager>(global, [&globalOrder, stmtIdx](const Symbol *sym)
+                                                                            {
+                                                                                auto declared = globalOrder.find(sym);
+                                                                                return declared == globalOrder.end() || declared->second < stmtIdx; });
+
+        SemanticVisitor local(localStmgr.get(), job.bindings.get(), flags);
+        local.setErrorLimit(errorHandler.getErrorLimit(), errorHandler.getPriorErrors());
+        local.visitInvokeableBody(job.fnCtx, job.decl, job.fnCtx->paramList, job.fnCtx->ty, job.fnCtx->block());
+
+        job.errors = local.errorHandler.getErrors();
+    };
+
+    unsigned int numThreads = canParallelize ? std::min<unsigned int>(std::thread::hardware_concurrency(), jobs.size()) : 1;
+
+    if (numThreads <= 1)
+    {
+        for (BodyJob &job : jobs)
+            checkBody(job);
+    }
+    else
+    {
+        std::atomic<unsigned int> next = 0;
+        std::vector<std::thread> workers;
+
+        for (unsigned int t = 0; t < numThreads; t++)
+        {
+            workers.push_back(std::thread([&jobs, &next, &checkBody]()
+                                          {
+                                              for (unsigned int idx = next++; idx < jobs.size(); idx = next++)
+                                                  checkBody(jobs.at(idx)); }));
+        }
+
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    /*
+     * Phase 3: Merge the results in source order so that the output does not depend on scheduling.
+     */
+    auto job = jobs.begin();
+    for (unsigned int i = 0; i < ctx->stmts.size(); i++)
+    {
+        for (WPLError *e : stmtErrors.at(i))
+            errorHandler.addError(e);
+
+        if (job != jobs.end() && job->stmtIdx == i)
+        {
+            for (WPLError *e : job->errors)
+                errorHandler.addError(e);
+
+            bindings->merge(job->bindings.get());
+            job++;
+        }
+    }
+}
+
+/**
+ * @brief Effects of the externs whose behavior is known. All of them are plain C functions, so none can unwind.
+ */
+static const std::map<std::string, InvokeEffects> knownExterns = {
+    // Name, {readsMemory, writesMemory, willReturn, noRecurse, noUnwind}
+    {"printf", {true, true, true, true, true}},
+    {"puts", {true, true, true, true, true}},
+    {"putchar", {false, true, true, true, true}},
+    {"strlen", {true, false, true, true, true}},
+    {"strcmp", {true, false, true, true, true}},
+    {"abs", {false, false, true, true, true}},
+    {"getArgCount", {true, false, true, true, true}},
+    {"getStrArg", {true, false, true, true, true}},
+    {"getIntArg", {true, false, true, true, true}},
+};
+
+void SemanticVisitor::resolveEffects(WPLParser::CompilationUnitContext *ctx)
+{
+    // Externs which we know the behavior of
+    std::set<std::string> externs;
+    for (auto e : ctx->extens)
+    {
+        externs.insert(e->name->getText());
+
+        auto known = knownExterns.find(e->name->getText());
+        if (known != knownExterns.end())
+            bindings->bindEffects(e, known->second);
+    }
+
+    // The FUNC/PROCs defined in this unit, by name
+    std::map<std::string, antlr4::tree::ParseTree *> named;
+    for (auto e : ctx->stmts)
+    {
+        if (WPLParser::FuncDefContext *fnCtx = dynamic_cast<WPLParser::FuncDefContext *>(e))
+            named.insert({fnCtx->name->getText(), fnCtx});
+    }
+
+    // The lambdas and FUNC/PROCs defined in this unit which the given one may invoke directly
+    auto localCallees = [this, &named](antlr4::tree::ParseTree *current) {
+        DirectEffects direct = bindings->getDirectEffects(current).value();
+
+        std::vector<antlr4::tree::ParseTree *> ans(direct.lambdas.begin(), direct.lambdas.end());
+        for (std::string callee : direct.callees)
+        {
+            auto local = named.find(callee);
+            if (local != named.end() && bindings->getDirectEffects(local->second))
+                ans.push_back(local->second);
+        }
+        return ans;
+    };
+
+    // Invokables which could end up invoking themselves, and so may never return
+    std::set<antlr4::tree::ParseTree *> cyclic;
+    for (antlr4::tree::ParseTree *def : bindings->getEffectDefinitions())
+    {
+        std::set<antlr4::tree::ParseTree *> visited;
+        std::vector<antlr4::tree::ParseTree *> worklist = {def};
+
+        while (!worklist.empty() && !cyclic.count(def))
+        {
+            antlr4::tree::ParseTree *current = worklist.back();
+            worklist.pop_back();
+
+            for (antlr4::tree::ParseTree *n : localCallees(current))
+            {
+                if (n == def)
+                    cyclic.insert(def);
+
+                if (visited.insert(n).second)
+                    worklist.push_back(n);
+            }
+        }
+    }
+
+    /*
+     * The effects of an invokable are those of its own body combined with those of everything it may
+     * end up invoking. Anything which could invoke itself, or reach something that could, is assumed
+     * to possibly never return.
+     */
+    for (antlr4::tree::ParseTree *def : bindings->getEffectDefinitions())
+    {
+        InvokeEffects ans = {false, false, true, true, true};
+
+        std::set<antlr4::tree::ParseTree *> visited;
+        std::vector<antlr4::tree::ParseTree *> worklist = {def};
+
+        while (!worklist.empty())
+        {
+            antlr4::tree::ParseTree *current = worklist.back();
+            worklist.pop_back();
+
+            DirectEffects direct = bindings->getDirectEffects(current).value();
+
+            ans.readsMemory |= direct.readsGlobals;
+            ans.writesMemory |= direct.writesGlobals;
+            ans.willReturn &= !direct.hasLoops && !cyclic.count(current);
+            ans.indexesArrays |= direct.indexesArrays;
+            ans.mayAbort |= direct.mayAbort;
+
+            if (direct.hasUnknownCalls)
+            {
+                ans.readsMemory = ans.writesMemory = true;
+                ans.willReturn = ans.noRecurse = false;
+            }
+
+            for (std::string callee : direct.callees)
+            {
+                auto local = named.find(callee);
+                if (local != named.end() && bindings->getDirectEffects(local->second))
+                    continue;
+
+                // Externs (and FUNC/PROCs from other modules) are only understood if they are known
+                auto known = knownExterns.find(callee);
+                InvokeEffects other = (known != knownExterns.end() && externs.count(callee)) ? known->second : InvokeEffects();
+
+                ans.readsMemory |= other.readsMemory;
+                ans.writesMemory |= other.writesMemory;
+                ans.willReturn &= other.willReturn;
+                ans.noRecurse &= other.noRecurse;
+                ans.indexesArrays |= other.indexesArrays;
+                ans.mayAbort |= other.mayAbort;
+            }
+
+            for (antlr4::tree::ParseTree *n : localCallees(current))
+            {
+                if (n == def)
+                    ans.noRecurse = false;
+
+                if (visited.insert(n).second)
+                    worklist.push_back(n);
+            }
+        }
+
+        bindings->bindEffects(def, ans);
+    }
+}
+
 const Type *SemanticVisitor::visitCtx(WPLParser::InvocationContext *ctx)
 {
+    // Arrays have methods (ie, xs.sum() or xs.push(1)) that are built in rather than defined anywhere
+    if (!ctx->lam && ctx->field->VARIABLE().size() == 2)
+    {
+        std::optional<Symbol *> rootOpt = stmgr->lookup(ctx->field->VARIABLE().at(0)->getText());
+        if (rootOpt && Types::getArrayValueType(rootOpt.value()->type))
+            return visitArrayMethod(ctx, rootOpt.value());
+    }
+
     const Type *type = [this](WPLParser::InvocationContext *ctx) // Huh, interesting how we probably can't get the ctx from this
     {
         if (ctx->lam)
@@ -147,7 +457,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InvocationContext *ctx)
 
         if (!opt)
         {
-            errorHandler.addSemanticError(ctx->getStart(), "Cannot invoke undefined function: " + ctx->field->getText());
+            errorHandler.addSemanticError(ctx, [=]() { return "Cannot invoke undefined function: " + ctx->field->getText(); });
             return Types::UNDEFINED;
         }
 
@@ -164,6 +474,19 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InvocationContext *ctx)
 
     std::string name = (ctx->lam) ? "lambda " : ctx->field->getText();
 
+    // Record what is being invoked so that the effects of the enclosing invokable can be determined
+    if (!effectsStack.empty())
+    {
+        std::optional<Symbol *> calleeOpt = bindings->getBinding(ctx);
+
+        if (ctx->lam)
+            effectsStack.back().lambdas.insert(ctx->lam);
+        else if (calleeOpt && calleeOpt.value()->isDefinition)
+            effectsStack.back().callees.insert(calleeOpt.value()->identifier);
+        else
+            effectsStack.back().hasUnknownCalls = true;
+    }
+
     if (const TypeInvoke *invokeable = dynamic_cast<const TypeInvoke *>(type))
     {
         /*
@@ -185,7 +508,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InvocationContext *ctx)
         {
             std::ostringstream errorMsg;
             errorMsg << "Invocation of " << name << " expected " << fnParams.size() << " argument(s), but got " << ctx->args.size();
-            errorHandler.addSemanticError(ctx->getStart(), errorMsg.str());
+            errorHandler.addSemanticError(ctx, errorMsg.str());
             return Types::UNDEFINED; // TODO: Could change this to the return type to catch more errors?
         }
 
@@ -207,7 +530,14 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InvocationContext *ctx)
             {
                 if (dynamic_cast<const TypeBot *>(providedType))
                 {
-                    errorHandler.addSemanticError(ctx->getStart(), "Cannot provide " + providedType->toString() + " to a function.");
+                    errorHandler.addSemanticError(ctx, "Cannot provide " + providedType->toString() + " to a function.");
+                }
+
+                // As in C, integers smaller than an INT are promoted to INT when passed as variadic arguments
+                const TypeInt *intType = dynamic_cast<const TypeInt *>(providedType);
+                if (intType && intType->getBits() < 32)
+                {
+                    bindings->bindIntConversion(ctx->args.at(i), intType, static_cast<const TypeInt *>(Types::INT));
                 }
                 continue;
             }
@@ -220,12 +550,22 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InvocationContext *ctx)
                 i < fnParams.size() ? i : (fnParams.size() - 1));
 
             // If the types do not match, report an error.
-            if (providedType->isNotSubtype(expectedType))
+            if (!isAssignable(ctx->args.at(i), providedType, expectedType))
             {
                 std::ostringstream errorMsg;
                 errorMsg << "Argument " << i << " provided to " << name << " expected " << expectedType->toString() << " but got " << providedType->toString();
 
-                errorHandler.addSemanticError(ctx->getStart(), errorMsg.str());
+                errorHandler.addSemanticError(ctx, errorMsg.str());
+            }
+
+            // The callee may write through a slice, so the array being sliced counts as updated (ie, it cannot share a by-reference parameter's storage)
+            if (dynamic_cast<const TypeSlice *>(expectedType))
+            {
+                if (WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(ctx->args.at(i)))
+                {
+                    if (std::optional<Symbol *> rootOpt = bindings->getBinding(access->fieldAccessExpr()->VARIABLE().at(0)))
+                        bindings->markMutated(rootOpt.value());
+                }
             }
         }
 
@@ -234,7 +574,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InvocationContext *ctx)
     }
 
     // Symbol was not an invokeable type, so report an error & return UNDEFINED.
-    errorHandler.addSemanticError(ctx->getStart(), "Can only invoke PROC and FUNC, not " + name + " : " + type->toString());
+    errorHandler.addSemanticError(ctx, "Can only invoke PROC and FUNC, not " + name + " : " + type->toString());
     return Types::UNDEFINED;
 }
 
@@ -245,7 +585,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InitProductContext *ctx)
 
     if (!opt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Cannot initialize undefined product: " + name);
+        errorHandler.addSemanticError(ctx, "Cannot initialize undefined product: " + name);
         return Types::UNDEFINED;
     }
 
@@ -261,7 +601,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InitProductContext *ctx)
         {
             std::ostringstream errorMsg;
             errorMsg << "Initialization of " << name << " expected " << elements.size() << " argument(s), but got " << ctx->exprs.size();
-            errorHandler.addSemanticError(ctx->getStart(), errorMsg.str());
+            errorHandler.addSemanticError(ctx, errorMsg.str());
             return Types::UNDEFINED; // TODO: Could change this to the return type to catch more errors?
         }
 
@@ -272,12 +612,12 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InitProductContext *ctx)
             {
                 const Type *providedType = any2Type(ctx->exprs.at(i)->accept(this));
 
-                if (providedType->isNotSubtype(eleItr.second))
+                if (!isAssignable(ctx->exprs.at(i), providedType, eleItr.second))
                 {
                     std::ostringstream errorMsg;
                     errorMsg << "Product init. argument " << i << " provided to " << name << " expected " << eleItr.second->toString() << " but got " << providedType->toString();
 
-                    errorHandler.addSemanticError(ctx->getStart(), errorMsg.str());
+                    errorHandler.addSemanticError(ctx, errorMsg.str());
                 }
                 // FIXME: WHAT HAPPENS IF VAR PASSED TO THIS?
                 i++;
@@ -287,20 +627,34 @@ const Type *SemanticVisitor::visitCtx(WPLParser::InitProductContext *ctx)
         return sym->type;
     }
 
-    errorHandler.addSemanticError(ctx->getStart(), "Cannot initialize non-product type " + name + " : " + sym->type->toString());
+    errorHandler.addSemanticError(ctx, "Cannot initialize non-product type " + name + " : " + sym->type->toString());
     return Types::UNDEFINED;
 }
 
 const Type *SemanticVisitor::visitCtx(WPLParser::ArrayAccessContext *ctx)
 {
+    // The index may need to be checked at runtime, which would abort the program if it failed
+    if (!effectsStack.empty())
+        effectsStack.back().indexesArrays = true;
+
     /*
      * Check that we are provided an INT for the index.
      */
 
     const Type *exprType = any2Type(ctx->index->accept(this));
-    if (exprType->isNotSubtype(Types::INT))
+    const TypeInt *indexType = asInt(exprType);
+    if (!indexType)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Array access index expected type INT but got " + exprType->toString());
+        errorHandler.addSemanticError(ctx, "Array access index expected type INT but got " + exprType->toString());
+    }
+    else if (indexType->isNotSubtype(Types::INT) && indexType->getBits() <= 32)
+    {
+        /*
+         * Narrower indices are converted to INTs without changing their value (and UINT32s above INT_MAX become negative, which
+         * the unsigned bounds check still rejects). Wider ones are left as they are, as truncating them could bring an out of
+         * bounds index back into range; bounds checks compare them at their own width instead.
+         */
+        bindings->bindIntConversion(ctx->index, indexType, static_cast<const TypeInt *>(Types::INT));
     }
 
     /*
@@ -312,7 +666,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ArrayAccessContext *ctx)
 
     if (!opt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Cannot access value from undefined array: " + ctx->field->getText());
+        errorHandler.addSemanticError(ctx, [=]() { return "Cannot access value from undefined array: " + ctx->field->getText(); });
         return Types::UNDEFINED;
     }
 
@@ -327,8 +681,32 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ArrayAccessContext *ctx)
         return arr->getValueType(); // Return type of array
     }
 
+    if (const TypeDynArray *dyn = dynamic_cast<const TypeDynArray *>(sym->type))
+    {
+        // The length is only known at runtime, so the index is always checked
+        if (!effectsStack.empty())
+            effectsStack.back().mayAbort = true;
+
+        bindings->bind(ctx, sym);
+        return dyn->getValueType();
+    }
+
+    if (const TypeSlice *slice = dynamic_cast<const TypeSlice *>(sym->type))
+    {
+        // Slices refer to the caller's array, so reading one is a read of memory we do not own. Their length
+        // is only known at runtime, so the index is always checked
+        if (!effectsStack.empty())
+        {
+            effectsStack.back().readsGlobals = true;
+            effectsStack.back().mayAbort = true;
+        }
+
+        bindings->bind(ctx, sym);
+        return slice->getValueType();
+    }
+
     // Report error
-    errorHandler.addSemanticError(ctx->getStart(), "Cannot use array access on non-array expression " + ctx->field->getText() + " : " + type->toString());
+    errorHandler.addSemanticError(ctx, [=]() { return "Cannot use array access on non-array expression " + ctx->field->getText() + " : " + type->toString(); });
     return Types::UNDEFINED;
 }
 
@@ -348,7 +726,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ArrayOrVarContext *ctx)
         // If we can't find the variable, report an error as it is undefined.
         if (!opt)
         {
-            errorHandler.addSemanticError(ctx->getStart(), "Undefined variable in expression: " + id);
+            errorHandler.addSemanticError(ctx, "Undefined variable in expression: " + id);
             return Types::UNDEFINED;
         }
 
@@ -371,7 +749,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ArrayOrVarContext *ctx)
     // If we didn't get a binding, report an error.
     if (!binding)
     {
-        errorHandler.addSemanticError(ctx->array->getStart(), "Could not correctly bind to array access!");
+        errorHandler.addSemanticError(ctx->array, "Could not correctly bind to array access!");
         return Types::UNDEFINED;
     }
 
@@ -380,11 +758,401 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ArrayOrVarContext *ctx)
     return arrType;
 }
 
-const Type *SemanticVisitor::visitCtx(WPLParser::IConstExprContext *ctx) { return Types::INT; }
+const Type *SemanticVisitor::visitCtx(WPLParser::IConstExprContext *ctx)
+{
+    // Literals which are too large to be an INT are INT64s
+    std::string text = ctx->i->getText();
+    if (text.length() <= 10 && std::stoll(text) <= INT32_MAX)
+        return Types::INT;
+
+    if (text.length() <= 19 && std::stoull(text) <= INT64_MAX)
+        return Types::INT64;
+
+    errorHandler.addSemanticError(ctx, "Integer literal is too large for INT64: " + text);
+    return Types::UNDEFINED;
+}
+
+/**
+ * @brief Gets the integer type named by a type keyword
+ *
+ * @param tok The keyword (ie, int8)
+ * @return const Type* The integer type, or UNDEFINED if the keyword does not name one
+ */
+static const Type *getIntType(antlr4::Token *tok)
+{
+    switch (tok->getType())
+    {
+    case WPLParser::TYPE_INT:
+        return Types::INT;
+    case WPLParser::TYPE_INT8:
+        return Types::INT8;
+    case WPLParser::TYPE_INT16:
+        return Types::INT16;
+    case WPLParser::TYPE_INT64:
+        return Types::INT64;
+    case WPLParser::TYPE_UINT8:
+        return Types::UINT8;
+    case WPLParser::TYPE_UINT16:
+        return Types::UINT16;
+    case WPLParser::TYPE_UINT32:
+        return Types::UINT32;
+    case WPLParser::TYPE_UINT64:
+        return Types::UINT64;
+    }
+
+    return Types::UNDEFINED;
+}
+
+const Type *SemanticVisitor::visitCtx(WPLParser::IntCastExprContext *ctx)
+{
+    const Type *target = getIntType(ctx->ty);
+    const Type *innerType = any2Type(ctx->ex->accept(this));
+
+    const TypeInt *inner = asInt(innerType);
+    if (!inner)
+    {
+        errorHandler.addSemanticError(ctx, "Can only convert integers to " + target->toString() + ", but got " + innerType->toString());
+        return Types::UNDEFINED;
+    }
+
+    // Explicit conversions may truncate or change the sign of the value
+    if (inner->isNotSubtype(target))
+        bindings->bindIntConversion(ctx->ex, inner, static_cast<const TypeInt *>(target));
+
+    return target;
+}
+
+const TypeInt *SemanticVisitor::asInt(const Type *ty)
+{
+    if (const TypeInt *i = dynamic_cast<const TypeInt *>(ty))
+        return i;
+
+    if (const TypeInfer *inf = dynamic_cast<const TypeInfer *>(ty))
+    {
+        if (std::optional<const Type *> valOpt = inf->getValueType())
+            return dynamic_cast<const TypeInt *>(valOpt.value());
+
+        // Vars which do not yet have a type become INTs, as they would when used with any other INT operation
+        if (ty->isSubtype(Types::INT))
+            return static_cast<const TypeInt *>(Types::INT);
+    }
+
+    return nullptr;
+}
+
+bool SemanticVisitor::isAssignable(WPLParser::ExpressionContext *ctx, const Type *exprType, const Type *target)
+{
+    if (exprType->isSubtype(target))
+        return true;
+
+    const TypeInt *from = asInt(exprType);
+    const TypeInt *to = asInt(target);
+
+    if (!from || !to)
+        return false;
+
+    // Constants may be converted to any integer type that can hold their value; otherwise, the conversion must not lose information
+    std::optional<ConstValue> val = bindings->getConstant(ctx);
+    bool fits = val && std::holds_alternative<int64_t>(val.value()) && (from->getIsSigned() || std::get<int64_t>(val.value()) >= 0) && to->canRepresent(std::get<int64_t>(val.value()));
+
+    if (!fits && !to->canRepresent(from))
+        return false;
+
+    bindings->bindIntConversion(ctx, from, to);
+    return true;
+}
+
+const TypeInt *SemanticVisitor::unifyInts(WPLParser::ExpressionContext *left, const TypeInt *leftType, WPLParser::ExpressionContext *right, const TypeInt *rightType)
+{
+    if (leftType->isSubtype(rightType))
+        return leftType;
+
+    // Constants take on the type of the other operand (ie, x + 1 where x is an INT8) when they fit in it
+    if (bindings->getConstant(right) && isAssignable(right, rightType, leftType))
+        return leftType;
+
+    if (bindings->getConstant(left) && isAssignable(left, leftType, rightType))
+        return rightType;
+
+    // Otherwise, the narrower operand is widened to the type of the other
+    if (isAssignable(right, rightType, leftType))
+        return leftType;
+
+    if (isAssignable(left, leftType, rightType))
+        return rightType;
+
+    return nullptr;
+}
+
+const Type *SemanticVisitor::recordConstant(WPLParser::ExpressionContext *ctx, const Type *ty)
+{
+    // Expressions with errors aren't constants
+    if (ty == Types::UNDEFINED)
+        return ty;
+
+    // Helpers to get the constant values of subexpressions (if they have them)
+    auto getInt = [this](antlr4::tree::ParseTree *ex) -> std::optional<int64_t>
+    {
+        std::optional<ConstValue> val = bindings->getConstant(ex);
+        if (!val || !std::holds_alternative<int64_t>(val.value()))
+            return {};
+        return std::get<int64_t>(val.value());
+    };
+
+    auto getBool = [this](antlr4::tree::ParseTree *ex) -> std::optional<bool>
+    {
+        std::optional<ConstValue> val = bindings->getConstant(ex);
+        if (!val || !std::holds_alternative<bool>(val.value()))
+            return {};
+        return std::get<bool>(val.value());
+    };
+
+    /*
+     * Integer arithmetic wraps around to the width and signedness of the expression's type in the same way as it does
+     * at runtime. Values are computed as uint64_t, where overflow is well defined, and then truncated (and sign extended).
+     */
+    const TypeInt *intType = asInt(ty);
+    auto bindInt = [this, ctx, intType](uint64_t i)
+    {
+        unsigned int bits = intType->getBits();
+        if (bits < 64)
+        {
+            i &= ((uint64_t)1 << bits) - 1;
+            if (intType->getIsSigned() && (i >> (bits - 1)) & 1)
+                i |= ~(((uint64_t)1 << bits) - 1);
+        }
+        bindings->bindConstant(ctx, (int64_t)i, intType);
+    };
+
+    if (WPLParser::IConstExprContext *iConst = dynamic_cast<WPLParser::IConstExprContext *>(ctx))
+    {
+        // Literals too large for INT64 are reported as errors (and so are UNDEFINED)
+        bindInt(std::stoull(iConst->i->getText()));
+    }
+    else if (WPLParser::IntCastExprContext *cast = dynamic_cast<WPLParser::IntCastExprContext *>(ctx))
+    {
+        if (std::optional<int64_t> i = getInt(cast->ex))
+            bindInt(i.value());
+    }
+    else if (WPLParser::BConstExprContext *bConst = dynamic_cast<WPLParser::BConstExprContext *>(ctx))
+    {
+        bindings->bindConstant(ctx, bConst->booleanConst()->TRUE() != nullptr);
+    }
+    else if (WPLParser::ParenExprContext *paren = dynamic_cast<WPLParser::ParenExprContext *>(ctx))
+    {
+        if (std::optional<int64_t> i = getInt(paren->ex))
+            bindInt(i.value());
+        else if (std::optional<bool> b = getBool(paren->ex))
+            bindings->bindConstant(ctx, b.value());
+    }
+    else if (WPLParser::UnaryExprContext *unary = dynamic_cast<WPLParser::UnaryExprContext *>(ctx))
+    {
+        std::optional<int64_t> i = getInt(unary->ex);
+        std::optional<bool> b = getBool(unary->ex);
+
+        if (unary->op->getType() == WPLParser::MINUS && i)
+            bindInt(-(uint64_t)i.value());
+        else if (unary->op->getType() == WPLParser::NOT && b)
+            bindings->bindConstant(ctx, !b.value());
+    }
+    else if (WPLParser::BinaryArithExprContext *arith = dynamic_cast<WPLParser::BinaryArithExprContext *>(ctx))
+    {
+        std::optional<int64_t> left = getInt(arith->left);
+        std::optional<int64_t> right = getInt(arith->right);
+
+        if (left && right && intType)
+        {
+            int64_t l = left.value();
+            int64_t r = right.value();
+
+            switch (arith->op->getType())
+            {
+            case WPLParser::PLUS:
+                bindInt((uint64_t)l + (uint64_t)r);
+                break;
+            case WPLParser::MINUS:
+                bindInt((uint64_t)l - (uint64_t)r);
+                break;
+            case WPLParser::MULTIPLY:
+                bindInt((uint64_t)l * (uint64_t)r);
+                break;
+            case WPLParser::DIVIDE:
+                // Division by zero (and dividing the smallest value by -1) are left to happen at runtime
+                if (r == 0)
+                    break;
+
+                if (!intType->getIsSigned())
+                    bindInt((uint64_t)l / (uint64_t)r);
+                else if (r != -1)
+                    bindInt(l / r);
+                else if (l != INT64_MIN && intType->canRepresent(-l))
+                    bindInt(-(uint64_t)l);
+                break;
+            }
+        }
+    }
+    else if (WPLParser::BinaryRelExprContext *rel = dynamic_cast<WPLParser::BinaryRelExprContext *>(ctx))
+    {
+        std::optional<int64_t> left = getInt(rel->left);
+        std::optional<int64_t> right = getInt(rel->right);
+
+        // Unsigned values are compared as such so that UINT64s above INT64_MAX are not seen as negative
+        std::optional<const TypeInt *> operandType = bindings->getOperandType(ctx);
+        if (left && right && operandType && !operandType.value()->getIsSigned())
+        {
+            uint64_t l = left.value();
+            uint64_t r = right.value();
+
+            switch (rel->op->getType())
+            {
+            case WPLParser::LESS:
+                bindings->bindConstant(ctx, l < r);
+                break;
+            case WPLParser::LESS_EQ:
+                bindings->bindConstant(ctx, l <= r);
+                break;
+            case WPLParser::GREATER:
+                bindings->bindConstant(ctx, l > r);
+                break;
+            case WPLParser::GREATER_EQ:
+                bindings->bindConstant(ctx, l >= r);
+                break;
+            }
+        }
+        else if (left && right)
+        {
+            switch (rel->op->getType())
+            {
+            case WPLParser::LESS:
+                bindings->bindConstant(ctx, left.value() < right.value());
+                break;
+            case WPLParser::LESS_EQ:
+                bindings->bindConstant(ctx, left.value() <= right.value());
+                break;
+            case WPLParser::GREATER:
+                bindings->bindConstant(ctx, left.value() > right.value());
+                break;
+            case WPLParser::GREATER_EQ:
+                bindings->bindConstant(ctx, left.value() >= right.value());
+                break;
+            }
+        }
+    }
+    else if (WPLParser::EqExprContext *eq = dynamic_cast<WPLParser::EqExprContext *>(ctx))
+    {
+        std::optional<ConstValue> left = bindings->getConstant(eq->left);
+        std::optional<ConstValue> right = bindings->getConstant(eq->right);
+
+        if (left && right && left.value().index() == right.value().index())
+            bindings->bindConstant(ctx, (left.value() == right.value()) == (eq->op->getType() == WPLParser::EQUAL));
+    }
+    else if (WPLParser::LogAndExprContext *land = dynamic_cast<WPLParser::LogAndExprContext *>(ctx))
+    {
+        // As & short-circuits, a constant false makes the result false so long as everything before it is constant
+        for (auto e : land->exprs)
+        {
+            std::optional<bool> b = getBool(e);
+            if (!b)
+                return ty;
+
+            if (!b.value())
+            {
+                bindings->bindConstant(ctx, false);
+                return ty;
+            }
+        }
+
+        bindings->bindConstant(ctx, true);
+    }
+    else if (WPLParser::LogOrExprContext *lor = dynamic_cast<WPLParser::LogOrExprContext *>(ctx))
+    {
+        // Similarly, a constant true makes the result of an | true
+        for (auto e : lor->exprs)
+        {
+            std::optional<bool> b = getBool(e);
+            if (!b)
+                return ty;
+
+            if (b.value())
+            {
+                bindings->bindConstant(ctx, true);
+                return ty;
+            }
+        }
+
+        bindings->bindConstant(ctx, false);
+    }
+
+    return ty;
+}
 
 const Type *SemanticVisitor::visitCtx(WPLParser::ArrayAccessExprContext *ctx) { return this->visitCtx(ctx->arrayAccess()); }
 
-const Type *SemanticVisitor::visitCtx(WPLParser::SConstExprContext *ctx) { return Types::STR; }
+/**
+ * @brief Decodes the escape sequences in a string literal in a single pass. Escapes which are not recognized are left
+ * as they were written.
+ *
+ * @param text The literal as written (including its surrounding quotes)
+ * @return std::string The contents of the string
+ */
+static std::string decodeStringLiteral(const std::string &text)
+{
+    std::string out;
+    out.reserve(text.length());
+
+    // Reference of all escape characters: https://en.cppreference.com/w/cpp/language/escape
+    for (size_t i = 1; i + 1 < text.length(); i++)
+    {
+        if (text[i] != '\\' || i + 2 >= text.length())
+        {
+            out.push_back(text[i]);
+            continue;
+        }
+
+        char c = text[++i];
+        switch (c)
+        {
+        case '\'':
+        case '"':
+        case '?':
+        case '\\':
+            out.push_back(c);
+            break;
+        case 'a':
+            out.push_back('\a');
+            break;
+        case 'b':
+            out.push_back('\b');
+            break;
+        case 'f':
+            out.push_back('\f');
+            break;
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case 'v':
+            out.push_back('\v');
+            break;
+        default:
+            out.push_back('\\');
+            out.push_back(c);
+        }
+    }
+
+    return out;
+}
+
+const Type *SemanticVisitor::visitCtx(WPLParser::SConstExprContext *ctx)
+{
+    bindings->bindString(ctx, decodeStringLiteral(ctx->s->getText()));
+    return Types::STR;
+}
 
 /**
  * @brief Typechecks Unary Expressions
@@ -401,16 +1169,20 @@ const Type *SemanticVisitor::visitCtx(WPLParser::UnaryExprContext *ctx)
     switch (ctx->op->getType())
     {
     case WPLParser::MINUS:
-        if (innerType->isNotSubtype(Types::INT))
+    {
+        const TypeInt *intType = asInt(innerType);
+        if (!intType)
         {
-            errorHandler.addSemanticError(ctx->getStart(), "INT expected in unary minus, but got " + innerType->toString());
+            errorHandler.addSemanticError(ctx, "INT expected in unary minus, but got " + innerType->toString());
             return Types::UNDEFINED;
         }
+        bindings->bindOperandType(ctx, intType);
         break;
+    }
     case WPLParser::NOT:
         if (innerType->isNotSubtype(Types::BOOL))
         {
-            errorHandler.addSemanticError(ctx->getStart(), "BOOL expected in unary not, but got " + innerType->toString());
+            errorHandler.addSemanticError(ctx, "BOOL expected in unary not, but got " + innerType->toString());
             return Types::UNDEFINED;
         }
         break;
@@ -431,20 +1203,34 @@ const Type *SemanticVisitor::visitCtx(WPLParser::BinaryArithExprContext *ctx)
     bool valid = true;
 
     auto left = any2Type(ctx->left->accept(this));
-    if (left->isNotSubtype(Types::INT))
+    const TypeInt *leftInt = asInt(left);
+    if (!leftInt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "INT left expression expected, but was " + left->toString());
+        errorHandler.addSemanticError(ctx, "INT left expression expected, but was " + left->toString());
         valid = false;
     }
 
     auto right = any2Type(ctx->right->accept(this));
-    if (right->isNotSubtype(Types::INT))
+    const TypeInt *rightInt = asInt(right);
+    if (!rightInt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "INT right expression expected, but was " + right->toString());
+        errorHandler.addSemanticError(ctx, "INT right expression expected, but was " + right->toString());
         valid = false;
     }
 
-    return (valid) ? Types::INT : Types::UNDEFINED;
+    if (!valid)
+        return Types::UNDEFINED;
+
+    // Both sides are computed in (and result in) the same integer type
+    const TypeInt *ty = unifyInts(ctx->left, leftInt, ctx->right, rightInt);
+    if (!ty)
+    {
+        errorHandler.addSemanticError(ctx, "Cannot implicitly convert between " + leftInt->toString() + " and " + rightInt->toString() + "; use an explicit conversion (ie, int64(x))");
+        return Types::UNDEFINED;
+    }
+
+    bindings->bindOperandType(ctx, ty);
+    return ty;
 }
 
 const Type *SemanticVisitor::visitCtx(WPLParser::EqExprContext *ctx)
@@ -453,19 +1239,104 @@ const Type *SemanticVisitor::visitCtx(WPLParser::EqExprContext *ctx)
     auto left = any2Type(ctx->left->accept(this));
     if (right->isNotSubtype(left))
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Both sides of '=' must have the same type");
-        return Types::UNDEFINED;
+        // Integers of different types can still be compared if one can be converted to the other
+        const TypeInt *leftInt = asInt(left);
+        const TypeInt *rightInt = asInt(right);
+
+        if (!leftInt || !rightInt || !unifyInts(ctx->left, leftInt, ctx->right, rightInt))
+        {
+            errorHandler.addSemanticError(ctx, "Both sides of '=' must have the same type");
+            return Types::UNDEFINED;
+        }
     }
 
     // Note: As per C spec, arrays cannot be compared
-    if (dynamic_cast<const TypeArray *>(left) || dynamic_cast<const TypeArray *>(right))
+    if (dynamic_cast<const TypeArray *>(left) || dynamic_cast<const TypeArray *>(right) ||
+        dynamic_cast<const TypeSlice *>(left) || dynamic_cast<const TypeSlice *>(right) ||
+        dynamic_cast<const TypeDynArray *>(left) || dynamic_cast<const TypeDynArray *>(right))
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Cannot perform equality operation on arrays; they are always seen as unequal!");
+        errorHandler.addSemanticError(ctx, "Cannot perform equality operation on arrays; they are always seen as unequal!");
     }
 
     return Types::BOOL;
 }
 
+/**
+ * @brief Determines how many operations it takes to evaluate an expression, provided that doing so has no side effects
+ * and cannot trap. Array accesses are excluded as their index may only be valid because of an earlier operand
+ * (ie, i < n & a[i] > 0), and division is only included when the divisor is a constant other than 0 and -1.
+ *
+ * @param ctx The expression
+ * @param bindings The properties found for the expression during semantic analysis
+ * @return std::optional<unsigned int> The number of operations, or empty if the expression must not be evaluated speculatively
+ */
+static std::optional<unsigned int> getSpeculationCost(WPLParser::ExpressionContext *ctx, PropertyManager *bindings)
+{
+    if (bindings->getConstant(ctx) || dynamic_cast<WPLParser::FieldAccessContext *>(ctx))
+        return 0;
+
+    // Adds up the costs of the given operands, plus the cost of the operation itself
+    auto sum = [bindings](std::vector<WPLParser::ExpressionContext *> operands) -> std::optional<unsigned int>
+    {
+        unsigned int total = 1;
+        for (auto e : operands)
+        {
+            std::optional<unsigned int> cost = getSpeculationCost(e, bindings);
+            if (!cost)
+                return std::nullopt;
+            total += cost.value();
+        }
+        return total;
+    };
+
+    if (WPLParser::ParenExprContext *paren = dynamic_cast<WPLParser::ParenExprContext *>(ctx))
+        return getSpeculationCost(paren->ex, bindings);
+
+    if (WPLParser::UnaryExprContext *unary = dynamic_cast<WPLParser::UnaryExprContext *>(ctx))
+        return sum({unary->ex});
+
+    if (WPLParser::BinaryArithExprContext *arith = dynamic_cast<WPLParser::BinaryArithExprContext *>(ctx))
+    {
+        if (arith->op->getType() == WPLParser::DIVIDE)
+        {
+            std::optional<ConstValue> divisor = bindings->getConstant(arith->right);
+            if (!divisor || !std::holds_alternative<int64_t>(divisor.value()))
+                return std::nullopt;
+
+            int64_t d = std::get<int64_t>(divisor.value());
+            if (d == 0 || d == -1)
+                return std::nullopt;
+        }
+
+        return sum({arith->left, arith->right});
+    }
+
+    if (WPLParser::BinaryRelExprContext *rel = dynamic_cast<WPLParser::BinaryRelExprContext *>(ctx))
+        return sum({rel->left, rel->right});
+
+    if (WPLParser::EqExprContext *eq = dynamic_cast<WPLParser::EqExprContext *>(ctx))
+        return sum({eq->left, eq->right});
+
+    if (WPLParser::LogAndExprContext *land = dynamic_cast<WPLParser::LogAndExprContext *>(ctx))
+        return sum(land->exprs);
+
+    if (WPLParser::LogOrExprContext *lor = dynamic_cast<WPLParser::LogOrExprContext *>(ctx))
+        return sum(lor->exprs);
+
+    // Calls, array accesses, and anything else
+    return std::nullopt;
+}
+
+void SemanticVisitor::recordSpeculatable(std::vector<WPLParser::ExpressionContext *> operands)
+{
+    for (auto e : operands)
+    {
+        std::optional<unsigned int> cost = getSpeculationCost(e, bindings);
+        if (cost && cost.value() <= MAX_SPECULATION_COST)
+            bindings->markSpeculatable(e);
+    }
+}
+
 /**
  * @brief Visits a Logical And Expression ensuring LHS and RHS are BOOL.
  *
@@ -481,11 +1352,14 @@ const Type *SemanticVisitor::visitCtx(WPLParser::LogAndExprContext *ctx)
         const Type *type = any2Type(e->accept(this));
         if (type->isNotSubtype(Types::BOOL))
         {
-            errorHandler.addSemanticError(e->getStart(), "BOOL expression expected, but was " + type->toString());
+            errorHandler.addSemanticError(e, "BOOL expression expected, but was " + type->toString());
             valid = false;
         }
     }
 
+    if (valid)
+        recordSpeculatable(ctx->exprs);
+
     return (valid) ? Types::BOOL : Types::UNDEFINED;
 }
 
@@ -504,11 +1378,14 @@ const Type *SemanticVisitor::visitCtx(WPLParser::LogOrExprContext *ctx)
         const Type *type = any2Type(e->accept(this));
         if (type->isNotSubtype(Types::BOOL))
         {
-            errorHandler.addSemanticError(e->getStart(), "BOOL expression expected, but was " + type->toString());
+            errorHandler.addSemanticError(e, "BOOL expression expected, but was " + type->toString());
             valid = false;
         }
     }
 
+    if (valid)
+        recordSpeculatable(ctx->exprs);
+
     return (valid) ? Types::BOOL : Types::UNDEFINED;
 }
 
@@ -527,13 +1404,16 @@ const Type *SemanticVisitor::visitCtx(WPLParser::FieldAccessExprContext *ctx)
     std::optional<Symbol *> opt = stmgr->lookup(ctx->VARIABLE().at(0)->getText());
     if (!opt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Undefined variable reference: " + ctx->VARIABLE().at(0)->getText());
+        errorHandler.addSemanticError(ctx, [=]() { return "Undefined variable reference: " + ctx->VARIABLE().at(0)->getText(); });
         return Types::UNDEFINED;
     }
 
     Symbol *sym = opt.value();
     bindings->bind(ctx->VARIABLE().at(0), sym);
 
+    if (sym->isGlobal && !sym->isDefinition && !effectsStack.empty())
+        effectsStack.back().readsGlobals = true;
+
     const Type *ty = sym->type;
 
     for (unsigned int i = 1; i < ctx->fields.size(); i++)
@@ -548,21 +1428,24 @@ const Type *SemanticVisitor::visitCtx(WPLParser::FieldAccessExprContext *ctx)
                 ty = eleOpt.value();
                 Symbol *bnd = new Symbol("", ty, false, false);
                 bindings->bind(ctx->VARIABLE().at(i), bnd); // FIXME: DO BETTER
+
+                // Resolve the field's index now so that codegen doesn't need to look it up by name
+                bindings->bindFieldIndex(ctx->VARIABLE().at(i), s->getIndex(fieldName).value());
             }
             else
             {
-                errorHandler.addSemanticError(ctx->getStart(), "Cannot access " + fieldName + " on " + ty->toString());
+                errorHandler.addSemanticError(ctx, "Cannot access " + fieldName + " on " + ty->toString());
                 return Types::UNDEFINED;
             }
         }
-        else if (i + 1 == ctx->fields.size() && dynamic_cast<const TypeArray *>(ty) && ctx->fields.at(i)->getText() == "length")
+        else if (i + 1 == ctx->fields.size() && (dynamic_cast<const TypeArray *>(ty) || dynamic_cast<const TypeSlice *>(ty) || dynamic_cast<const TypeDynArray *>(ty)) && ctx->fields.at(i)->getText() == "length")
         {
             bindings->bind(ctx->VARIABLE().at(i), new Symbol("", Types::INT, false, false)); // FIXME: DO BETTER
             return Types::INT;
         }
         else
         {
-            errorHandler.addSemanticError(ctx->getStart(), "Cannot access " + fieldName + " on " + ty->toString());
+            errorHandler.addSemanticError(ctx, "Cannot access " + fieldName + " on " + ty->toString());
             return Types::UNDEFINED;
         }
     }
@@ -572,6 +1455,27 @@ const Type *SemanticVisitor::visitCtx(WPLParser::FieldAccessExprContext *ctx)
     return ty;
 }
 
+const Type *SemanticVisitor::visitCtx(WPLParser::FieldAccessContext *ctx)
+{
+    const Type *ty = this->visitCtx(ctx->fieldAccessExpr());
+
+    /*
+     * When aggregates are passed by reference, externs (which follow the C calling convention) take and return them
+     * differently than WPL invokables do. As calls through a function value always use the WPL convention, such
+     * externs can only be called directly.
+     */
+    if (const TypeInvoke *inv = dynamic_cast<const TypeInvoke *>(ty))
+    {
+        if ((flags & CompilerFlags::AGGREGATE_REFS) && inv->isExtern() && inv->hasAggregateSignature())
+        {
+            errorHandler.addSemanticError(ctx, [=]() { return "Cannot use extern " + ctx->getText() + " : " + inv->toString() + " as a value as it takes or returns an aggregate"; });
+            return Types::UNDEFINED;
+        }
+    }
+
+    return ty;
+}
+
 // Passthrough to expression
 const Type *SemanticVisitor::visitCtx(WPLParser::ParenExprContext *ctx) { return any2Type(ctx->ex->accept(this)); }
 
@@ -587,21 +1491,36 @@ const Type *SemanticVisitor::visitCtx(WPLParser::BinaryRelExprContext *ctx)
     bool valid = true;
 
     auto left = any2Type(ctx->left->accept(this));
+    const TypeInt *leftInt = asInt(left);
 
-    if (left->isNotSubtype(Types::INT))
+    if (!leftInt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "INT left expression expected, but was " + left->toString());
+        errorHandler.addSemanticError(ctx, "INT left expression expected, but was " + left->toString());
         valid = false;
     }
 
     auto right = any2Type(ctx->right->accept(this));
+    const TypeInt *rightInt = asInt(right);
 
-    if (right->isNotSubtype(Types::INT))
+    if (!rightInt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "INT right expression expected, but was " + right->toString() + " in " + ctx->getText());
+        errorHandler.addSemanticError(ctx, [=]() { return "INT right expression expected, but was " + right->toString() + " in " + ctx->getText(); });
         valid = false;
     }
-    return valid ? Types::BOOL : Types::UNDEFINED;
+
+    if (!valid)
+        return Types::UNDEFINED;
+
+    // Both sides are compared as the same integer type (which determines if the comparison is signed)
+    const TypeInt *ty = unifyInts(ctx->left, leftInt, ctx->right, rightInt);
+    if (!ty)
+    {
+        errorHandler.addSemanticError(ctx, "Cannot implicitly convert between " + leftInt->toString() + " and " + rightInt->toString() + "; use an explicit conversion (ie, int64(x))");
+        return Types::UNDEFINED;
+    }
+
+    bindings->bindOperandType(ctx, ty);
+    return Types::BOOL;
 }
 
 // This here basically means that we don't need to do anything for booleanConst, but I'll leave it just in case
@@ -624,7 +1543,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ConditionContext *ctx)
 
     if (conditionType->isNotSubtype(Types::BOOL))
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Condition expected BOOL, but was given " + conditionType->toString());
+        errorHandler.addSemanticError(ctx, "Condition expected BOOL, but was given " + conditionType->toString());
     }
 
     return Types::UNDEFINED;
@@ -645,7 +1564,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::SelectAlternativeContext *ctx)
     if (dynamic_cast<WPLParser::FuncDefContext *>(ctx->eval) ||
         dynamic_cast<WPLParser::VarDeclStatementContext *>(ctx->eval))
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Dead code: definition as select alternative.");
+        errorHandler.addSemanticError(ctx, "Dead code: definition as select alternative.");
     }
 
     // Confirm that the check type is a boolean
@@ -656,7 +1575,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::SelectAlternativeContext *ctx)
     }
     else
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Select alternative expected BOOL but got " + checkType->toString());
+        errorHandler.addSemanticError(ctx, "Select alternative expected BOOL but got " + checkType->toString());
     }
 
     // Return UNDEFINED as its a statement.
@@ -681,7 +1600,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ParameterListContext *ctx)
         auto prevUse = map.find(name);
         if (prevUse != map.end())
         {
-            errorHandler.addSemanticError(param->getStart(), "Re-use of previously defined parameter " + name + ".");
+            errorHandler.addSemanticError(param, "Re-use of previously defined parameter " + name + ".");
         }
         else
         {
@@ -701,7 +1620,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ParameterContext *ctx) { return
 
 const Type *SemanticVisitor::visitCtx(WPLParser::AssignmentContext *ctx)
 {
-    errorHandler.addSemanticError(ctx->getStart(), "Assignment should never be visited directly during type checking!");
+    errorHandler.addSemanticError(ctx, "Assignment should never be visited directly during type checking!");
     return Types::UNDEFINED;
 }
 
@@ -716,7 +1635,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ExternStatementContext *ctx)
 
     if (opt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Unsupported redeclaration of " + id);
+        errorHandler.addSemanticError(ctx, "Unsupported redeclaration of " + id);
         // return Types::UNDEFINED;
     }
 
@@ -730,6 +1649,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ExternStatementContext *ctx)
 
     const TypeInvoke *funcType = (ctx->ty) ? new TypeInvoke(procType->getParamTypes(), retType, variadic, true)
                                            : new TypeInvoke(procType->getParamTypes(), variadic, true);
+    funcType->markExtern();
 
     Symbol *funcSymbol = new Symbol(id, funcType, true, true);
 
@@ -754,18 +1674,36 @@ const Type *SemanticVisitor::visitCtx(WPLParser::AssignStatementContext *ctx)
     // Determine the expected type
     const Type *type = this->visitCtx(ctx->to);
 
+    // Record which variable is being updated so that codegen knows it cannot share the storage of a parameter with the caller
+    std::optional<Symbol *> rootOpt = ctx->to->var ? bindings->getBinding(ctx->to) : bindings->getBinding(ctx->to->array->field->VARIABLE().at(0));
+    if (rootOpt)
+    {
+        bindings->markMutated(rootOpt.value());
+
+        // Writing to an element of a slice updates the caller's array
+        bool isSlice = dynamic_cast<const TypeSlice *>(rootOpt.value()->type);
+        if ((rootOpt.value()->isGlobal || isSlice) && !effectsStack.empty())
+            effectsStack.back().writesGlobals = true;
+
+        if (isSlice && ctx->to->var)
+            errorHandler.addSemanticError(ctx, [=]() { return "Cannot assign to slice " + ctx->to->getText() + "; assign to its elements instead"; });
+
+        if (dynamic_cast<const TypeDynArray *>(rootOpt.value()->type) && ctx->to->var)
+            errorHandler.addSemanticError(ctx, [=]() { return "Cannot assign to dynamic array " + ctx->to->getText() + "; assign to its elements instead"; });
+    }
+
     // If we actually have a type... (prevents things like null ptrs)
     if (type)
     {
         // Make sure that the types are compatible. Inference automatically managed here.
-        if (exprType->isNotSubtype(type))
+        if (!isAssignable(ctx->ex, exprType, type))
         {
-            errorHandler.addSemanticError(ctx->getStart(), "Assignment statement expected " + type->toString() + " but got " + exprType->toString());
+            errorHandler.addSemanticError(ctx, "Assignment statement expected " + type->toString() + " but got " + exprType->toString());
         }
     }
     else
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Cannot assign to undefined variable: " + ctx->to->getText());
+        errorHandler.addSemanticError(ctx, [=]() { return "Cannot assign to undefined variable: " + ctx->to->getText(); });
     }
 
     // Return UNDEFINED because this is a statement, and UNDEFINED cannot be assigned to anything
@@ -782,23 +1720,33 @@ const Type *SemanticVisitor::visitCtx(WPLParser::VarDeclStatementContext *ctx)
 
         if (e->ex && stmgr->isGlobalScope())
         {
-            if (!(dynamic_cast<WPLParser::BConstExprContext *>(e->ex) ||
-                  dynamic_cast<WPLParser::IConstExprContext *>(e->ex) ||
-                  dynamic_cast<WPLParser::SConstExprContext *>(e->ex)))
+            if (!(bindings->getConstant(e->ex) ||
+                  dynamic_cast<WPLParser::SConstExprContext *>(e->ex) ||
+                  dynamic_cast<WPLParser::IConstExprContext *>(e->ex)))
             {
-                errorHandler.addSemanticError(e->ex->getStart(), "Global variables must be assigned explicit constants or initialized at runtime!");
+                errorHandler.addSemanticError(e->ex, "Global variables must be assigned constant expressions or initialized at runtime!");
             }
 
             if (dynamic_cast<const TypeSum *>(assignType))
             {
-                errorHandler.addSemanticError(e->ex->getStart(), "Sums cannot be initialized at a global level");
+                errorHandler.addSemanticError(e->ex, "Sums cannot be initialized at a global level");
             }
         }
 
+        // Slices cannot be stored in local variables as they would otherwise be able to outlive the array they refer to
+        if (e->ex && dynamic_cast<const TypeSlice *>(exprType))
+        {
+            errorHandler.addSemanticError(e, "Slices can only be used as parameter types and cannot be assigned to variables");
+        }
+        // Each dynamic array owns its elements, so they cannot be copied (or shared) by assignment
+        else if (e->ex && (dynamic_cast<const TypeDynArray *>(exprType) || dynamic_cast<const TypeDynArray *>(assignType)))
+        {
+            errorHandler.addSemanticError(e, "Dynamic arrays cannot be initialized by assignment; give their length as in int [* n] instead");
+        }
         // Note: This automatically performs checks to prevent issues with setting VAR = VAR
-        if (e->ex && exprType->isNotSubtype(assignType))
+        else if (e->ex && !isAssignable(e->ex, exprType, assignType))
         {
-            errorHandler.addSemanticError(e->getStart(), "Expression of type " + exprType->toString() + " cannot be assigned to " + assignType->toString());
+            errorHandler.addSemanticError(e, "Expression of type " + exprType->toString() + " cannot be assigned to " + assignType->toString());
         }
 
         for (auto var : e->VARIABLE())
@@ -809,7 +1757,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::VarDeclStatementContext *ctx)
 
             if (symOpt)
             {
-                errorHandler.addSemanticError(e->getStart(), "Redeclaration of " + id);
+                errorHandler.addSemanticError(e, "Redeclaration of " + id);
             }
             else
             {
@@ -841,12 +1789,12 @@ const Type *SemanticVisitor::visitCtx(WPLParser::MatchStatementContext *ctx)
 
             if (!sumType->contains(caseType))
             {
-                errorHandler.addSemanticError(altCtx->type()->getStart(), "Impossible case for " + sumType->toString() + " to act as " + caseType->toString());
+                errorHandler.addSemanticError(altCtx->type(), "Impossible case for " + sumType->toString() + " to act as " + caseType->toString());
             }
 
             if (foundCaseTypes.count(caseType))
             {
-                errorHandler.addSemanticError(altCtx->type()->getStart(), "Duplicate case in match");
+                errorHandler.addSemanticError(altCtx->type(), "Duplicate case in match");
             }
             else
             {
@@ -864,20 +1812,20 @@ const Type *SemanticVisitor::visitCtx(WPLParser::MatchStatementContext *ctx)
             if (dynamic_cast<WPLParser::FuncDefContext *>(altCtx->eval) ||
                 dynamic_cast<WPLParser::VarDeclStatementContext *>(altCtx->eval))
             {
-                errorHandler.addSemanticError(altCtx->getStart(), "Dead code: definition as select alternative.");
+                errorHandler.addSemanticError(altCtx, "Dead code: definition as select alternative.");
             }
         }
 
         if (foundCaseTypes.size() != sumType->getCases().size())
         {
-            errorHandler.addSemanticError(ctx->getStart(), "Match statement did not cover all cases needed for " + sumType->toString());
+            errorHandler.addSemanticError(ctx, "Match statement did not cover all cases needed for " + sumType->toString());
         }
 
         bindings->bind(ctx->check, new Symbol(ctx->check->ex->getText(), sumType, false, false));
         return Types::UNDEFINED;
     }
 
-    errorHandler.addSemanticError(ctx->check->getStart(), "Can only case on Sum Types, not " + condType->toString());
+    errorHandler.addSemanticError(ctx->check, "Can only case on Sum Types, not " + condType->toString());
     return Types::UNDEFINED;
 }
 
@@ -889,6 +1837,26 @@ const Type *SemanticVisitor::visitCtx(WPLParser::MatchStatementContext *ctx)
  */
 const Type *SemanticVisitor::visitCtx(WPLParser::LoopStatementContext *ctx)
 {
+    // A loop may never finish, so we cannot promise that the enclosing invokable returns
+    if (!effectsStack.empty())
+        effectsStack.back().hasLoops = true;
+
+    // Loop hints only guide optimization, so all we need to do is make sure they are ones we know how to apply
+    for (WPLParser::LoopHintContext *hint : ctx->hints)
+    {
+        std::string name = hint->name->getText();
+        if (name != "unroll" && name != "vectorize" && name != "interleave")
+        {
+            errorHandler.addSemanticError(hint, "Unknown loop hint: @" + name + " (expected @unroll, @vectorize, or @interleave)");
+            continue;
+        }
+
+        // Checking the length first keeps the count in range when it is parsed
+        std::string value = hint->value->getText();
+        if (value.length() > 5 || std::stoul(value) == 0)
+            errorHandler.addSemanticError(hint, "Loop hint @" + name + " expects a count between 1 and 99999, but got " + value);
+    }
+
     this->visitCtx(ctx->check);   // Visiting check will make sure we have a boolean condition
     this->visitCtx(ctx->block()); // Visiting block to make sure everything type checks there as well
 
@@ -919,7 +1887,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::SelectStatementContext *ctx)
 
     if (ctx->cases.size() < 1)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Select statement expected at least one alternative, but was given 0!");
+        errorHandler.addSemanticError(ctx, "Select statement expected at least one alternative, but was given 0!");
         return Types::UNDEFINED; // Shouldn't matter as the for loop won't have anything to do
     }
     // Here we just need to visit each of the individual cases; they each handle their own logic.
@@ -928,6 +1896,55 @@ const Type *SemanticVisitor::visitCtx(WPLParser::SelectStatementContext *ctx)
         this->visitCtx(e);
     }
 
+    /*
+     * Determine if every alternative compares the same INT (a variable or field) against a constant, (ie, x = 1 : ...),
+     * with the exception of the last which may be true (a default). If so, the select can be lowered to a switch.
+     */
+    WPLParser::FieldAccessExprContext *scrutinee = nullptr;
+    std::optional<Symbol *> scrutineeSym = {};
+
+    for (unsigned int i = 0; i < ctx->cases.size(); i++)
+    {
+        WPLParser::ExpressionContext *check = ctx->cases.at(i)->check;
+        while (WPLParser::ParenExprContext *paren = dynamic_cast<WPLParser::ParenExprContext *>(check))
+            check = paren->ex;
+
+        std::optional<ConstValue> checkVal = bindings->getConstant(check);
+        if (i + 1 == ctx->cases.size() && i != 0 && checkVal && checkVal.value() == ConstValue(true))
+            break;
+
+        WPLParser::EqExprContext *eq = dynamic_cast<WPLParser::EqExprContext *>(check);
+        if (!eq || eq->op->getType() != WPLParser::EQUAL)
+            return Types::UNDEFINED;
+
+        // Find the side being compared against a constant INT
+        std::optional<ConstValue> leftVal = bindings->getConstant(eq->left);
+        std::optional<ConstValue> rightVal = bindings->getConstant(eq->right);
+        WPLParser::ExpressionContext *other = (rightVal && !leftVal) ? eq->left : (leftVal && !rightVal) ? eq->right : nullptr;
+        std::optional<ConstValue> caseVal = (other == eq->left) ? rightVal : leftVal;
+
+        WPLParser::FieldAccessContext *access = dynamic_cast<WPLParser::FieldAccessContext *>(other);
+        if (!access || !std::holds_alternative<int64_t>(caseVal.value()) || bindings->getIntConversion(access))
+            return Types::UNDEFINED;
+
+        std::optional<Symbol *> sym = bindings->getBinding(access->fieldAccessExpr()->VARIABLE().at(0));
+        if (!sym)
+            return Types::UNDEFINED;
+
+        if (!scrutinee)
+        {
+            scrutinee = access->fieldAccessExpr();
+            scrutineeSym = sym;
+        }
+        else if (sym != scrutineeSym || access->fieldAccessExpr()->getText() != scrutinee->getText())
+        {
+            return Types::UNDEFINED;
+        }
+    }
+
+    if (scrutinee)
+        bindings->bindSwitch(ctx, scrutinee);
+
     // Return UNDEFINED because this is a statement, and UNDEFINED cannot be assigned to anything
     return Types::UNDEFINED;
 }
@@ -945,7 +1962,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ReturnStatementContext *ctx)
     // If we don't have the symbol, we're not in a place that we can return from.
     if (!symOpt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Cannot use return outside of FUNC or PROC");
+        errorHandler.addSemanticError(ctx, "Cannot use return outside of FUNC or PROC");
         return Types::UNDEFINED;
     }
 
@@ -961,15 +1978,15 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ReturnStatementContext *ctx)
         // If the type of the return symbol is a BOT, then we must be in a PROC and, thus, we cannot return anything
         if (const TypeBot *b = dynamic_cast<const TypeBot *>(sym->type))
         {
-            errorHandler.addSemanticError(ctx->getStart(), "PROC cannot return value, yet it was given a " + valType->toString() + " to return!");
+            errorHandler.addSemanticError(ctx, "PROC cannot return value, yet it was given a " + valType->toString() + " to return!");
             return Types::UNDEFINED;
         }
 
         // As the return type is not a BOT, we have to make sure that it is the correct type to return
 
-        if (valType->isNotSubtype(sym->type))
+        if (!isAssignable(ctx->expression(), valType, sym->type))
         {
-            errorHandler.addSemanticError(ctx->getStart(), "Expected return type of " + sym->type->toString() + " but got " + valType->toString());
+            errorHandler.addSemanticError(ctx, "Expected return type of " + sym->type->toString() + " but got " + valType->toString());
             return Types::UNDEFINED;
         }
 
@@ -984,11 +2001,11 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ReturnStatementContext *ctx)
             return Types::UNDEFINED;
         }
 
-        errorHandler.addSemanticError(ctx->getStart(), "Expected to return a " + sym->type->toString() + " but recieved nothing.");
+        errorHandler.addSemanticError(ctx, "Expected to return a " + sym->type->toString() + " but recieved nothing.");
         return Types::UNDEFINED;
     }
 
-    errorHandler.addSemanticError(ctx->getStart(), "Unknown case");
+    errorHandler.addSemanticError(ctx, "Unknown case");
     return Types::UNDEFINED;
 }
 
@@ -1021,6 +2038,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::LambdaConstExprContext *ctx)
 
     stmgr->enterScope(true);
     stmgr->addSymbol(new Symbol("@RETURN", retType, false, false));
+    effectsStack.push_back(DirectEffects());
 
     for (unsigned int i = 0; i < ctx->parameterList()->params.size(); i++)
     {
@@ -1039,10 +2057,13 @@ const Type *SemanticVisitor::visitCtx(WPLParser::LambdaConstExprContext *ctx)
     // If we have a return type, make sure that we return as the last statement in the FUNC. The type of the return is managed when we visited it.
     if (ctx->block()->stmts.size() == 0 || !dynamic_cast<WPLParser::ReturnStatementContext *>(ctx->block()->stmts.at(ctx->block()->stmts.size() - 1)))
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Lambda must end in return statement");
+        errorHandler.addSemanticError(ctx, "Lambda must end in return statement");
     }
     safeExitScope(ctx);
 
+    bindings->bindDirectEffects(ctx, effectsStack.back());
+    effectsStack.pop_back();
+
     Symbol *funcSymbol = new Symbol("@LAMBDA", funcType, false, false);
     bindings->bind(ctx, funcSymbol);
 
@@ -1067,6 +2088,31 @@ const Type *SemanticVisitor::visitCtx(WPLParser::LambdaTypeContext *ctx)
     return lamType;
 }
 
+/**
+ * @brief Sums find which case they hold by its LLVM type, so they cannot have two integer cases of the same size (ie, INT and UINT32).
+ *
+ * @param cases The cases of the sum
+ * @return std::optional<std::string> An error message if two cases would be indistinguishable; empty otherwise.
+ */
+static std::optional<std::string> findAmbiguousIntCases(const std::set<const Type *, TypeCompare> &cases)
+{
+    std::map<unsigned int, const TypeInt *> seen;
+
+    for (const Type *c : cases)
+    {
+        if (const TypeInt *i = dynamic_cast<const TypeInt *>(c))
+        {
+            auto prev = seen.find(i->getBits());
+            if (prev != seen.end())
+                return "Sum cannot contain both " + prev->second->toString() + " and " + i->toString() + " as they have the same size";
+
+            seen.insert({i->getBits(), i});
+        }
+    }
+
+    return {};
+}
+
 const Type *SemanticVisitor::visitCtx(WPLParser::SumTypeContext *ctx)
 {
     std::set<const Type *, TypeCompare> cases = {};
@@ -1079,7 +2125,13 @@ const Type *SemanticVisitor::visitCtx(WPLParser::SumTypeContext *ctx)
 
     if (cases.size() != ctx->type().size())
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Duplicate arguments to enum type, or failed to generate types");
+        errorHandler.addSemanticError(ctx, "Duplicate arguments to enum type, or failed to generate types");
+        return Types::UNDEFINED;
+    }
+
+    if (std::optional<std::string> err = findAmbiguousIntCases(cases))
+    {
+        errorHandler.addSemanticError(ctx, err.value());
         return Types::UNDEFINED;
     }
 
@@ -1094,7 +2146,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::DefineEnumContext *ctx)
     std::optional<Symbol *> opt = stmgr->lookup(id);
     if (opt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Unsupported redeclaration of " + id);
+        errorHandler.addSemanticError(ctx, "Unsupported redeclaration of " + id);
         return Types::UNDEFINED;
     }
 
@@ -1108,7 +2160,13 @@ const Type *SemanticVisitor::visitCtx(WPLParser::DefineEnumContext *ctx)
 
     if (cases.size() != ctx->cases.size())
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Duplicate arguments to enum type, or failed to generate types");
+        errorHandler.addSemanticError(ctx, "Duplicate arguments to enum type, or failed to generate types");
+        return Types::UNDEFINED;
+    }
+
+    if (std::optional<std::string> err = findAmbiguousIntCases(cases))
+    {
+        errorHandler.addSemanticError(ctx, err.value());
         return Types::UNDEFINED;
     }
 
@@ -1127,7 +2185,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::DefineStructContext *ctx)
     std::optional<Symbol *> opt = stmgr->lookup(id);
     if (opt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Unsupported redeclaration of " + id);
+        errorHandler.addSemanticError(ctx, "Unsupported redeclaration of " + id);
         return Types::UNDEFINED;
     }
 
@@ -1138,7 +2196,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::DefineStructContext *ctx)
         std::string caseName = caseCtx->name->getText();
         if (el.lookup(caseName))
         {
-            errorHandler.addSemanticError(ctx->getStart(), "Unsupported redeclaration of " + caseName);
+            errorHandler.addSemanticError(ctx, "Unsupported redeclaration of " + caseName);
             return Types::UNDEFINED;
         }
         const Type *caseTy = any2Type(caseCtx->ty->accept(this));
@@ -1163,7 +2221,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::CustomTypeContext *ctx)
     std::optional<Symbol *> opt = stmgr->lookup(name);
     if (!opt)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Undefined type: " + name); // TODO: address inefficiency in var decl where this is called multiple times
+        errorHandler.addSemanticError(ctx, "Undefined type: " + name); // TODO: address inefficiency in var decl where this is called multiple times
         return Types::UNDEFINED;
     }
 
@@ -1171,7 +2229,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::CustomTypeContext *ctx)
 
     if (!sym->type || !sym->isDefinition)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Cannot use: " + name + " as a type.");
+        errorHandler.addSemanticError(ctx, "Cannot use: " + name + " as a type.");
         return Types::UNDEFINED;
     }
 
@@ -1185,25 +2243,196 @@ const Type *SemanticVisitor::visitCtx(WPLParser::ArrayTypeContext *ctx)
 
     // Undefined type errors handled below
 
-    int len = std::stoi(ctx->len->getText());
+    if (ctx->dyn)
+        return visitDynArrayType(ctx, subType);
+
+    /*
+     * Without a length, this is a slice: a reference to an array of any length. These can only be parameters
+     * so that they never outlive the array they refer to.
+     */
+    if (!ctx->len)
+    {
+        WPLParser::LambdaTypeContext *lambdaType = dynamic_cast<WPLParser::LambdaTypeContext *>(ctx->parent);
+        bool isParam = dynamic_cast<WPLParser::ParameterContext *>(ctx->parent) ||
+                       (lambdaType && std::find(lambdaType->paramTypes.begin(), lambdaType->paramTypes.end(), ctx) != lambdaType->paramTypes.end());
+
+        if (!isParam)
+        {
+            errorHandler.addSemanticError(ctx, [=]() { return "Slices can only be used as parameter types, but found: " + ctx->getText(); });
+            return Types::UNDEFINED;
+        }
+
+        return new TypeSlice(subType);
+    }
+
+    // The length can be any constant INT expression
+    const Type *lenType = any2Type(ctx->len->accept(this));
+    std::optional<ConstValue> lenOpt = bindings->getConstant(ctx->len);
+
+    if (lenType->isNotSubtype(Types::INT) || !lenOpt || !std::holds_alternative<int64_t>(lenOpt.value()))
+    {
+        errorHandler.addSemanticError(ctx, [=]() { return "Array length must be a constant INT expression, but was: " + ctx->len->getText(); });
+        return Types::UNDEFINED;
+    }
+
+    int len = std::get<int64_t>(lenOpt.value());
 
     if (len < 1)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Cannot initialize array with a size of less than 1!");
+        errorHandler.addSemanticError(ctx, "Cannot initialize array with a size of less than 1!");
     }
 
     const Type *arr = new TypeArray(subType, len);
     return arr;
 }
+
+const Type *SemanticVisitor::visitDynArrayType(WPLParser::ArrayTypeContext *ctx, const Type *subType)
+{
+    /*
+     * Dynamic arrays are freed when the block declaring them is exited, so they can only be declared directly within
+     * a block. They can still be passed to slice parameters, as the call completes before the array is freed.
+     */
+    WPLParser::VarDeclStatementContext *decl = ctx->parent ? dynamic_cast<WPLParser::VarDeclStatementContext *>(ctx->parent->parent) : nullptr;
+
+    if (!decl || !dynamic_cast<WPLParser::BlockContext *>(decl->parent))
+    {
+        errorHandler.addSemanticError(ctx, [=]() { return "Dynamic arrays can only be declared as local variables, but found: " + ctx->getText(); });
+        return Types::UNDEFINED;
+    }
+
+    if (flags & CompilerFlags::NO_RUNTIME)
+    {
+        errorHandler.addSemanticError(ctx, "Dynamic arrays require the runtime");
+        return Types::UNDEFINED;
+    }
+
+    // Unlike other arrays, the length can be computed at runtime
+    if (ctx->len)
+    {
+        const Type *lenType = any2Type(ctx->len->accept(this));
+
+        if (lenType->isNotSubtype(Types::INT))
+        {
+            errorHandler.addSemanticError(ctx, [=]() { return "Dynamic array length must be an INT, but was: " + lenType->toString(); });
+            return Types::UNDEFINED;
+        }
+    }
+
+    // The elements are managed by the runtime's allocator (which aborts if it runs out of memory)
+    if (!effectsStack.empty())
+        effectsStack.back().hasUnknownCalls = true;
+
+    return new TypeDynArray(subType);
+}
+
+const Type *SemanticVisitor::visitArrayMethod(WPLParser::InvocationContext *ctx, Symbol *sym)
+{
+    const Type *valueType = Types::getArrayValueType(sym->type);
+    std::string method = ctx->field->fields.at(1)->getText();
+
+    bindings->bind(ctx->field->VARIABLE().at(0), sym);
+    bindings->bind(ctx, sym);
+
+    /*
+     * Each method takes at most one argument (nullptr if it takes none), and either produces nothing (like a PROC) or
+     * an element. When a method is given another array, only as many elements as the shorter of the two has are used.
+     */
+    std::optional<const Type *> expected = std::nullopt;
+    const Type *result = Types::UNDEFINED;
+    bool mutates = false;
+    bool dynamicOnly = false;
+    bool integersOnly = false;
+
+    if (method == "push" || method == "resize")
+    {
+        // Grows (or shrinks) a dynamic array
+        expected = (method == "push") ? valueType : Types::INT;
+        mutates = dynamicOnly = true;
+    }
+    else if (method == "sum" || method == "min" || method == "max")
+    {
+        // Reduces the elements to one. The min (max) of an empty array is the largest (smallest) value of the element type
+        expected = nullptr;
+        result = valueType;
+        integersOnly = true;
+    }
+    else if (method == "fill")
+    {
+        // Sets every element to the given value
+        expected = valueType;
+        mutates = true;
+    }
+    else if (method == "copy" || method == "add" || method == "mul")
+    {
+        // Sets (or adds to, or multiplies) each element with the corresponding element of the given array
+        expected = new TypeSlice(valueType);
+        mutates = true;
+        integersOnly = method != "copy";
+    }
+    else if (method == "dot")
+    {
+        // The sum of the products of the corresponding elements of both arrays
+        expected = new TypeSlice(valueType);
+        result = valueType;
+        integersOnly = true;
+    }
+
+    if (!expected || (dynamicOnly && !dynamic_cast<const TypeDynArray *>(sym->type)) || (integersOnly && !dynamic_cast<const TypeInt *>(valueType)))
+    {
+        errorHandler.addSemanticError(ctx, [=]() { return "Cannot invoke " + method + " on " + sym->type->toString(); });
+        return Types::UNDEFINED;
+    }
+
+    if (mutates)
+        bindings->markMutated(sym);
+
+    if (!effectsStack.empty())
+    {
+        // Growing an array may need to call into the runtime's allocator
+        if (dynamicOnly)
+            effectsStack.back().hasUnknownCalls = true;
+
+        // Slices and globals refer to memory which is not our own
+        if (dynamic_cast<const TypeSlice *>(sym->type) || sym->isGlobal)
+        {
+            effectsStack.back().readsGlobals = true;
+            effectsStack.back().writesGlobals |= mutates;
+        }
+    }
+
+    unsigned int numArgs = expected.value() ? 1 : 0;
+    if (ctx->args.size() != numArgs)
+    {
+        errorHandler.addSemanticError(ctx, [=]() { return "Invocation of " + ctx->field->getText() + " expected " + std::to_string(numArgs) + " argument(s), but got " + std::to_string(ctx->args.size()); });
+        return Types::UNDEFINED;
+    }
+
+    if (numArgs)
+    {
+        const Type *providedType = any2Type(ctx->args.at(0)->accept(this));
+
+        if (!isAssignable(ctx->args.at(0), providedType, expected.value()))
+        {
+            errorHandler.addSemanticError(ctx, [=]() { return "Argument 0 provided to " + ctx->field->getText() + " expected " + expected.value()->toString() + " but got " + providedType->toString(); });
+        }
+
+        // Reading through a slice reads memory which is not our own
+        if (dynamic_cast<const TypeSlice *>(providedType) && !effectsStack.empty())
+            effectsStack.back().readsGlobals = true;
+    }
+
+    return result;
+}
+
 const Type *SemanticVisitor::visitCtx(WPLParser::BaseTypeContext *ctx)
 {
 
     const Type *ty = Types::UNDEFINED;
     bool valid = false;
 
-    if (ctx->TYPE_INT())
+    if (getIntType(ctx->ty) != Types::UNDEFINED)
     {
-        ty = Types::INT;
+        ty = getIntType(ctx->ty);
         valid = true;
     }
     else if (ctx->TYPE_BOOL())
@@ -1219,7 +2448,7 @@ const Type *SemanticVisitor::visitCtx(WPLParser::BaseTypeContext *ctx)
 
     if (!valid)
     {
-        errorHandler.addSemanticError(ctx->getStart(), "Unknown type: " + ctx->getText());
+        errorHandler.addSemanticError(ctx, [=]() { return "Unknown type: " + ctx->getText(); });
         return Types::UNDEFINED;
     }
 
@@ -1,23 +1,261 @@
 #pragma once
 #include "Symbol.h"
 #include "antlr4-runtime.h"
+#include <variant>
+#include <set>
+
+// The value of a constant expression (either an integer or a BOOLEAN). Integers hold a value of their own type (see getConstantType)
+using ConstValue = std::variant<int64_t, bool>;
+
+// The effects of a FUNC/PROC/lambda's own body, not counting those of the invokables it calls
+struct DirectEffects {
+  bool readsGlobals = false;
+  bool writesGlobals = false;
+  bool hasLoops = false;
+  bool hasUnknownCalls = false; // Calls through a function value, whose target cannot be known
+  bool indexesArrays = false;
+  bool mayAbort = false; // Indexes slices or dynamic arrays, which are always bounds checked
+
+  std::set<std::string> callees; // Named FUNC/PROC/externs that are invoked
+  std::set<antlr4::tree::ParseTree*> lambdas; // Lambdas that are invoked where they are defined
+};
+
+// What invoking a FUNC/PROC/lambda/extern may do, including through the invokables it calls
+struct InvokeEffects {
+  bool readsMemory = true;
+  bool writesMemory = true;
+  bool willReturn = false;
+  bool noRecurse = false;
+  bool noUnwind = false;
+  bool indexesArrays = false; // If bounds checks are enabled, this may abort the program
+  bool mayAbort = false; // Whether or not bounds checks are enabled, this may abort the program
+};
 
 class PropertyManager {
   public:
     // Get the Symbol associated with this node
     std::optional<Symbol*> getBinding(antlr4::tree::ParseTree *ctx) {
-      Symbol * ans = bindings.get(ctx); 
+      auto ans = bindings.find(ctx); 
 
-      if(ans) return ans; 
+      if(ans != bindings.end() && ans->second) return ans->second; 
 
       return std::nullopt; 
     }
 
     // Bind the symbol to the node
     void bind(antlr4::tree::ParseTree *ctx, Symbol* symbol) {
-      bindings.put(ctx, symbol);
+      bindings[ctx] = symbol;
+    }
+
+    // Get the index of the struct field accessed by this node
+    std::optional<unsigned int> getFieldIndex(antlr4::tree::ParseTree *ctx) {
+      auto ans = fieldIndices.find(ctx); 
+
+      if(ans != fieldIndices.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Record the index of the struct field accessed by this node
+    void bindFieldIndex(antlr4::tree::ParseTree *ctx, unsigned int index) {
+      fieldIndices[ctx] = index;
+    }
+
+    // Get the value of this node if it is a constant expression
+    std::optional<ConstValue> getConstant(antlr4::tree::ParseTree *ctx) {
+      auto ans = constants.find(ctx); 
+
+      if(ans != constants.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Record that this node is a constant expression with the given value
+    void bindConstant(antlr4::tree::ParseTree *ctx, ConstValue value) {
+      constants[ctx] = value;
+    }
+
+    // Get the integer type of this node if it is an integer constant expression
+    std::optional<const TypeInt*> getConstantType(antlr4::tree::ParseTree *ctx) {
+      auto ans = constantTypes.find(ctx); 
+
+      if(ans != constantTypes.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Record that this node is an integer constant expression of the given type and value
+    void bindConstant(antlr4::tree::ParseTree *ctx, int64_t value, const TypeInt *ty) {
+      constants[ctx] = value;
+      constantTypes[ctx] = ty;
+    }
+
+    // Get the integer type (before and after) that this node's value must be converted to, if it is converted
+    std::optional<std::pair<const TypeInt*, const TypeInt*>> getIntConversion(antlr4::tree::ParseTree *ctx) {
+      auto ans = intConversions.find(ctx); 
+
+      if(ans != intConversions.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Record that this node's value must be converted from one integer type to another
+    void bindIntConversion(antlr4::tree::ParseTree *ctx, const TypeInt *from, const TypeInt *to) {
+      intConversions[ctx] = {from, to};
+    }
+
+    // Get the integer type that the operands of this arithmetic or relational node are computed in
+    std::optional<const TypeInt*> getOperandType(antlr4::tree::ParseTree *ctx) {
+      auto ans = operandTypes.find(ctx); 
+
+      if(ans != operandTypes.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Record the integer type that the operands of this arithmetic or relational node are computed in
+    void bindOperandType(antlr4::tree::ParseTree *ctx, const TypeInt *ty) {
+      operandTypes[ctx] = ty;
+    }
+
+    // Determine if an operand of &/| is cheap enough, and free enough of side effects, that it can be evaluated without branching around it
+    bool isSpeculatable(antlr4::tree::ParseTree *ctx) {
+      return speculatable.count(ctx);
+    }
+
+    // Record that an operand of &/| can be evaluated unconditionally
+    void markSpeculatable(antlr4::tree::ParseTree *ctx) {
+      speculatable.insert(ctx);
+    }
+
+    // Get the contents of a string literal, with its escape sequences already decoded
+    std::optional<std::string> getString(antlr4::tree::ParseTree *ctx) {
+      auto ans = strings.find(ctx); 
+
+      if(ans != strings.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Record the decoded contents of a string literal
+    void bindString(antlr4::tree::ParseTree *ctx, std::string value) {
+      strings[ctx] = value;
+    }
+
+    // Get the scrutinee of a select statement which can be lowered to a switch
+    std::optional<antlr4::tree::ParseTree*> getSwitch(antlr4::tree::ParseTree *ctx) {
+      auto ans = switches.find(ctx); 
+
+      if(ans != switches.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Record that a select statement can be lowered to a switch on the given expression
+    void bindSwitch(antlr4::tree::ParseTree *ctx, antlr4::tree::ParseTree *scrutinee) {
+      switches[ctx] = scrutinee;
+    }
+
+    // Determine if the symbol (or any part of it) is ever assigned to after its declaration
+    bool isMutated(const Symbol *symbol) {
+      return mutated.count(symbol);
+    }
+
+    // Record that the symbol (or part of it) is assigned to
+    void markMutated(const Symbol *symbol) {
+      mutated.insert(symbol);
+    }
+
+    // Get the effects of the body of a FUNC/PROC/lambda definition
+    std::optional<DirectEffects> getDirectEffects(antlr4::tree::ParseTree *ctx) {
+      auto ans = directEffects.find(ctx); 
+
+      if(ans != directEffects.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Get every definition which has had the effects of its body recorded
+    std::vector<antlr4::tree::ParseTree*> getEffectDefinitions() {
+      std::vector<antlr4::tree::ParseTree*> ans;
+
+      for(auto e : directEffects) 
+        ans.push_back(e.first); 
+
+      return ans; 
+    }
+
+    // Record the effects of the body of a FUNC/PROC/lambda definition
+    void bindDirectEffects(antlr4::tree::ParseTree *ctx, DirectEffects value) {
+      directEffects[ctx] = value;
+    }
+
+    // Get the effects of invoking the FUNC/PROC/lambda/extern defined by this node
+    std::optional<InvokeEffects> getEffects(antlr4::tree::ParseTree *ctx) {
+      auto ans = effects.find(ctx); 
+
+      if(ans != effects.end()) return ans->second; 
+
+      return std::nullopt; 
+    }
+
+    // Record the effects of invoking the FUNC/PROC/lambda/extern defined by this node
+    void bindEffects(antlr4::tree::ParseTree *ctx, InvokeEffects value) {
+      effects[ctx] = value;
+    }
+
+    // Copy all of the bindings from another property manager into this one
+    void merge(PropertyManager *other) {
+      for(auto e : other->bindings) 
+        bindings[e.first] = e.second; 
+
+      for(auto e : other->fieldIndices) 
+        fieldIndices[e.first] = e.second; 
+
+      for(auto e : other->constants) 
+        constants[e.first] = e.second; 
+
+      for(auto e : other->constantTypes) 
+        constantTypes[e.first] = e.second; 
+
+      for(auto e : other->intConversions) 
+        intConversions[e.first] = e.second; 
+
+      for(auto e : other->operandTypes) 
+        operandTypes[e.first] = e.second; 
+
+      for(auto e : other->speculatable) 
+        speculatable.insert(e); 
+
+      for(auto e : other->strings) 
+        strings[e.first] = e.second; 
+
+      for(auto e : other->switches) 
+        switches[e.first] = e.second; 
+
+      for(auto e : other->mutated) 
+        mutated.insert(e); 
+
+      for(auto e : other->directEffects) 
+        directEffects[e.first] = e.second; 
+
+      for(auto e : other->effects) 
+        effects[e.first] = e.second; 
     }
 
   private:
-    antlr4::tree::ParseTreeProperty<Symbol*> bindings;
+    // NOTE: A plain map is used (rather than antlr4::tree::ParseTreeProperty) so that lookups
+    // never insert into it, and so that bindings can be merged between managers.
+    std::map<antlr4::tree::ParseTree*, Symbol*> bindings;
+    std::map<antlr4::tree::ParseTree*, unsigned int> fieldIndices;
+    std::map<antlr4::tree::ParseTree*, ConstValue> constants;
+    std::map<antlr4::tree::ParseTree*, const TypeInt*> constantTypes;
+    std::map<antlr4::tree::ParseTree*, std::pair<const TypeInt*, const TypeInt*>> intConversions;
+    std::map<antlr4::tree::ParseTree*, const TypeInt*> operandTypes;
+    std::set<antlr4::tree::ParseTree*> speculatable;
+    std::map<antlr4::tree::ParseTree*, std::string> strings;
+    std::map<antlr4::tree::ParseTree*, antlr4::tree::ParseTree*> switches;
+    std::set<const Symbol*> mutated;
+    std::map<antlr4::tree::ParseTree*, DirectEffects> directEffects;
+    std::map<antlr4::tree::ParseTree*, InvokeEffects> effects;
 };
\ No newline at end of file
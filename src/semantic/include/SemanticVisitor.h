@@ -30,10 +30,56 @@ public:
     }
 
     std::string getErrors() { return errorHandler.errorList(); }
+    std::string getErrors(DiagnosticFormat format) { return errorHandler.errorList(format); }
+    std::vector<std::string> getErrorEntries(DiagnosticFormat format) { return errorHandler.errorEntries(format); }
+    void setErrorLimit(unsigned int limit, unsigned int prior = 0) { errorHandler.setErrorLimit(limit, prior); }
     STManager *getSTManager() { return stmgr; }
     PropertyManager *getBindings() { return bindings; }
     bool hasErrors(int flags) { return errorHandler.hasErrors(flags); }
 
+    /**
+     * @brief Gets the symbols a compilation unit exports (ie, to be written to a module interface). Should only be used after the unit has been visited.
+     *
+     * @param ctx The compilation unit
+     * @return std::vector<const Symbol *> The unit's FUNC/PROC, enum, struct, and global variable symbols
+     */
+    std::vector<const Symbol *> getExports(WPLParser::CompilationUnitContext *ctx)
+    {
+        std::vector<std::string> names;
+
+        for (auto e : ctx->defs)
+        {
+            if (WPLParser::DefineEnumContext *enumCtx = dynamic_cast<WPLParser::DefineEnumContext *>(e))
+                names.push_back(enumCtx->name->getText());
+            else if (WPLParser::DefineStructContext *structCtx = dynamic_cast<WPLParser::DefineStructContext *>(e))
+                names.push_back(structCtx->name->getText());
+        }
+
+        for (auto e : ctx->stmts)
+        {
+            if (WPLParser::FuncDefContext *fnCtx = dynamic_cast<WPLParser::FuncDefContext *>(e))
+            {
+                names.push_back(fnCtx->name->getText());
+            }
+            else if (WPLParser::VarDeclStatementContext *declCtx = dynamic_cast<WPLParser::VarDeclStatementContext *>(e))
+            {
+                for (auto a : declCtx->assignments)
+                    for (auto var : a->VARIABLE())
+                        names.push_back(var->getText());
+            }
+        }
+
+        std::vector<const Symbol *> ans;
+        for (auto name : names)
+        {
+            std::optional<Symbol *> opt = stmgr->lookupInCurrentScope(name);
+            if (opt)
+                ans.push_back(opt.value());
+        }
+
+        return ans;
+    }
+
     /*
      * The following are simply typed versions of the traditional visitor methods
      */
@@ -52,7 +98,9 @@ public:
     const Type *visitCtx(WPLParser::CallExprContext *ctx);
     // const Type *visitCtx(WPLParser::VariableExprContext *ctx);
     const Type *visitCtx(WPLParser::FieldAccessExprContext *ctx);
+    const Type *visitCtx(WPLParser::FieldAccessContext *ctx);
     const Type *visitCtx(WPLParser::ParenExprContext *ctx);
+    const Type *visitCtx(WPLParser::IntCastExprContext *ctx);
     const Type *visitCtx(WPLParser::BinaryRelExprContext *ctx);
     const Type *visitCtx(WPLParser::BConstExprContext *ctx);
     const Type *visitCtx(WPLParser::BlockContext *ctx);
@@ -79,6 +127,31 @@ public:
     const Type *visitCtx(WPLParser::BaseTypeContext *ctx);
     const Type *visitCtx(WPLParser::ArrayTypeContext *ctx);
 
+    /**
+     * @brief Visits the type of a dynamic array (ie, int [* n]), checking that it is declared where it can be freed
+     *
+     * @param ctx The ArrayTypeContext
+     * @param subType The type of the elements
+     * @return const Type* The TypeDynArray, or UNDEFINED if it cannot be used here
+     */
+    const Type *visitDynArrayType(WPLParser::ArrayTypeContext *ctx, const Type *subType);
+
+    /**
+     * @brief Visits an invocation of an array's built in methods:
+     *  - push(value) and resize(length), for dynamic arrays
+     *  - sum(), min(), max(), add(other), mul(other), and dot(other), for arrays of integers
+     *  - fill(value) and copy(other), for any array
+     *
+     * Methods which pair elements with another array only process as many elements as the shorter of the two has. The
+     * sum() of an empty array is 0, while its min() (max()) is the largest (smallest) value of the element type, ie,
+     * INT_MAX (INT_MIN) for an INT array. This way, the result can always be combined with the result for another array.
+     *
+     * @param ctx The InvocationContext
+     * @param sym The array the method is invoked on
+     * @return const Type* The element type for reductions (and dot); UNDEFINED otherwise
+     */
+    const Type *visitArrayMethod(WPLParser::InvocationContext *ctx, Symbol *sym);
+
     const Type *visitCtx(WPLParser::LambdaConstExprContext *ctx);
 
     const Type *visitCtx(WPLParser::SumTypeContext *ctx); // FIXME: NEED TO DO THIS & OTHERS!
@@ -95,20 +168,22 @@ public:
     std::any visitInvocation(WPLParser::InvocationContext *ctx) override { return visitCtx(ctx); }
     std::any visitArrayAccess(WPLParser::ArrayAccessContext *ctx) override { return visitCtx(ctx); }
     std::any visitArrayOrVar(WPLParser::ArrayOrVarContext *ctx) override { return visitCtx(ctx); }
-    std::any visitIConstExpr(WPLParser::IConstExprContext *ctx) override { return visitCtx(ctx); }
+    std::any visitIConstExpr(WPLParser::IConstExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
     std::any visitArrayAccessExpr(WPLParser::ArrayAccessExprContext *ctx) override { return visitCtx(ctx); }
     std::any visitSConstExpr(WPLParser::SConstExprContext *ctx) override { return visitCtx(ctx); }
-    std::any visitUnaryExpr(WPLParser::UnaryExprContext *ctx) override { return visitCtx(ctx); }
-    std::any visitBinaryArithExpr(WPLParser::BinaryArithExprContext *ctx) override { return visitCtx(ctx); }
-    std::any visitEqExpr(WPLParser::EqExprContext *ctx) override { return visitCtx(ctx); }
-    std::any visitLogAndExpr(WPLParser::LogAndExprContext *ctx) override { return visitCtx(ctx); }
-    std::any visitLogOrExpr(WPLParser::LogOrExprContext *ctx) override { return visitCtx(ctx); }
+    std::any visitUnaryExpr(WPLParser::UnaryExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
+    std::any visitBinaryArithExpr(WPLParser::BinaryArithExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
+    std::any visitEqExpr(WPLParser::EqExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
+    std::any visitLogAndExpr(WPLParser::LogAndExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
+    std::any visitLogOrExpr(WPLParser::LogOrExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
     std::any visitCallExpr(WPLParser::CallExprContext *ctx) override { return visitCtx(ctx); }
     // std::any visitVariableExpr(WPLParser::VariableExprContext *ctx) override { return visitCtx(ctx); }
     std::any visitFieldAccessExpr(WPLParser::FieldAccessExprContext *ctx) override { return visitCtx(ctx); }
-    std::any visitParenExpr(WPLParser::ParenExprContext *ctx) override { return visitCtx(ctx); }
-    std::any visitBinaryRelExpr(WPLParser::BinaryRelExprContext *ctx) override { return visitCtx(ctx); }
-    std::any visitBConstExpr(WPLParser::BConstExprContext *ctx) override { return visitCtx(ctx); }
+    std::any visitFieldAccess(WPLParser::FieldAccessContext *ctx) override { return visitCtx(ctx); }
+    std::any visitParenExpr(WPLParser::ParenExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
+    std::any visitIntCastExpr(WPLParser::IntCastExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
+    std::any visitBinaryRelExpr(WPLParser::BinaryRelExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
+    std::any visitBConstExpr(WPLParser::BConstExprContext *ctx) override { return recordConstant(ctx, visitCtx(ctx)); }
     std::any visitBlock(WPLParser::BlockContext *ctx) override { return visitCtx(ctx); }
     std::any visitCondition(WPLParser::ConditionContext *ctx) override { return visitCtx(ctx); }
     std::any visitSelectAlternative(WPLParser::SelectAlternativeContext *ctx) override { return visitCtx(ctx); }
@@ -159,13 +234,17 @@ public:
         bool foundReturn = false;
         for (auto e : ctx->stmts)
         {
+            // Stop early if we've already reported as many errors as we are allowed to
+            if (errorHandler.isFull())
+                break;
+
             // Visit all the statements in the block
             e->accept(this);
 
             // If we found a return, then this is dead code, and we can break out of the loop.
             if (foundReturn)
             {
-                errorHandler.addSemanticError(ctx->getStart(), "Dead code.");
+                errorHandler.addSemanticError(ctx, "Dead code.");
                 break;
             }
 
@@ -198,22 +277,37 @@ public:
         if (!pairOpt)
             return {}; // Errors already caught
 
-        std::pair<const TypeInvoke *, Symbol *> pair = pairOpt.value();
+        if (!declareInvokeable(ctx, funcId, pairOpt.value()))
+            return Types::UNDEFINED;
 
+        return visitInvokeableBody(ctx, pairOpt.value(), paramList, ty, block);
+    }
+
+    /**
+     * @brief Declares an invokable (PROC or FUNC) in the current scope without visiting its body.
+     *
+     * @param ctx The parser rule context
+     * @param funcId The name of the PROC/FUNC
+     * @param pair The type and symbol of the PROC/FUNC as determined by invokableHelper
+     * @return true If the invokable was declared and its body should be visited
+     * @return false If the invokable could not be declared (ie, due to a redeclaration)
+     */
+    bool declareInvokeable(antlr4::ParserRuleContext *ctx, std::string funcId, std::pair<const TypeInvoke *, Symbol *> pair)
+    {
         const TypeInvoke *funcType = pair.first;
         Symbol *funcSymbol = pair.second;
 
         // If the symbol name is program, do some extra checks to make sure it has no arguments and returns an INT. Otherwise, we will get a link error.
         if (funcId == "program")
         {
-            if (!dynamic_cast<const TypeInt *>(funcType->getReturnType()))
+            if (funcType->getReturnType()->isNotSubtype(Types::INT))
             {
-                errorHandler.addSemanticCritWarning(ctx->getStart(), "program() should return type INT");
+                errorHandler.addSemanticCritWarning(ctx, "program() should return type INT");
             }
 
             if (funcType->getParamTypes().size() != 0)
             {
-                errorHandler.addSemanticCritWarning(ctx->getStart(), "program() should have no arguments");
+                errorHandler.addSemanticCritWarning(ctx, "program() should have no arguments");
             }
         }
 
@@ -233,13 +327,32 @@ public:
                     }
                 }
             }
-            errorHandler.addSemanticError(ctx->getStart(), "Unsupported redeclaration of " + funcId);
-            return Types::UNDEFINED;
+            errorHandler.addSemanticError(ctx, "Unsupported redeclaration of " + funcId);
+            return false;
         }
 
     cont:
-        // Add the symbol to the stmgr and enter the scope.
+        // Add the symbol to the stmgr
         stmgr->addSymbol(funcSymbol);
+        return true;
+    }
+
+    /**
+     * @brief Visits the body of an invokable (PROC or FUNC) which has already been declared with declareInvokeable.
+     *
+     * @param ctx The parser rule context
+     * @param pair The type and symbol of the PROC/FUNC as determined by invokableHelper
+     * @param paramList The parameter list for the PROC/FUNC
+     * @param ty The return type (Type::UNDEFINED for PROC)
+     * @param block The PROC/FUNC block
+     * @return const Type* The TypeInvoke of the PROC/FUNC
+     */
+    const Type *visitInvokeableBody(antlr4::ParserRuleContext *ctx, std::pair<const TypeInvoke *, Symbol *> pair, WPLParser::ParameterListContext *paramList, WPLParser::TypeContext *ty, WPLParser::BlockContext *block)
+    {
+        const TypeInvoke *funcType = pair.first;
+        Symbol *funcSymbol = pair.second;
+
+        // Enter the scope of the function.
         stmgr->enterScope(true); // NOTE: We do NOT duplicate scopes here because we use a saveVisitBlock with newScope=false
 
         // In the new scope. set our return type. We use @RETURN as it is not a valid symbol the programmer could write in the language
@@ -266,12 +379,16 @@ public:
         }
 
         // Safe visit the program block without creating a new scope (as we are managing the scope)
+        effectsStack.push_back(DirectEffects());
         this->safeVisitBlock(block, false);
 
+        bindings->bindDirectEffects(ctx, effectsStack.back());
+        effectsStack.pop_back();
+
         // If we have a return type, make sure that we return as the last statement in the FUNC. The type of the return is managed when we visited it.
         if (ty && (block->stmts.size() == 0 || !dynamic_cast<WPLParser::ReturnStatementContext *>(block->stmts.at(block->stmts.size() - 1))))
         {
-            errorHandler.addSemanticError(ctx->getStart(), "Function must end in return statement");
+            errorHandler.addSemanticError(ctx, "Function must end in return statement");
         }
 
         // Safe exit the scope.
@@ -300,6 +417,74 @@ private:
 
     int flags; // Compiler flags
 
+    // Effects of the bodies of the invokables currently being visited (innermost last)
+    std::vector<DirectEffects> effectsStack;
+
+    /**
+     * @brief Determines the effects of invoking each FUNC/PROC/lambda from the effects recorded for their bodies.
+     * Should only be used once all of the bodies in the unit have been visited.
+     *
+     * @param ctx The compilation unit
+     */
+    void resolveEffects(WPLParser::CompilationUnitContext *ctx);
+
+    /**
+     * @brief Visits the top-level statements of a compilation unit, checking FUNC/PROC bodies in parallel.
+     *
+     * @param ctx The compilation unit whose statements should be visited
+     */
+    void visitStmtsParallel(WPLParser::CompilationUnitContext *ctx);
+
+    /**
+     * @brief Records the value of an expression if it is constant. As expressions are visited bottom-up, this only
+     * needs to look at the values already recorded for the expression's direct subexpressions.
+     *
+     * @param ctx The expression that was just visited
+     * @param ty The type found for the expression
+     * @return const Type* The same type (so that this can wrap visitCtx)
+     */
+    const Type *recordConstant(WPLParser::ExpressionContext *ctx, const Type *ty);
+
+    /**
+     * @brief Gets the integer type of an expression, giving vars which do not yet have a type the type INT.
+     *
+     * @param ty The type of the expression
+     * @return const TypeInt* The integer type, or nullptr if the expression is not an integer.
+     */
+    const TypeInt *asInt(const Type *ty);
+
+    /**
+     * @brief Determines if an expression can be used where a value of the target type is expected. Along with subtypes,
+     * this allows integers to be implicitly converted to a type which can represent all of their values, and constant INT
+     * expressions to be converted to any integer type which can hold their value. Conversions are recorded for codegen.
+     *
+     * @param ctx The expression
+     * @param exprType The type of the expression
+     * @param target The type that is expected
+     * @return true If the expression can be used as the target type
+     * @return false If it cannot
+     */
+    bool isAssignable(WPLParser::ExpressionContext *ctx, const Type *exprType, const Type *target);
+
+    /**
+     * @brief Finds the integer type that the operands of a binary expression are computed in, recording the conversion of
+     * the other operand to it.
+     *
+     * @return const TypeInt* The common type, or nullptr if neither operand can be implicitly converted to the type of the other.
+     */
+    const TypeInt *unifyInts(WPLParser::ExpressionContext *left, const TypeInt *leftType, WPLParser::ExpressionContext *right, const TypeInt *rightType);
+
+    /**
+     * @brief Marks the operands of an &/| which are cheap to evaluate and have no side effects, so that they
+     * can be generated without short-circuit branches.
+     *
+     * @param operands The operands of the &/|
+     */
+    void recordSpeculatable(std::vector<WPLParser::ExpressionContext *> operands);
+
+    // The most operations an operand of &/| can take for it to be evaluated without branching around it
+    static const unsigned int MAX_SPECULATION_COST = 4;
+
     // INFO: TEST UNERLYING FNS!!!
     std::optional<Scope *> safeExitScope(antlr4::ParserRuleContext *ctx)
     {
@@ -324,7 +509,7 @@ private:
                     details << e->toString() << "; ";
                 }
 
-                errorHandler.addSemanticError(ctx->getStart(), "Uninferred types in context: " + details.str());
+                errorHandler.addSemanticError(ctx, "Uninferred types in context: " + details.str());
             }
         }
 
@@ -344,7 +529,7 @@ private:
                 return inv; 
             }
 
-            errorHandler.addSemanticError(ctx->getStart(), "Cannot invoke " + sym->toString());
+            errorHandler.addSemanticError(ctx, "Cannot invoke " + sym->toString());
             return {};
         }
 
@@ -0,0 +1,422 @@
+#include "ModuleInterface.h"
+
+bool ModuleInterface::write(std::ostream &out, std::vector<const Symbol *> exports, unsigned int abiFlags)
+{
+    // Types are written to their own buffer first as we do not know how many there will be until all symbols are processed.
+    std::ostringstream typeTable;
+    std::map<const Type *, unsigned int> ids;
+
+    std::vector<std::pair<const Symbol *, unsigned int>> symbols;
+
+    for (const Symbol *sym : exports)
+    {
+        std::optional<unsigned int> id = writeType(typeTable, sym->type, ids);
+
+        if (!id)
+            return false;
+
+        symbols.push_back({sym, id.value()});
+    }
+
+    out.write("WPLI", 4);
+    writeInt(out, VERSION);
+    writeInt(out, abiFlags);
+
+    writeInt(out, ids.size());
+    out << typeTable.str();
+
+    writeInt(out, symbols.size());
+    for (auto e : symbols)
+    {
+        writeStr(out, e.first->identifier);
+        writeInt(out, (e.first->isDefinition ? DEFINITION : 0) | (e.first->isGlobal ? GLOBAL : 0));
+        writeInt(out, e.second);
+    }
+
+    return out.good();
+}
+
+std::optional<std::vector<Symbol *>> ModuleInterface::read(std::istream &in, STManager *stmgr, unsigned int abiFlags)
+{
+    char magic[4];
+    if (!in.read(magic, 4) || std::string(magic, 4) != "WPLI")
+        return {};
+
+    std::optional<unsigned int> version = readInt(in);
+    if (!version || version.value() != VERSION)
+        return {};
+
+    // Symbols compiled with a different ABI (ie, passing arrays by reference) cannot be called correctly
+    std::optional<unsigned int> interfaceFlags = readInt(in);
+    if (!interfaceFlags || interfaceFlags.value() != abiFlags)
+        return {};
+
+    // The interface symbols are placed in the global scope, so create one if it doesn't exist.
+    if (!stmgr->getCurrentScope())
+        stmgr->enterScope();
+
+    std::optional<unsigned int> numTypes = readInt(in);
+    if (!numTypes)
+        return {};
+
+    std::vector<const Type *> types;
+    for (unsigned int i = 0; i < numTypes.value(); i++)
+    {
+        std::optional<const Type *> ty = readType(in, stmgr, types);
+
+        if (!ty)
+            return {};
+
+        types.push_back(ty.value());
+    }
+
+    std::optional<unsigned int> numSymbols = readInt(in);
+    if (!numSymbols)
+        return {};
+
+    std::vector<Symbol *> ans;
+    for (unsigned int i = 0; i < numSymbols.value(); i++)
+    {
+        std::optional<std::string> name = readStr(in);
+        std::optional<unsigned int> flags = readInt(in);
+        std::optional<unsigned int> typeId = readInt(in);
+
+        if (!name || !flags || !typeId || typeId.value() >= types.size())
+            return {};
+
+        const Type *ty = types.at(typeId.value());
+
+        // A named enum/struct may have already been loaded by another interface; if so, we can skip it.
+        std::optional<Symbol *> prev = stmgr->lookupInCurrentScope(name.value());
+        if (prev && prev.value()->isDefinition && prev.value()->type == ty)
+            continue;
+
+        Symbol *sym = new Symbol(name.value(), ty, flags.value() & DEFINITION, flags.value() & GLOBAL);
+
+        if (!stmgr->addSymbol(sym))
+            return {};
+
+        ans.push_back(sym);
+    }
+
+    return ans;
+}
+
+void ModuleInterface::writeInt(std::ostream &out, unsigned int i)
+{
+    char bytes[4] = {(char)(i & 0xFF), (char)((i >> 8) & 0xFF), (char)((i >> 16) & 0xFF), (char)((i >> 24) & 0xFF)};
+    out.write(bytes, 4);
+}
+
+void ModuleInterface::writeStr(std::ostream &out, std::string str)
+{
+    writeInt(out, str.length());
+    out.write(str.data(), str.length());
+}
+
+std::optional<unsigned int> ModuleInterface::writeType(std::ostream &out, const Type *ty, std::map<const Type *, unsigned int> &ids)
+{
+    // Vars are written as whatever type they were inferred to be
+    if (const TypeInfer *inf = dynamic_cast<const TypeInfer *>(ty))
+    {
+        std::optional<const Type *> valOpt = inf->getValueType();
+
+        if (!valOpt)
+            return {};
+
+        return writeType(out, valOpt.value(), ids);
+    }
+
+    auto prev = ids.find(ty);
+    if (prev != ids.end())
+        return prev->second;
+
+    /*
+     * Write out any types this type depends on first so that they
+     * will have already been created by the time we read this one.
+     */
+    if (const TypeInt *i = dynamic_cast<const TypeInt *>(ty))
+    {
+        if (i->isSubtype(Types::INT))
+        {
+            writeInt(out, INT);
+        }
+        else
+        {
+            writeInt(out, SIZED_INT);
+            writeInt(out, i->getBits());
+            writeInt(out, i->getIsSigned());
+        }
+    }
+    else if (dynamic_cast<const TypeBool *>(ty))
+    {
+        writeInt(out, BOOL);
+    }
+    else if (dynamic_cast<const TypeStr *>(ty))
+    {
+        writeInt(out, STR);
+    }
+    else if (dynamic_cast<const TypeBot *>(ty))
+    {
+        writeInt(out, BOT);
+    }
+    else if (const TypeArray *arr = dynamic_cast<const TypeArray *>(ty))
+    {
+        std::optional<unsigned int> valId = writeType(out, arr->getValueType(), ids);
+        if (!valId)
+            return {};
+
+        writeInt(out, ARRAY);
+        writeInt(out, valId.value());
+        writeInt(out, arr->getLength());
+    }
+    else if (const TypeSlice *slice = dynamic_cast<const TypeSlice *>(ty))
+    {
+        std::optional<unsigned int> valId = writeType(out, slice->getValueType(), ids);
+        if (!valId)
+            return {};
+
+        writeInt(out, SLICE);
+        writeInt(out, valId.value());
+    }
+    else if (const TypeDynArray *dyn = dynamic_cast<const TypeDynArray *>(ty))
+    {
+        std::optional<unsigned int> valId = writeType(out, dyn->getValueType(), ids);
+        if (!valId)
+            return {};
+
+        writeInt(out, DYN_ARRAY);
+        writeInt(out, valId.value());
+    }
+    else if (const TypeInvoke *inv = dynamic_cast<const TypeInvoke *>(ty))
+    {
+        std::vector<unsigned int> paramIds;
+        for (const Type *param : inv->getParamTypes())
+        {
+            std::optional<unsigned int> paramId = writeType(out, param, ids);
+            if (!paramId)
+                return {};
+            paramIds.push_back(paramId.value());
+        }
+
+        std::optional<unsigned int> retId = writeType(out, inv->getReturnType(), ids);
+        if (!retId)
+            return {};
+
+        writeInt(out, INVOKE);
+        writeInt(out, paramIds.size());
+        for (unsigned int id : paramIds)
+            writeInt(out, id);
+        writeInt(out, retId.value());
+        writeInt(out, inv->isVariadic());
+    }
+    else if (const TypeSum *sum = dynamic_cast<const TypeSum *>(ty))
+    {
+        std::vector<unsigned int> caseIds;
+        for (const Type *c : sum->getCases())
+        {
+            std::optional<unsigned int> caseId = writeType(out, c, ids);
+            if (!caseId)
+                return {};
+            caseIds.push_back(caseId.value());
+        }
+
+        // Only enums have a name; anonymous sums are identified by their cases alone.
+        std::optional<std::string> name = sum->getName();
+
+        writeInt(out, SUM);
+        writeInt(out, name.has_value());
+        if (name)
+            writeStr(out, name.value());
+        writeInt(out, caseIds.size());
+        for (unsigned int id : caseIds)
+            writeInt(out, id);
+    }
+    else if (const TypeStruct *product = dynamic_cast<const TypeStruct *>(ty))
+    {
+        std::vector<std::pair<std::string, unsigned int>> elementIds;
+        for (auto e : product->getElements())
+        {
+            std::optional<unsigned int> elementId = writeType(out, e.second, ids);
+            if (!elementId)
+                return {};
+            elementIds.push_back({e.first, elementId.value()});
+        }
+
+        writeInt(out, STRUCT);
+        writeStr(out, product->toString());
+        writeInt(out, elementIds.size());
+        for (auto e : elementIds)
+        {
+            writeStr(out, e.first);
+            writeInt(out, e.second);
+        }
+    }
+    else
+    {
+        // Nothing else (ie, TOP) can be exported
+        return {};
+    }
+
+    unsigned int id = ids.size();
+    ids.insert({ty, id});
+    return id;
+}
+
+std::optional<unsigned int> ModuleInterface::readInt(std::istream &in)
+{
+    unsigned char bytes[4];
+    if (!in.read((char *)bytes, 4))
+        return {};
+
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+std::optional<std::string> ModuleInterface::readStr(std::istream &in)
+{
+    std::optional<unsigned int> len = readInt(in);
+    if (!len)
+        return {};
+
+    std::string str(len.value(), '\0');
+    if (!in.read(str.data(), len.value()))
+        return {};
+
+    return str;
+}
+
+std::optional<const Type *> ModuleInterface::readType(std::istream &in, STManager *stmgr, std::vector<const Type *> &types)
+{
+    // Helper to read a reference to a previously read type
+    auto readRef = [&in, &types]() -> std::optional<const Type *>
+    {
+        std::optional<unsigned int> id = readInt(in);
+        if (!id || id.value() >= types.size())
+            return {};
+        return types.at(id.value());
+    };
+
+    std::optional<unsigned int> tag = readInt(in);
+    if (!tag)
+        return {};
+
+    switch (tag.value())
+    {
+    case INT:
+        return Types::INT;
+    case SIZED_INT:
+    {
+        std::optional<unsigned int> bits = readInt(in);
+        std::optional<unsigned int> isSigned = readInt(in);
+        if (!bits || !isSigned)
+            return {};
+
+        const Type *ty = Types::getInt(bits.value(), isSigned.value());
+        if (ty == Types::UNDEFINED)
+            return {};
+
+        return ty;
+    }
+    case BOOL:
+        return Types::BOOL;
+    case STR:
+        return Types::STR;
+    case BOT:
+        return Types::UNDEFINED;
+    case ARRAY:
+    {
+        std::optional<const Type *> valTy = readRef();
+        std::optional<unsigned int> len = readInt(in);
+        if (!valTy || !len)
+            return {};
+
+        return new TypeArray(valTy.value(), (int)len.value());
+    }
+    case SLICE:
+    {
+        std::optional<const Type *> valTy = readRef();
+        if (!valTy)
+            return {};
+
+        return new TypeSlice(valTy.value());
+    }
+    case DYN_ARRAY:
+    {
+        std::optional<const Type *> valTy = readRef();
+        if (!valTy)
+            return {};
+
+        return new TypeDynArray(valTy.value());
+    }
+    case INVOKE:
+    {
+        std::optional<unsigned int> numParams = readInt(in);
+        if (!numParams)
+            return {};
+
+        std::vector<const Type *> params;
+        for (unsigned int i = 0; i < numParams.value(); i++)
+        {
+            std::optional<const Type *> param = readRef();
+            if (!param)
+                return {};
+            params.push_back(param.value());
+        }
+
+        std::optional<const Type *> retTy = readRef();
+        std::optional<unsigned int> variadic = readInt(in);
+        if (!retTy || !variadic)
+            return {};
+
+        return new TypeInvoke(params, retTy.value(), variadic.value(), true);
+    }
+    case SUM:
+    case STRUCT:
+    {
+        // Structs are always named, but sums are only named if they are enums
+        std::optional<unsigned int> isNamed = (tag.value() == SUM) ? readInt(in) : std::optional<unsigned int>(true);
+        if (!isNamed)
+            return {};
+
+        std::optional<std::string> name = isNamed.value() ? readStr(in) : std::optional<std::string>("");
+        std::optional<unsigned int> num = readInt(in);
+        if (!name || !num)
+            return {};
+
+        std::set<const Type *, TypeCompare> cases = {};
+        LinkedMap<std::string, const Type *> elements;
+
+        for (unsigned int i = 0; i < num.value(); i++)
+        {
+            std::optional<std::string> elementName = (tag.value() == STRUCT) ? readStr(in) : std::optional<std::string>("");
+            std::optional<const Type *> elementTy = readRef();
+            if (!elementName || !elementTy)
+                return {};
+
+            if (tag.value() == STRUCT)
+                elements.insert({elementName.value(), elementTy.value()});
+            else
+                cases.insert(elementTy.value());
+        }
+
+        if (!isNamed.value())
+            return new TypeSum(cases);
+
+        // Re-use the definition if it is already known (ie, from another interface)
+        std::optional<Symbol *> prev = stmgr->lookup(name.value());
+        if (prev && prev.value()->isDefinition && prev.value()->type->toString() == name.value())
+        {
+            const Type *prevTy = prev.value()->type;
+            if ((tag.value() == SUM && dynamic_cast<const TypeSum *>(prevTy)) || (tag.value() == STRUCT && dynamic_cast<const TypeStruct *>(prevTy)))
+                return prevTy;
+        }
+
+        if (tag.value() == STRUCT)
+            return new TypeStruct(elements, name.value());
+
+        return new TypeSum(cases, name.value());
+    }
+    }
+
+    return {};
+}
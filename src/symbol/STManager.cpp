@@ -5,6 +5,7 @@ Scope &STManager::enterScope(bool insertStop)
     // This is safe because we use optionals
     Scope *next = new Scope(this->currentScope);
     next->setId(this->scopeNumber++);
+    created.push_back(std::unique_ptr<Scope>(next));
 
     this->currentScope = std::optional<Scope *>{next};
     scopes.push_back(next);
@@ -70,6 +71,9 @@ std::optional<Symbol *> STManager::lookup(std::string id)
         std::optional<Symbol *> sym = scope->lookup(id);
         if (sym)
         {
+            if (!isVisible(sym.value()))
+                return {};
+
             if (depth >= stop || sym.value()->isDefinition || sym.value()->isGlobal)
                 return sym;
             return {};
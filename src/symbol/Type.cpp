@@ -7,15 +7,54 @@ bool Type::isSubtype(const Type *other) const
         // return inf->isSupertype(this);
         return inf->isSupertype(other); 
     }
-    return other->isSupertypeFor(this);
+
+    // Only queries against composite types are worth caching (and TypeInfers must never be cached as checking them updates their type)
+    if (!(dynamic_cast<const TypeSum *>(other) || dynamic_cast<const TypeInvoke *>(other) || dynamic_cast<const TypeArray *>(other) || dynamic_cast<const TypeSlice *>(other) || dynamic_cast<const TypeDynArray *>(other)))
+        return other->isSupertypeFor(this);
+
+    std::optional<bool> cached = SubtypeCache::lookup(this, other);
+    if (cached)
+        return cached.value();
+
+    bool ans = other->isSupertypeFor(this);
+    SubtypeCache::insert(this, other, ans);
+    return ans;
 }
 
+/*
+ * Subtype Cache
+ */
+thread_local std::map<std::pair<const Type *, const Type *>, bool> SubtypeCache::cache = {};
+
+std::optional<bool> SubtypeCache::lookup(const Type *sub, const Type *super)
+{
+    auto ans = cache.find({sub, super});
+
+    if (ans == cache.end())
+        return {};
+
+    return ans->second;
+}
+
+void SubtypeCache::insert(const Type *sub, const Type *super, bool result)
+{
+    cache.insert({{sub, super}, result});
+}
+
+void SubtypeCache::clear() { cache.clear(); }
+
+unsigned int SubtypeCache::size() { return cache.size(); }
+
 /*
  * INT Types
  */
 bool TypeInt::isSupertypeFor(const Type *other) const
 {
-    return dynamic_cast<const TypeInt *>(other);
+    // Integers of different sizes or signedness are only related through (implicit or explicit) conversions
+    if (const TypeInt *i = dynamic_cast<const TypeInt *>(other))
+        return i->bits == bits && i->isSigned == isSigned;
+
+    return false;
 }
 
 /*
@@ -41,4 +80,23 @@ bool TypeStr::isSupertypeFor(const Type *other) const
 bool TypeBot::isSupertypeFor(const Type *other) const
 {
     return false;
-}
\ No newline at end of file
+}
+
+/*
+ * Invokables
+ */
+bool TypeInvoke::hasAggregateSignature() const
+{
+    // Slices are already a reference to their elements, so they are passed the same way by both
+    auto isAggregate = [](const Type *ty) {
+        return dynamic_cast<const TypeArray *>(ty) || dynamic_cast<const TypeDynArray *>(ty) || dynamic_cast<const TypeStruct *>(ty) || dynamic_cast<const TypeSum *>(ty);
+    };
+
+    for (const Type *ty : paramTypes)
+    {
+        if (isAggregate(ty))
+            return true;
+    }
+
+    return isAggregate(retType);
+}
@@ -0,0 +1,98 @@
+#pragma once
+/**
+ * @file ModuleInterface.h
+ * @author Alex Friedman (ahfriedman.com)
+ * @brief Serializes the exported symbols of a WPL file to (and from) a binary module interface (.wpli) file
+ * @version 0.1
+ * @date 2022-11-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#include "STManager.h"
+#include <iostream>
+#include <map>
+
+/**
+ * @brief Reads and writes module interface (.wpli) files.
+ *
+ * A module interface describes everything another file needs in order to use a compiled
+ * WPL file without reparsing it: its FUNC/PROC signatures, its enum and struct definitions,
+ * and its global variables. The format is as follows (all integers are 32-bit little endian):
+ *
+ *   "WPLI" <version> <ABI flags>
+ *   <number of types> <type>...       Each type only refers to types that appear before it
+ *   <number of symbols> <symbol>...   Each symbol is <name> <flags> <type index>
+ *
+ * where strings are written as their length followed by their characters. The ABI flags are the
+ * compiler flags which change how values are laid out or passed (ie, AGGREGATE_REFS); an interface
+ * can only be read by a compilation that uses the same ones.
+ */
+class ModuleInterface
+{
+public:
+    /**
+     * @brief Writes a module interface describing the provided symbols
+     *
+     * @param out The (binary) stream to write to
+     * @param exports The symbols to export. These should all be from the global scope.
+     * @param abiFlags The compiler flags that affect the ABI of the exported symbols
+     * @return true If the interface was written
+     * @return false If one of the symbols could not be exported (ie, a VAR that was never inferred)
+     */
+    static bool write(std::ostream &out, std::vector<const Symbol *> exports, unsigned int abiFlags = 0);
+
+    /**
+     * @brief Reads a module interface, adding each of its symbols to the current (global) scope of the provided STManager.
+     *
+     * NOTE: Named enums and structs that are already defined in the STManager (ie, from another
+     * interface) are re-used so that types shared between modules remain compatible with each other.
+     *
+     * @param in The (binary) stream to read from
+     * @param stmgr The symbol table manager to load the symbols into. A global scope is entered if there is not one already.
+     * @param abiFlags The compiler flags that affect the ABI of the current compilation. These must match the ones the interface was written with.
+     * @return std::optional<std::vector<Symbol *>> The symbols that were loaded; empty if the interface was malformed, was written with different ABI flags, or conflicted with an existing symbol.
+     */
+    static std::optional<std::vector<Symbol *>> read(std::istream &in, STManager *stmgr, unsigned int abiFlags = 0);
+
+private:
+    static const unsigned int VERSION = 2;
+
+    /**
+     * @brief Kinds of types that can appear in an interface
+     *
+     */
+    enum TypeTag
+    {
+        INT = 1,
+        BOOL = 2,
+        STR = 3,
+        BOT = 4,
+        ARRAY = 5,
+        INVOKE = 6,
+        SUM = 7,
+        STRUCT = 8,
+        SIZED_INT = 9, // Any integer other than INT; followed by its size and signedness
+        SLICE = 10,    // Followed by the value type
+        DYN_ARRAY = 11, // Followed by the value type
+    };
+
+    /**
+     * @brief Flags used to preserve information about each symbol
+     *
+     */
+    enum SymbolFlags
+    {
+        DEFINITION = 1,
+        GLOBAL = 2,
+    };
+
+    static void writeInt(std::ostream &out, unsigned int i);
+    static void writeStr(std::ostream &out, std::string str);
+    static std::optional<unsigned int> writeType(std::ostream &out, const Type *ty, std::map<const Type *, unsigned int> &ids);
+
+    static std::optional<unsigned int> readInt(std::istream &in);
+    static std::optional<std::string> readStr(std::istream &in);
+    static std::optional<const Type *> readType(std::istream &in, STManager *stmgr, std::vector<const Type *> &types);
+};
@@ -16,11 +16,28 @@
 #include <optional>
 
 #include <stack>
+#include <functional>
+#include <memory>
 
 class STManager {
   public:
     STManager(){};
 
+    /**
+     * @brief Construct a new STManager layered over an existing global scope. The global
+     * scope is only ever read from, so multiple managers can safely share it (ie, when
+     * checking function bodies in parallel).
+     * 
+     * @param global The (frozen) global scope to layer over
+     * @param visible Used to hide symbols that should not yet be visible (ie, globals declared later in the file)
+     */
+    STManager(Scope *global, std::function<bool(const Symbol *)> visible) {
+      scopes.push_back(global);
+      currentScope = global;
+      scopeNumber = global->getId() + 1;
+      isVisible = visible;
+    };
+
     /**
      * @brief Enter a new scope
      * 
@@ -106,8 +123,11 @@ class STManager {
 
   private:
     std::vector<Scope*> scopes;
+    std::vector<std::unique_ptr<Scope>> created; // Every scope this manager entered, which it frees along with itself (a shared global scope is not included)
     std::optional<Scope*> currentScope = {}; 
     int scopeNumber = 0;
 
     std::stack<int> stops; 
+
+    std::function<bool(const Symbol *)> isVisible = [](const Symbol *) { return true; };
 };
\ No newline at end of file
@@ -91,6 +91,10 @@ public:
     /**
      * @brief Get the Uninferred objects in the current scope
      *
+     * This acts as the final resolution pass for type inference: looking up each var
+     * compresses its path to the representative of its inference set, so any later
+     * queries of the var's type (ie, in code generation) are effectively constant time.
+     *
      * @return std::vector<const Symbol*> A vector of all the uninferred symbols in the scope
      */
     std::vector<const Symbol *> getUninferred()
@@ -34,7 +34,8 @@ struct Symbol
     std::string identifier; // Mostly needed for our tostring function
     const Type *type;       // Keeps track of the symbol's type
 
-    std::optional<llvm::AllocaInst *> val;
+    // Storage for the symbol; usually an allocation, but may be a pointer argument for aggregates passed by reference
+    std::optional<llvm::Value *> val;
 
     bool isGlobal;
 
@@ -23,6 +23,7 @@
 #include <optional> // Optionals
 
 #include <set> // Sets
+#include <map> // Maps
 
 #include <climits> // Max & Min
 
@@ -91,16 +92,156 @@ protected:
 
 /*******************************************
  *
- * Integer (32 bit, signed) Type Definition
+ * Subtype Cache
+ *
+ *******************************************/
+
+/**
+ * @brief Memoizes subtype queries against composite types (sums, invokables, and arrays of any kind), as these
+ * recursively compare their cases/parameters/elements every time they are checked.
+ *
+ * Queries are keyed on the pair of type objects involved, so they only hit when the same objects are
+ * compared again (ie, a named enum passed through many functions). Queries involving a TypeInfer are
+ * never cached as checking them can update the type of the var. The cache is thread local so that
+ * function bodies can be checked in parallel, and should be cleared at the start of each compilation.
+ */
+class SubtypeCache
+{
+public:
+    /**
+     * @brief Looks up the result of a previous subtype query
+     *
+     * @param sub The proposed subtype
+     * @param super The proposed supertype
+     * @return std::optional<bool> Empty if this query has not been cached; otherwise, the result of the query.
+     */
+    static std::optional<bool> lookup(const Type *sub, const Type *super);
+
+    /**
+     * @brief Records the result of a subtype query
+     *
+     * @param sub The proposed subtype
+     * @param super The proposed supertype
+     * @param result If sub is a subtype of super
+     */
+    static void insert(const Type *sub, const Type *super, bool result);
+
+    /**
+     * @brief Removes all cached queries (on the current thread)
+     *
+     */
+    static void clear();
+
+    /**
+     * @brief Gets the number of cached queries (on the current thread)
+     *
+     * @return unsigned int
+     */
+    static unsigned int size();
+
+private:
+    static thread_local std::map<std::pair<const Type *, const Type *>, bool> cache;
+};
+
+/*******************************************
+ *
+ * Integer (8, 16, 32, or 64 bit; signed or unsigned) Type Definition
  *
  *******************************************/
 class TypeInt : public Type
 {
+private:
+    /**
+     * @brief The number of bits in the integer
+     *
+     */
+    unsigned int bits;
+
+    /**
+     * @brief If the integer is signed (ie, int8) or unsigned (ie, uint8)
+     *
+     */
+    bool isSigned;
+
 public:
-    std::string toString() const override { return "INT"; }
+    /**
+     * @brief Construct a new TypeInt. By default, this is a signed 32 bit integer (INT).
+     *
+     * @param b The number of bits in the integer. NOTE: THIS SHOULD BE 8, 16, 32, OR 64!
+     * @param s If the integer is signed
+     */
+    TypeInt(unsigned int b = 32, bool s = true)
+    {
+        bits = b;
+        isSigned = s;
+    }
+
+    /**
+     * @brief Returns INT for 32 bit signed integers; otherwise, INT<bits> or UINT<bits> (ie, INT8, UINT32).
+     *
+     * @return std::string String name representation of this type.
+     */
+    std::string toString() const override
+    {
+        if (bits == 32 && isSigned)
+            return "INT";
+
+        return (isSigned ? "INT" : "UINT") + std::to_string(bits);
+    }
+
     llvm::Type *getLLVMType(llvm::Module *M) const override
     {
-        return llvm::Type::getInt32Ty(M->getContext());
+        return llvm::Type::getIntNTy(M->getContext(), bits);
+    }
+
+    /**
+     * @brief Get the number of bits in the integer
+     *
+     * @return unsigned int
+     */
+    unsigned int getBits() const { return bits; }
+
+    /**
+     * @brief Determines if the integer is signed
+     *
+     * @return true if signed
+     * @return false if unsigned
+     */
+    bool getIsSigned() const { return isSigned; }
+
+    /**
+     * @brief Determines if every value of another integer type can be represented by this one
+     * (ie, an INT8 or UINT16 by an INT, but not a UINT32 by an INT).
+     *
+     * @param other The integer type to test
+     * @return true if all of other's values fit in this type
+     * @return false if some of other's values do not
+     */
+    bool canRepresent(const TypeInt *other) const
+    {
+        if (isSigned == other->isSigned)
+            return bits >= other->bits;
+
+        // A signed integer needs an extra bit to represent all of an unsigned integer's values
+        return isSigned && bits > other->bits;
+    }
+
+    /**
+     * @brief Determines if a value can be represented by this type
+     *
+     * @param value The value to test
+     * @return true if value is in this type's range
+     * @return false if value is out of this type's range
+     */
+    bool canRepresent(int64_t value) const
+    {
+        if (!isSigned)
+            return value >= 0 && (bits == 64 || (uint64_t)value < ((uint64_t)1 << bits));
+
+        if (bits == 64)
+            return true;
+
+        return value >= -((int64_t)1 << (bits - 1)) && value < ((int64_t)1 << (bits - 1));
     }
 
 protected:
@@ -174,9 +315,40 @@ struct TypeCompare
 namespace Types
 {
     inline const Type *INT = new TypeInt();
+    inline const Type *INT8 = new TypeInt(8, true);
+    inline const Type *INT16 = new TypeInt(16, true);
+    inline const Type *INT64 = new TypeInt(64, true);
+    inline const Type *UINT8 = new TypeInt(8, false);
+    inline const Type *UINT16 = new TypeInt(16, false);
+    inline const Type *UINT32 = new TypeInt(32, false);
+    inline const Type *UINT64 = new TypeInt(64, false);
     inline const Type *BOOL = new TypeBool();
     inline const Type *STR = new TypeStr();
     inline const Type *UNDEFINED = new TypeBot();
+
+    /**
+     * @brief Gets the basic type for an integer of the given size and signedness
+     *
+     * @param bits The number of bits in the integer (8, 16, 32, or 64)
+     * @param isSigned If the integer is signed
+     * @return const Type* The integer type, or UNDEFINED if there is no integer of that size
+     */
+    inline const Type *getInt(unsigned int bits, bool isSigned)
+    {
+        switch (bits)
+        {
+        case 8:
+            return isSigned ? INT8 : UINT8;
+        case 16:
+            return isSigned ? INT16 : UINT16;
+        case 32:
+            return isSigned ? INT : UINT32;
+        case 64:
+            return isSigned ? INT64 : UINT64;
+        }
+
+        return UNDEFINED;
+    }
 };
 
 /*******************************************
@@ -272,6 +444,155 @@ protected:
     }
 };
 
+/*******************************************
+ *
+ * Dynamic Array Type Definition
+ *
+ *******************************************/
+class TypeDynArray : public Type
+{
+private:
+    /**
+     * @brief The type of the elements
+     *
+     */
+    const Type *valueType;
+
+public:
+    /**
+     * @brief Construct a new TypeDynArray
+     *
+     * @param v The type of the elements
+     */
+    TypeDynArray(const Type *v) { valueType = v; }
+
+    /**
+     * @brief Returns the name of the dynamic array in the form of <valueType name>[*].
+     *
+     * @return std::string String name representation of this type.
+     */
+    std::string toString() const override { return valueType->toString() + "[*]"; }
+
+    /**
+     * @brief Get the Value Type object
+     *
+     * @return const Type*
+     */
+    const Type *getValueType() const { return valueType; }
+
+    /**
+     * @brief Dynamic arrays keep their elements on the heap (managed by the runtime), so they are represented as a
+     * pointer to the first element along with the number of elements and how many there is room for. This layout
+     * must match WplArray in the runtime.
+     *
+     * @param M LLVM Module
+     * @return llvm::Type* { <valueType>*, i32, i32 }
+     */
+    llvm::Type *getLLVMType(llvm::Module *M) const override
+    {
+        llvm::Type *i32 = llvm::Type::getInt32Ty(M->getContext());
+        return llvm::StructType::get(M->getContext(), {valueType->getLLVMType(M)->getPointerTo(), i32, i32});
+    }
+
+protected:
+    bool isSupertypeFor(const Type *other) const override
+    {
+        if (const TypeDynArray *p = dynamic_cast<const TypeDynArray *>(other))
+            return p->valueType->isSubtype(valueType) && valueType->isSubtype(p->valueType);
+
+        return false;
+    }
+};
+
+/*******************************************
+ *
+ * Array Slice Type Definition
+ *
+ *******************************************/
+class TypeSlice : public Type
+{
+private:
+    /**
+     * @brief The type of the elements
+     *
+     */
+    const Type *valueType;
+
+public:
+    /**
+     * @brief Construct a new TypeSlice
+     *
+     * @param v The type of the elements
+     */
+    TypeSlice(const Type *v) { valueType = v; }
+
+    /**
+     * @brief Returns the name of the slice in the form of <valueType name>[].
+     *
+     * @return std::string String name representation of this type.
+     */
+    std::string toString() const override { return valueType->toString() + "[]"; }
+
+    /**
+     * @brief Get the Value Type object
+     *
+     * @return const Type*
+     */
+    const Type *getValueType() const { return valueType; }
+
+    /**
+     * @brief Slices refer to the elements of an array stored elsewhere, so they are represented as a pointer
+     * to the first element along with the number of elements.
+     *
+     * @param M LLVM Module
+     * @return llvm::Type* { <valueType>*, i32 }
+     */
+    llvm::Type *getLLVMType(llvm::Module *M) const override
+    {
+        return llvm::StructType::get(M->getContext(), {valueType->getLLVMType(M)->getPointerTo(), llvm::Type::getInt32Ty(M->getContext())});
+    }
+
+protected:
+    bool isSupertypeFor(const Type *other) const override
+    {
+        /*
+         * Slices can refer to any array (fixed, dynamic, or another slice) with the same element type. As elements are
+         * read and written in place, their types must match exactly rather than just being subtypes.
+         */
+        const Type *otherValueType = nullptr;
+
+        if (const TypeArray *p = dynamic_cast<const TypeArray *>(other))
+            otherValueType = p->getValueType();
+        else if (const TypeSlice *p = dynamic_cast<const TypeSlice *>(other))
+            otherValueType = p->valueType;
+        else if (const TypeDynArray *p = dynamic_cast<const TypeDynArray *>(other))
+            otherValueType = p->getValueType();
+
+        return otherValueType && otherValueType->isSubtype(valueType) && valueType->isSubtype(otherValueType);
+    }
+};
+
+namespace Types
+{
+    /**
+     * @brief Gets the type of the elements of any kind of array (fixed, dynamic, or slice)
+     *
+     * @param ty The type of the array
+     * @return const Type* The type of its elements, or nullptr if ty is not an array
+     */
+    inline const Type *getArrayValueType(const Type *ty)
+    {
+        if (const TypeArray *arr = dynamic_cast<const TypeArray *>(ty))
+            return arr->getValueType();
+        if (const TypeSlice *slice = dynamic_cast<const TypeSlice *>(ty))
+            return slice->getValueType();
+        if (const TypeDynArray *dyn = dynamic_cast<const TypeDynArray *>(ty))
+            return dyn->getValueType();
+
+        return nullptr;
+    }
+};
+
 /*******************************************
  *
  * Invokable (FUNC/PROC) Type Definition
@@ -305,6 +626,12 @@ private:
      */
     bool defined = true;
 
+    /**
+     * @brief Determines if the function is an extern, and so must follow the C calling convention
+     *
+     */
+    bool external = false;
+
     /**
      * @brief Name used by llvm to represent this function
      *
@@ -407,21 +734,78 @@ public:
         return description.str();
     }
 
+    /**
+     * @brief Name of the module flag which, when set, makes invokables take aggregate (array, struct, and sum) arguments
+     * as pointers, and return aggregates through a pointer to storage provided by the caller (sret).
+     */
+    static constexpr const char *AGGREGATE_REFS_FLAG = "wpl.aggregate-refs";
+
+    /**
+     * @brief Determines if values of the given type are passed to (or returned from) invokables by reference
+     *
+     * @param M LLVM Module
+     * @param ty The type of the parameter or return
+     * @return true If the value is passed as a pointer to its storage
+     * @return false If the value is passed directly
+     */
+    static bool passesByReference(llvm::Module *M, const Type *ty)
+    {
+        // Slices are already a reference to their elements, so they are passed as-is
+        return M->getModuleFlag(AGGREGATE_REFS_FLAG) && ty->getLLVMType(M)->isAggregateType() && !dynamic_cast<const TypeSlice *>(ty);
+    }
+
+    /**
+     * @brief Determines if this invokable takes the given parameter by reference. Externs are defined outside of WPL,
+     * so they always take their parameters by value.
+     *
+     * @param M LLVM Module
+     * @param ty The type of the parameter
+     * @return true If the argument is passed as a pointer to its storage
+     * @return false If the argument is passed directly
+     */
+    bool takesByReference(llvm::Module *M, const Type *ty) const { return !external && passesByReference(M, ty); }
+
+    /**
+     * @brief Determines if this invokable returns its value through a pointer passed as its first argument
+     *
+     * @param M LLVM Module
+     * @return true If the return is through an sret argument
+     * @return false If the value is returned directly
+     */
+    bool hasStructReturn(llvm::Module *M) const { return takesByReference(M, retType); }
+
+    /**
+     * @brief Determines if this invokable takes or returns an aggregate (array, dynamic array, struct, or sum). Under
+     * AGGREGATE_REFS, WPL invokables pass these by reference while externs pass them by value, so such an extern
+     * cannot be called through a function value.
+     *
+     * @return true If any parameter or the return is an aggregate
+     * @return false If all parameters and the return are passed the same way by externs and WPL invokables
+     */
+    bool hasAggregateSignature() const; // Defined in .cpp
+
     // TODO: Build LLVM Type here instead of in codegen!
     llvm::Type *getLLVMType(llvm::Module *M) const override
     {
         // Cretae a vector for our argument types
         std::vector<llvm::Type *> typeVec;
 
+        llvm::Type *ret = retType->getLLVMType(M); // FIXME: WHEN THIS WAS RETTYPE, TRY THAT CASE IN WPL
+
+        if (hasStructReturn(M))
+        {
+            typeVec.push_back(ret->getPointerTo());
+            ret = llvm::Type::getVoidTy(M->getContext());
+        }
+
         for (const Type *ty : paramTypes)
         {
-            typeVec.push_back(ty->getLLVMType(M));
+            llvm::Type *paramTy = ty->getLLVMType(M);
+            typeVec.push_back(takesByReference(M, ty) ? paramTy->getPointerTo() : paramTy);
         }
 
         llvm::ArrayRef<llvm::Type *> paramRef = llvm::ArrayRef(typeVec);
 
-        llvm::Type *ret = retType->getLLVMType(M); // FIXME: WHEN THIS WAS RETTYPE, TRY THAT CASE IN WPL
-
         llvm::FunctionType *fnType = llvm::FunctionType::get(
             ret,
             paramRef,
@@ -481,6 +865,24 @@ public:
         mthis->defined = true;
     }
 
+    /**
+     * @brief Returns if this is an extern
+     *
+     * @return true
+     * @return false
+     */
+    bool isExtern() const { return external; }
+
+    /**
+     * @brief Marks this invokable as an extern
+     *
+     */
+    void markExtern() const
+    {
+        TypeInvoke *mthis = const_cast<TypeInvoke *>(this);
+        mthis->external = true;
+    }
+
 protected:
     bool isSupertypeFor(const Type *other) const override
     {
@@ -513,25 +915,62 @@ protected:
  * Type used for Type Inference
  *
  *******************************************/
+
+/**
+ * @brief Inference variable for VAR declarations.
+ *
+ * Inference variables which must share a type are tracked as a disjoint set (union-find)
+ * using union by rank and path compression. Only the root (representative) of each set
+ * stores the inferred type, so linking two vars or resolving a var costs near-constant
+ * time regardless of how long the chain of dependencies between vars is.
+ */
 class TypeInfer : public Type
 {
 private:
     /**
-     * @brief Optional type that represents the inferred type (type this is acting as). Empty if inference was unable to determine the type or is not complete
+     * @brief Parent of this var in its inference set. Points to itself if this is the representative of the set.
+     *
+     */
+    mutable const TypeInfer *parent;
+
+    /**
+     * @brief Upper bound on the height of the tree rooted at this var. Only meaningful on the representative.
      *
      */
-    std::optional<const Type *> *valueType;
+    mutable unsigned int rank = 0;
 
     /**
-     * @brief Keeps track of all the other inferred types that this shares a dependency with.
+     * @brief Optional type that represents the inferred type (type this is acting as). Empty if inference was unable to determine the type or is not complete. Only meaningful on the representative.
      *
      */
-    std::vector<const TypeInfer *> infTypes;
+    mutable std::optional<const Type *> valueType = {};
 
 public:
     TypeInfer()
     {
-        valueType = new std::optional<const Type *>;
+        parent = this;
+    }
+
+    /**
+     * @brief Finds the representative of this var's inference set. Every var visited along the way is re-pointed directly at the representative (path compression).
+     *
+     * @return const TypeInfer* The representative of the set
+     */
+    const TypeInfer *find() const
+    {
+        const TypeInfer *root = this;
+        while (root->parent != root)
+            root = root->parent;
+
+        const TypeInfer *curr = this;
+        while (curr->parent != root)
+        {
+            const TypeInfer *next = curr->parent;
+            curr->parent = root;
+            curr = next;
+        }
+
+        return root;
     }
 
     /**
@@ -540,7 +979,14 @@ public:
      * @return true
      * @return false
      */
-    bool hasBeenInferred() const { return valueType->has_value(); }
+    bool hasBeenInferred() const { return find()->valueType.has_value(); }
+
+    /**
+     * @brief Gets the type that this var has been inferred as
+     *
+     * @return std::optional<const Type *> Empty if type inference has not determined the type of this var yet
+     */
+    std::optional<const Type *> getValueType() const { return find()->valueType; }
 
     /**
      * @brief Returns VAR if type inference has not been completed or {VAR/<INFERRED TYPE>} if type inference has completed.
@@ -549,9 +995,10 @@ public:
      */
     std::string toString() const override
     {
-        if (hasBeenInferred())
+        const TypeInfer *root = find();
+        if (root->valueType)
         {
-            return "{VAR/" + valueType->value()->toString() + "}";
+            return "{VAR/" + root->valueType.value()->toString() + "}";
         }
         return "VAR";
     }
@@ -564,15 +1011,14 @@ public:
      */
     llvm::Type *getLLVMType(llvm::Module *M) const override
     {
-        if (valueType->has_value())
-            return valueType->value()->getLLVMType(M);
+        const TypeInfer *root = find();
+        if (root->valueType)
+            return root->valueType.value()->getLLVMType(M);
 
         // This should never happen: we should have always detected such cases in our semantic analyis
         return nullptr;
     }
 
-    // TODO: There shouldn't be any parody in codegen, but something does seem off.
-
 protected:
     /**
      * @brief Internal helper function used to try updating the type that this inference represents
@@ -584,34 +1030,56 @@ protected:
     bool setValue(const Type *other) const
     {
         // Prevent us from being sent another TypeInfer. There's no reason for this to happen
-        // as it should have been added as a dependency (and doing this would break things)
+        // as it should have been unioned with this set instead (and doing this would break things)
         if (dynamic_cast<const TypeInfer *>(other))
             return false;
 
+        const TypeInfer *root = find();
+
         // If we have already inferred a type, we just need to check
         // that that type is a subtype of other.
-        if (valueType->has_value())
+        if (root->valueType)
         {
-            return other->isSubtype(valueType->value()); // NOTE: CONDITION INVERSED BECAUSE WE CALL IT INVERSED IN SYMBOL.CPP!
+            return other->isSubtype(root->valueType.value()); // NOTE: CONDITION INVERSED BECAUSE WE CALL IT INVERSED IN SYMBOL.CPP!
         }
 
-        // Set our valueType to be the provided type to see if anything breaks...
-        TypeInfer *mthis = const_cast<TypeInfer *>(this);
-        *mthis->valueType = other;
+        // As only the representative stores the type, this updates every var in the set at once.
+        root->valueType = other;
+        return true;
+    }
 
-        // Run through our dependencies making sure they can all also
-        // be compatible with having a type of other.
-        bool valid = true;
-        for (const TypeInfer *ty : infTypes)
-        {
-            if (!ty->setValue(other))
-            {
-                valid = false;
-            }
-        }
+    /**
+     * @brief Merges the inference sets of this var and another (union by rank).
+     *
+     * @param other The var whose set should be merged with ours
+     * @return true If the sets could be merged without conflicting inferred types
+     * @return false If both sets had already been inferred to incompatible types. Neither set is changed.
+     */
+    bool unite(const TypeInfer *other) const
+    {
+        const TypeInfer *a = find();
+        const TypeInfer *b = other->find();
+
+        if (a == b)
+            return true;
+
+        // If both sets have been inferred, they must agree. Otherwise, the merged set takes whichever value exists.
+        if (a->valueType && b->valueType && a->valueType.value()->isNotSubtype(b->valueType.value()))
+            return false;
+
+        std::optional<const Type *> merged = a->valueType ? a->valueType : b->valueType;
+
+        // Attach the shallower tree under the deeper one so find() stays near-constant.
+        if (a->rank < b->rank)
+            std::swap(a, b);
+
+        b->parent = a;
+        b->valueType = {};
+        if (a->rank == b->rank)
+            a->rank++;
 
-        // Return true/false depending on if the afformentoned process was successful.
-        return valid;
+        a->valueType = merged;
+        return true;
     }
 
     /**
@@ -623,30 +1091,9 @@ protected:
      */
     bool isSupertypeFor(const Type *other) const override
     {
-        // If we already have an inferred type, we can simply
-        // check if that type is a subtype of other.
-        if (valueType->has_value())
-            return other->isSubtype(valueType->value());
-
-        /*
-         * If the other type is also an inference type...
-         */
+        // If the other type is also an inference type, then the two must share a type from now on.
         if (const TypeInfer *oinf = dynamic_cast<const TypeInfer *>(other))
-        {
-            // If the other inference type has a value determined, try using that
-            if (oinf->valueType->has_value())
-            {
-                return setValue(oinf->valueType->value());
-            }
-
-            // Otherwise, add the types to be dependencies of eachother, and return true.
-            TypeInfer *mthis = const_cast<TypeInfer *>(this);
-            mthis->infTypes.push_back(oinf);
-
-            TypeInfer *moth = const_cast<TypeInfer *>(oinf);
-            moth->infTypes.push_back(this);
-            return true;
-        }
+            return unite(oinf);
 
         // Try to update this type's inferred value with the other type
         return setValue(other);
@@ -690,6 +1137,13 @@ public:
 
     std::set<const Type *, TypeCompare> getCases() const { return cases; }
 
+    /**
+     * @brief Gets the name of the sum if it was defined as an enum; anonymous sums (ie, from a type like (int + boolean)) have none.
+     *
+     * @return std::optional<std::string>
+     */
+    std::optional<std::string> getName() const { return name; }
+
     unsigned int getIndex(llvm::Module *M, llvm::Type *toFind) const
     {
         unsigned i = 1;
@@ -735,9 +1189,31 @@ public:
     }
 
     /**
-     * @brief Gets the LLVM type for an array of the given valueType and length.
+     * @brief Name of the module flag which, when set, makes sums use the compact layout (see getLLVMType).
+     * As it changes the representation of every sum, all modules that share sums must agree on it.
+     */
+    static constexpr const char *COMPACT_LAYOUT_FLAG = "wpl.compact-sums";
+
+    /**
+     * @brief Gets the type of the tag which identifies which case a value of this sum holds.
      *
-     * @param C LLVM Context
+     * @param M LLVM Module
+     * @return llvm::IntegerType*
+     */
+    llvm::IntegerType *getTagType(llvm::Module *M) const
+    {
+        return llvm::cast<llvm::IntegerType>(llvm::cast<llvm::StructType>(getLLVMType(M))->getElementType(0));
+    }
+
+    /**
+     * @brief Gets the LLVM type for the sum: a struct of the tag followed by storage for the largest case.
+     *
+     * By default, the tag is an i32 and the storage is a byte array. If the module has the COMPACT_LAYOUT_FLAG set, then
+     * the tag is the smallest integer that can hold every case's index, and the storage is an array of the most strictly
+     * aligned case so that payloads can be accessed without misaligned loads. Either way, the layout is only
+     * computed once per module as the result is looked up by name on future calls.
+     *
+     * @param M LLVM Module
      * @return llvm::Type*
      */
     llvm::Type *getLLVMType(llvm::Module *M) const override
@@ -747,6 +1223,31 @@ public:
         if (ty)
             return ty;
 
+        if (M->getModuleFlag(COMPACT_LAYOUT_FLAG))
+        {
+            const llvm::DataLayout &DL = M->getDataLayout();
+
+            uint64_t size = 0;
+            llvm::Type *unit = llvm::Type::getInt8Ty(M->getContext());
+
+            for (auto e : cases)
+            {
+                llvm::Type *caseTy = e->getLLVMType(M);
+                size = std::max(size, (uint64_t)DL.getTypeAllocSize(caseTy));
+
+                // Build the storage out of the most strictly aligned case so that the storage has the same alignment
+                if (DL.getABITypeAlign(caseTy) > DL.getABITypeAlign(unit))
+                    unit = caseTy;
+            }
+
+            // Case indices start at 1 (see getIndex)
+            unsigned int tagBits = cases.size() < (1u << 8) ? 8 : cases.size() < (1u << 16) ? 16 : 32;
+
+            llvm::Type *storage = llvm::ArrayType::get(unit, llvm::divideCeil(size, DL.getTypeAllocSize(unit)));
+
+            return llvm::StructType::create(M->getContext(), {llvm::Type::getIntNTy(M->getContext(), tagBits), storage}, toString());
+        }
+
         unsigned int min = std::numeric_limits<unsigned int>::max();
         unsigned int max = std::numeric_limits<unsigned int>::min();
 
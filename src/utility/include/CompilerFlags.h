@@ -21,4 +21,16 @@
 enum CompilerFlags 
 {
   NO_RUNTIME = 1, //Used to represent that the program will NOT use a runtime (and thus we should generate a main method manually)
+  PARALLEL_SEMANTIC = 2, //Used to represent that FUNC/PROC bodies should be semantically checked in parallel once all top-level declarations are known
+  BOUNDS_CHECK = 16, //Used to represent that array accesses which are not provably in range should be checked at runtime
+  CONST_FOLD = 32, //Used to represent that constant expressions should be folded rather than generated as instructions
+  SELECT_SWITCH = 64, //Used to represent that selects which compare a single INT against constants should be generated as switches
+  COMPACT_SUMS = 128, //Used to represent that sums should use the smallest tag that fits their cases and storage aligned to their strictest case
+  AGGREGATE_REFS = 256, //Used to represent that arrays, structs, and sums should be passed to and returned from functions by reference rather than by value
+  FUNCTION_ATTRS = 512, //Used to represent that functions should be given the attributes (ie, nounwind, readonly) implied by the effects found in semantic analysis
+  TAIL_CALLS = 1024, //Used to represent that calls in tail position should reuse the caller's frame, with direct self-recursion generated as a loop
+  SINGLE_TEST_LOOPS = 2048, //Used to represent that loops should test their condition once, in a header block, rather than before the loop and again at the end of each iteration
+  STRING_POOL = 4096, //Used to represent that string literals with the same contents should share a single global
+  DEBUG_INFO = 8192, //Used to represent that DWARF debug info (subprograms, source locations, and variables) should be generated
+  BRANCHLESS_LOGIC = 16384, //Used to represent that operands of &/| which are cheap and have no side effects should be evaluated unconditionally rather than behind a short-circuit branch
 };
\ No newline at end of file
@@ -13,6 +13,8 @@
 #include <string>
 #include <vector>
 #include <sstream>
+#include <functional>
+#include <optional>
 
 /**
  * @brief Defines various error types the compiler can throw
@@ -37,6 +39,17 @@ enum ErrSev
   INFO = 8,             // Informational message (currently unused)
 };
 
+/**
+ * @brief Defines the formats that errors can be displayed in
+ *
+ */
+enum DiagnosticFormat
+{
+  TEXT,  // Human-readable text (one error per line)
+  JSON,  // A JSON array of error objects
+  SARIF  // SARIF 2.1.0 log (for CI and other tools)
+};
+
 /**
  * @brief Defines an error in the language
  *
@@ -45,27 +58,78 @@ struct WPLError
 {
   ErrType type;           // The Type of the error
   antlr4::Token *token;   // Where the error occurred
-  std::string message;    // Error Message text
+  antlr4::Token *stop;    // Last token of the source range the error refers to
 
   ErrSev severity;        // Error Severity level
 
-  WPLError(antlr4::Token *tok, std::string msg, ErrType et, ErrSev es)
+  WPLError(antlr4::Token *tok, std::string msg, ErrType et, ErrSev es) : WPLError(tok, tok, [msg]() { return msg; }, et, es) {}
+
+  WPLError(antlr4::Token *tok, antlr4::Token *end, std::function<std::string()> msg, ErrType et, ErrSev es)
   {
     token = tok;
-    message = msg;
+    stop = end ? end : tok;
+    render = msg;
 
     type = et;
     severity = es;
   }
 
+  /**
+   * @brief Gets the error message. The message is only built the first time this is called, so errors which are never displayed cost nothing to format.
+   *
+   * @return std::string The error message text
+   */
+  std::string getMessage()
+  {
+    if (!message)
+      message = render();
+    return message.value();
+  }
+
   std::string toString()
   {
     std::ostringstream e;
     e << getStringForSeverity(severity) << ": " << getStringForErrorType(type) << ": [" << token->getLine() << ',' << token->getCharPositionInLine()
-      << "]: " << message;
+      << "]: " << getMessage();
     return e.str();
   }
 
+  /**
+   * @brief Returns a JSON object describing the error. Lines are 1-based and columns are 0-based (as in toString()).
+   *
+   * @return std::string
+   */
+  std::string toJSON()
+  {
+    std::ostringstream e;
+    e << "{\"severity\": \"" << getStringForSeverity(severity) << "\", "
+      << "\"type\": \"" << getStringForErrorType(type) << "\", "
+      << "\"file\": \"" << escape(token->getTokenSource() ? token->getTokenSource()->getSourceName() : "") << "\", "
+      << "\"line\": " << token->getLine() << ", "
+      << "\"column\": " << token->getCharPositionInLine() << ", "
+      << "\"endLine\": " << stop->getLine() << ", "
+      << "\"endColumn\": " << getEndColumn() << ", "
+      << "\"message\": \"" << escape(getMessage()) << "\"}";
+    return e.str();
+  }
+
+  /**
+   * @brief Returns a SARIF result object describing the error. Lines and columns are 1-based as per the SARIF specification.
+   *
+   * @return std::string
+   */
+  std::string toSARIF()
+  {
+    std::ostringstream e;
+    e << "{\"ruleId\": \"" << getStringForErrorType(type) << "\", "
+      << "\"level\": \"" << (severity & (ERROR | CRITICAL_WARNING) ? "error" : (severity == WARNING ? "warning" : "note")) << "\", "
+      << "\"message\": {\"text\": \"" << escape(getMessage()) << "\"}, "
+      << "\"locations\": [{\"physicalLocation\": {"
+      << "\"artifactLocation\": {\"uri\": \"" << escape(token->getTokenSource() ? token->getTokenSource()->getSourceName() : "") << "\"}, "
+      << "\"region\": {\"startLine\": " << token->getLine() << ", \"startColumn\": " << token->getCharPositionInLine() + 1
+      << ", \"endLine\": " << stop->getLine() << ", \"endColumn\": " << getEndColumn() + 1 << "}}}]}";
+    return e.str();
+  }
 
   static std::string getStringForErrorType(ErrType e)
   {
@@ -94,6 +158,57 @@ struct WPLError
       return "Informational";
     }
   }
+
+  /**
+   * @brief Escapes a string so that it can be used in JSON
+   *
+   * @param str The string to escape
+   * @return std::string
+   */
+  static std::string escape(std::string str)
+  {
+    std::ostringstream ans;
+    for (char c : str)
+    {
+      switch (c)
+      {
+      case '"':
+        ans << "\\\"";
+        break;
+      case '\\':
+        ans << "\\\\";
+        break;
+      case '\n':
+        ans << "\\n";
+        break;
+      case '\r':
+        ans << "\\r";
+        break;
+      case '\t':
+        ans << "\\t";
+        break;
+      default:
+        if ((unsigned char)c < 0x20)
+          ans << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xF] << "0123456789abcdef"[c & 0xF];
+        else
+          ans << c;
+      }
+    }
+    return ans.str();
+  }
+
+private:
+  std::function<std::string()> render;  // Used to build the message text when it is needed
+  std::optional<std::string> message;   // Error Message text (once rendered)
+
+  // Column just past the end of the error's source range
+  size_t getEndColumn()
+  {
+    if (stop->getStartIndex() == INVALID_INDEX || stop->getStopIndex() == INVALID_INDEX || stop->getStopIndex() < stop->getStartIndex())
+      return stop->getCharPositionInLine();
+
+    return stop->getCharPositionInLine() + (stop->getStopIndex() - stop->getStartIndex() + 1);
+  }
 };
 
 class WPLErrorHandler
@@ -101,34 +216,165 @@ class WPLErrorHandler
 public:
   void addSemanticError(antlr4::Token *t, std::string msg)
   {
-    WPLError *e = new WPLError(t, msg, SEMANTIC, ERROR);
-    errors.push_back(e);
+    addError(new WPLError(t, msg, SEMANTIC, ERROR));
+  }
+
+  void addSemanticError(antlr4::ParserRuleContext *ctx, std::string msg)
+  {
+    addError(new WPLError(ctx->getStart(), ctx->getStop(), [msg]() { return msg; }, SEMANTIC, ERROR));
+  }
+
+  void addSemanticError(antlr4::ParserRuleContext *ctx, std::function<std::string()> msg)
+  {
+    addError(new WPLError(ctx->getStart(), ctx->getStop(), msg, SEMANTIC, ERROR));
   }
 
   void addSemanticCritWarning(antlr4::Token *t, std::string msg)
   {
-    WPLError *e = new WPLError(t, msg, SEMANTIC, CRITICAL_WARNING);
-    errors.push_back(e);
+    addError(new WPLError(t, msg, SEMANTIC, CRITICAL_WARNING));
+  }
+
+  void addSemanticCritWarning(antlr4::ParserRuleContext *ctx, std::string msg)
+  {
+    addError(new WPLError(ctx->getStart(), ctx->getStop(), [msg]() { return msg; }, SEMANTIC, CRITICAL_WARNING));
+  }
+
+  void addSemanticCritWarning(antlr4::ParserRuleContext *ctx, std::function<std::string()> msg)
+  {
+    addError(new WPLError(ctx->getStart(), ctx->getStop(), msg, SEMANTIC, CRITICAL_WARNING));
   }
 
   void addCodegenError(antlr4::Token *t, std::string msg)
   {
-    WPLError *e = new WPLError(t, msg, CODEGEN, ERROR);
+    addError(new WPLError(t, msg, CODEGEN, ERROR));
+  }
+
+  void addCodegenError(antlr4::ParserRuleContext *ctx, std::string msg)
+  {
+    addError(new WPLError(ctx->getStart(), ctx->getStop(), [msg]() { return msg; }, CODEGEN, ERROR));
+  }
+
+  void addCodegenError(antlr4::ParserRuleContext *ctx, std::function<std::string()> msg)
+  {
+    addError(new WPLError(ctx->getStart(), ctx->getStop(), msg, CODEGEN, ERROR));
+  }
+
+  /**
+   * @brief Adds an error, unless the error limit has already been reached.
+   *
+   * @param e The error to add
+   */
+  void addError(WPLError *e)
+  {
+    if (isFull())
+    {
+      delete e;
+      return;
+    }
+
     errors.push_back(e);
   }
 
   std::vector<WPLError *> &getErrors() { return errors; }
 
-  std::string errorList()
+  /**
+   * @brief Sets the maximum number of errors to keep. Once reached, any further errors are discarded (and callers may stop early).
+   *
+   * @param limit The maximum number of errors; 0 for no limit.
+   * @param prior The number of errors already reported elsewhere (ie, for earlier files) which count towards the limit
+   */
+  void setErrorLimit(unsigned int limit, unsigned int prior = 0)
+  {
+    errorLimit = limit;
+    priorErrors = prior;
+  }
+  unsigned int getErrorLimit() { return errorLimit; }
+  unsigned int getPriorErrors() { return priorErrors; }
+
+  /**
+   * @brief Determines if the error limit has been reached
+   *
+   * @return true If no more errors will be kept
+   * @return false If there is no limit or it has not been reached yet
+   */
+  bool isFull() { return errorLimit && priorErrors + errors.size() >= errorLimit; }
+
+  std::string errorList() { return errorList(TEXT); }
+
+  /**
+   * @brief Gets all of the errors
+   *
+   * @param format The format to display the errors in
+   * @return std::string
+   */
+  std::string errorList(DiagnosticFormat format)
   {
     std::ostringstream errList;
-    for (WPLError *e : errors)
+
+    switch (format)
     {
-      errList << e->toString() << std::endl;
+    case TEXT:
+      for (WPLError *e : errors)
+      {
+        errList << e->toString() << std::endl;
+      }
+
+      if (isFull())
+        errList << "Error limit of " << errorLimit << " reached; stopping." << std::endl;
+      break;
+
+    case JSON:
+    case SARIF:
+      errList << wrapEntries(errorEntries(format), format);
+      break;
     }
+
     return errList.str();
   }
 
+  /**
+   * @brief Gets each error on its own in a machine readable format. This allows the errors from several
+   * handlers (ie, one for each file) to be combined into a single document with wrapEntries().
+   *
+   * @param format The format to display the errors in (JSON or SARIF)
+   * @return std::vector<std::string>
+   */
+  std::vector<std::string> errorEntries(DiagnosticFormat format)
+  {
+    std::vector<std::string> entries;
+    for (WPLError *e : errors)
+    {
+      entries.push_back(format == SARIF ? e->toSARIF() : e->toJSON());
+    }
+    return entries;
+  }
+
+  /**
+   * @brief Wraps errors from errorEntries() into a JSON array or SARIF log
+   *
+   * @param entries The errors to include
+   * @param format The format they were displayed in (JSON or SARIF)
+   * @return std::string
+   */
+  static std::string wrapEntries(std::vector<std::string> entries, DiagnosticFormat format)
+  {
+    std::ostringstream doc;
+
+    if (format == SARIF)
+      doc << "{\"$schema\": \"https://json.schemastore.org/sarif-2.1.0.json\", \"version\": \"2.1.0\", "
+          << "\"runs\": [{\"tool\": {\"driver\": {\"name\": \"wplc\"}}, \"results\": [";
+    else
+      doc << "[";
+
+    for (unsigned int i = 0; i < entries.size(); i++)
+    {
+      doc << (i ? ",\n " : "\n ") << entries.at(i);
+    }
+
+    doc << (format == SARIF ? "\n]}]}" : "\n]") << std::endl;
+    return doc.str();
+  }
+
   /**
    * @brief Determines if the compiler has errors of a specific severity
    * 
@@ -154,6 +400,8 @@ public:
 
 protected:
   std::vector<WPLError *> errors;
+  unsigned int errorLimit = 0;
+  unsigned int priorErrors = 0;
 };
 
 /**
@@ -170,8 +418,7 @@ class WPLSyntaxErrorListener : public antlr4::BaseErrorListener, public WPLError
       const std::string &msg,
       std::exception_ptr ex) override
   {
-    WPLError *e = new WPLError(offendingSymbol, msg, SYNTAX, ERROR);
-    errors.push_back(e);
+    addError(new WPLError(offendingSymbol, msg, SYNTAX, ERROR));
     // throw std::invalid_argument("test error thrown: " + msg);
   }
 };
\ No newline at end of file
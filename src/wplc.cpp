@@ -19,6 +19,7 @@
 // #include "WPLErrorHandler.h"
 #include "SemanticVisitor.h"
 #include "CodegenVisitor.h"
+#include "ProfilePipeline.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/InitLLVM.h"
@@ -28,7 +29,9 @@
 #include "llvm/Target/TargetOptions.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/FileSystem.h"
 
+#include "ModuleInterface.h"
 #include "ExecUtils.h"
 #include <sstream> //String stream
 
@@ -69,6 +72,111 @@ static llvm::cl::opt<bool>
               llvm::cl::desc("Program will not use the WPL runtime; Compiler will automatically treat program() as the entry point."),
               llvm::cl::cat(WPLCOptions));
 
+static llvm::cl::opt<bool>
+    parallelSemantic("parallel-semantic",
+                     llvm::cl::desc("Semantically check FUNC/PROC bodies in parallel once all top-level declarations are known."),
+                     llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<unsigned int>
+    optLevel("O",
+             llvm::cl::desc("Optimization level (0-3); features marked as defaulting on above -O0 are enabled by any level of at least 1"),
+             llvm::cl::value_desc("level"),
+             llvm::cl::Prefix,
+             llvm::cl::init(0),
+             llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    constFold("fconst-fold",
+              llvm::cl::desc("Fold constant expressions rather than generating instructions for them (default above -O0)"),
+              llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    branchlessLogic("fbranchless-logic",
+                    llvm::cl::desc("Evaluate cheap, side-effect free operands of & and | without short-circuit branches (default above -O0)"),
+                    llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    debugInfo("g",
+              llvm::cl::desc("Emit DWARF debug information (source locations, functions, and variables) at any optimization level"),
+              llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    stringPool("fstring-pool",
+               llvm::cl::desc("Share a single global between string literals with the same contents (default); use -fstring-pool=false to disable."),
+               llvm::cl::init(true),
+               llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    singleTestLoops("fsingle-test-loops",
+                    llvm::cl::desc("Generate each loop's condition once, in a header block, rather than before the loop and again at its latch (default); use -fsingle-test-loops=false to disable."),
+                    llvm::cl::init(true),
+                    llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    tailCalls("ftail-calls",
+              llvm::cl::desc("Make calls in tail position reuse the caller's frame, generating direct self-recursion as a loop (default); use -ftail-calls=false to disable."),
+              llvm::cl::init(true),
+              llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    functionAttrs("ffunction-attrs",
+                  llvm::cl::desc("Annotate functions with the attributes implied by their effects (default above -O0)"),
+                  llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    aggregateRefs("faggregate-refs",
+                  llvm::cl::desc("Pass and return arrays, structs, and sums by reference (default above -O0)"),
+                  llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    compactSums("fcompact-sums",
+                llvm::cl::desc("Lay out sums with the smallest possible tag and aligned storage (default above -O0)"),
+                llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    selectSwitch("fselect-switch",
+                 llvm::cl::desc("Generate selects that compare a single INT against constants as switches (default above -O0)"),
+                 llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    boundsCheck("fbounds-check",
+                llvm::cl::desc("Check that array indices are in range at runtime (unless they provably are), aborting the program if not."),
+                llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::list<std::string>
+    importFiles("import",
+                llvm::cl::desc("Module interface (.wpli) file whose exports should be available to the program"),
+                llvm::cl::value_desc("interface file"),
+                llvm::cl::ZeroOrMore,
+                llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    emitInterface("emit-interface",
+                  llvm::cl::desc("Write a module interface (.wpli) file describing the program's FUNC/PROCs, enums, structs, and globals"),
+                  llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<unsigned int>
+    errorLimit("ferror-limit",
+               llvm::cl::desc("Stop reporting (and checking) after N errors across all inputs; 0 for no limit"),
+               llvm::cl::value_desc("N"),
+               llvm::cl::init(0),
+               llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    stopOnFirstError("fstop-on-first-error",
+                     llvm::cl::desc("Stop at the first error (same as -ferror-limit=1)"),
+                     llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<DiagnosticFormat>
+    diagnosticFormat("fdiagnostics-format",
+                     llvm::cl::desc("Format to report errors in"),
+                     llvm::cl::values(
+                         clEnumValN(TEXT, "text", "Human-readable text (default)"),
+                         clEnumValN(JSON, "json", "JSON array of errors"),
+                         clEnumValN(SARIF, "sarif", "SARIF 2.1.0 log")),
+                     llvm::cl::init(TEXT),
+                     llvm::cl::cat(WPLCOptions));
+
 static llvm::cl::opt<bool>
     isVerbose("verbose",
               llvm::cl::desc("If true, compiler will print out status messages; if false (default), compiler will only print errors."),
@@ -91,6 +199,18 @@ static llvm::cl::opt<CompileType>
                     clEnumVal(gcc, "Will generate an executable using gcc")),
                 llvm::cl::init(none),
                 llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<bool>
+    profileGenerate("profile-generate",
+                    llvm::cl::desc("Instrument the program to write an execution profile (default_%m.profraw) when run; merge it with llvm-profdata for use with --profile-use"),
+                    llvm::cl::cat(WPLCOptions));
+
+static llvm::cl::opt<std::string>
+    profileUse("profile-use",
+               llvm::cl::desc("Optimize using the branch weights and function counts in a profile merged by llvm-profdata"),
+               llvm::cl::value_desc("file.profdata"),
+               llvm::cl::cat(WPLCOptions));
+
 /**
  * @brief Main compiler driver.
  */
@@ -129,7 +249,11 @@ int main(int argc, const char *argv[])
 
   llvm::TargetOptions opt;
   auto RM = llvm::Optional<llvm::Reloc::Model>();
-  auto TheTargetMachine = Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM);
+  llvm::CodeGenOpt::Level codegenOptLevel = (optLevel == 0)   ? llvm::CodeGenOpt::None
+                                            : (optLevel == 1) ? llvm::CodeGenOpt::Less
+                                            : (optLevel == 2) ? llvm::CodeGenOpt::Default
+                                                              : llvm::CodeGenOpt::Aggressive;
+  auto TheTargetMachine = Target->createTargetMachine(TargetTriple, CPU, Features, opt, RM, llvm::None, codegenOptLevel);
 
   if (inputFileName.empty() && inputString == "-")
   {
@@ -143,6 +267,25 @@ int main(int argc, const char *argv[])
     std::exit(-1);
   }
 
+  if (profileGenerate && !profileUse.empty())
+  {
+    std::cerr << "You can only generate a profile or use one, but not both" << std::endl;
+    std::exit(-1);
+  }
+
+  // Only clang knows how to link the profile runtime that the instrumentation writes its profile with
+  if (profileGenerate && compileWith == gcc)
+  {
+    std::cerr << "--profile-generate requires the program to be compiled with clang" << std::endl;
+    std::exit(-1);
+  }
+
+  if (!profileUse.empty() && !llvm::sys::fs::exists(profileUse))
+  {
+    std::cerr << "Error loading profile: " << profileUse << ". Does it exist?" << std::endl;
+    std::exit(-1);
+  }
+
   /******************************************************************
    * Now that we have the input, we can perform the first stage:
    * 1. Create the lexer from the input.
@@ -181,7 +324,10 @@ int main(int argc, const char *argv[])
       }
 
       // TODO: THIS DOESN'T WORK IF NOT GIVEN A PROPER FILE EXTENSION
-      inputs.push_back({new antlr4::ANTLRInputStream(*inStream),
+      antlr4::ANTLRInputStream *input = new antlr4::ANTLRInputStream(*inStream);
+      input->name = fileName; // Used to report the file in errors
+
+      inputs.push_back({input,
                         (!(inputFileName.size() > 1) && useOutputFileName) ? outputFileName : fileName.substr(0, fileName.find_last_of('.'))});
     }
   }
@@ -194,9 +340,34 @@ int main(int argc, const char *argv[])
 
   bool isValid = true;
 
+  unsigned int maxErrors = stopOnFirstError ? 1 : errorLimit;
+
+  /*
+   * Machine readable diagnostics are collected across all of the inputs so that a single
+   * JSON array (or SARIF log) is written out for the whole invocation. Text is written as it is found.
+   */
+  std::vector<std::string> diagnostics;
+  unsigned int errorsReported = 0; // Shared by every input so that -ferror-limit applies to the whole invocation
+  auto reportErrors = [&diagnostics, &errorsReported](std::string text, std::vector<std::string> entries)
+  {
+    errorsReported += entries.size();
+    if (diagnosticFormat == TEXT)
+      std::cerr << text << std::endl;
+    else
+      diagnostics.insert(diagnostics.end(), entries.begin(), entries.end());
+  };
+  auto flushDiagnostics = [&diagnostics]()
+  {
+    if (diagnosticFormat != TEXT)
+      std::cerr << WPLErrorHandler::wrapEntries(diagnostics, diagnosticFormat);
+  };
+
   // For each input...
   for (auto input : inputs)
   {
+    if (maxErrors && errorsReported >= maxErrors)
+      break;
+
     /*******************************************************************
      * Create the Lexer from the input.
      * ================================================================
@@ -215,6 +386,7 @@ int main(int argc, const char *argv[])
     WPLParser parser(&tokens);
     parser.removeErrorListeners();
     WPLSyntaxErrorListener *syntaxListener = new WPLSyntaxErrorListener();
+    syntaxListener->setErrorLimit(maxErrors, errorsReported);
     parser.addErrorListener(syntaxListener);
     // delete syntaxListener;
 
@@ -224,7 +396,8 @@ int main(int argc, const char *argv[])
 
     if (syntaxListener->hasErrors(0)) // Want to see all errors.
     {
-      std::cerr << syntaxListener->errorList() << std::endl;
+      reportErrors(syntaxListener->errorList(TEXT), syntaxListener->errorEntries(diagnosticFormat));
+      flushDiagnostics();
       isValid = false; // Shouldn't be needed
       return -1;
     }
@@ -235,6 +408,45 @@ int main(int argc, const char *argv[])
 
     int flags = (noRuntime) ? CompilerFlags::NO_RUNTIME : 0;
 
+    if (parallelSemantic)
+      flags |= CompilerFlags::PARALLEL_SEMANTIC;
+
+    if (boundsCheck)
+      flags |= CompilerFlags::BOUNDS_CHECK;
+
+    if (constFold.getNumOccurrences() ? constFold : optLevel > 0)
+      flags |= CompilerFlags::CONST_FOLD;
+
+    if (selectSwitch.getNumOccurrences() ? selectSwitch : optLevel > 0)
+      flags |= CompilerFlags::SELECT_SWITCH;
+
+    if (compactSums.getNumOccurrences() ? compactSums : optLevel > 0)
+      flags |= CompilerFlags::COMPACT_SUMS;
+
+    if (aggregateRefs.getNumOccurrences() ? aggregateRefs : optLevel > 0)
+      flags |= CompilerFlags::AGGREGATE_REFS;
+
+    if (functionAttrs.getNumOccurrences() ? functionAttrs : optLevel > 0)
+      flags |= CompilerFlags::FUNCTION_ATTRS;
+
+    if (tailCalls)
+      flags |= CompilerFlags::TAIL_CALLS;
+
+    if (singleTestLoops)
+      flags |= CompilerFlags::SINGLE_TEST_LOOPS;
+
+    if (stringPool)
+      flags |= CompilerFlags::STRING_POOL;
+
+    if (debugInfo)
+      flags |= CompilerFlags::DEBUG_INFO;
+
+    if (branchlessLogic.getNumOccurrences() ? branchlessLogic : optLevel > 0)
+      flags |= CompilerFlags::BRANCHLESS_LOGIC;
+
+    // The flags which change how values are laid out or passed between functions. Module interfaces record these so that modules compiled differently are not linked together.
+    unsigned int abiFlags = flags & (CompilerFlags::COMPACT_SUMS | CompilerFlags::AGGREGATE_REFS);
+
     /*******************************************************************
      * Semantic Analysis
      * ================================================================
@@ -245,13 +457,40 @@ int main(int argc, const char *argv[])
      *******************************************************************/
     STManager *stm = new STManager();
     PropertyManager *pm = new PropertyManager();
+
+    // Load the symbols from any imported module interfaces into the global scope
+    std::vector<Symbol *> imports;
+    bool importsValid = true;
+    for (auto importName : importFiles)
+    {
+      std::ifstream importStream(importName, std::ios::binary);
+      std::optional<std::vector<Symbol *>> loaded = ModuleInterface::read(importStream, stm, abiFlags);
+
+      if (!loaded)
+      {
+        std::cerr << "Error loading module interface: " << importName << ". Does it exist, was it compiled with the same optimization options, and does it conflict with any other imports?" << std::endl;
+        importsValid = false;
+        break;
+      }
+
+      imports.insert(imports.end(), loaded.value().begin(), loaded.value().end());
+    }
+
+    if (!importsValid)
+    {
+      isValid = false;
+      continue;
+    }
+
     SemanticVisitor *sv = new SemanticVisitor(stm, pm, flags);
+    sv->setErrorLimit(maxErrors, errorsReported);
     sv->visitCompilationUnit(tree);
 
     if (sv->hasErrors(0)) // Want to see all errors
     {
-      std::cout << "Semantic analysis completed for " << input.second << " with errors: " << std::endl;
-      std::cerr << sv->getErrors() << std::endl;
+      if (diagnosticFormat == TEXT)
+        std::cout << "Semantic analysis completed for " << input.second << " with errors: " << std::endl;
+      reportErrors(sv->getErrors(TEXT), sv->getErrorEntries(diagnosticFormat));
       isValid = false;
       continue;
     }
@@ -260,6 +499,36 @@ int main(int argc, const char *argv[])
     {
       std::cout << "Semantic analysis completed for " << input.second << " without errors. Starting code generation..." << std::endl;
     }
+
+    /*******************************************************************
+     * Module Interface
+     * ================================================================
+     *
+     * If requested, write out the interface for the file. The file is
+     * only replaced if its contents changed so that anything depending
+     * on it only needs to be rebuilt when the interface does.
+     *******************************************************************/
+    if (emitInterface)
+    {
+      std::ostringstream interface;
+      if (!ModuleInterface::write(interface, sv->getExports(tree), abiFlags))
+      {
+        std::cerr << "Could not generate module interface for " << input.second << std::endl;
+        isValid = false;
+        continue;
+      }
+
+      std::string interfaceFileName = input.second + ".wpli";
+      std::ifstream prevStream(interfaceFileName, std::ios::binary);
+      std::ostringstream prev;
+      prev << prevStream.rdbuf();
+
+      if (!prevStream || prev.str() != interface.str())
+      {
+        std::ofstream interfaceStream(interfaceFileName, std::ios::binary);
+        interfaceStream << interface.str();
+      }
+    }
     /*******************************************************************
      * Code Generation
      * ================================================================
@@ -268,10 +537,17 @@ int main(int argc, const char *argv[])
      * generate code for it.
      *******************************************************************/
     CodegenVisitor *cv = new CodegenVisitor(pm, "WPLC.ll", flags);
+    cv->setErrorLimit(maxErrors, errorsReported);
+
+    // The compact sum layout (and the sizes recorded in debug info) depend on the target's sizes and alignments, so it must be known before any code is generated
+    if (flags & (CompilerFlags::COMPACT_SUMS | CompilerFlags::DEBUG_INFO))
+      cv->getModule()->setDataLayout(TheTargetMachine->createDataLayout());
+
+    cv->declareImports(imports);
     cv->visitCompilationUnit(tree);
     if (cv->hasErrors(0)) // Want to see all errors
     {
-      std::cerr << cv->getErrors() << std::endl;
+      reportErrors(cv->getErrors(TEXT), cv->getErrorEntries(diagnosticFormat));
       isValid = false;
       continue;
     }
@@ -279,6 +555,30 @@ int main(int argc, const char *argv[])
     // Print out the module contents.
     llvm::Module *module = cv->getModule();
 
+    /*
+     * Profile instrumentation is inserted (or a profile is applied) before the module is
+     * written out so that both the IR and the object file include it. The triple and data
+     * layout must be known first as the instrumentation depends on the target.
+     */
+    if (profileGenerate || !profileUse.empty())
+    {
+      module->setTargetTriple(TargetTriple);
+      module->setDataLayout(TheTargetMachine->createDataLayout());
+
+      std::optional<std::string> profileErrors = runProfilePipeline(module, TheTargetMachine,
+                                                                    profileGenerate ? llvm::PGOOptions("", "", "", llvm::PGOOptions::IRInstr)
+                                                                                    : llvm::PGOOptions(profileUse, "", "", llvm::PGOOptions::IRUse),
+                                                                    optLevel);
+
+      if (profileErrors)
+      {
+        std::cerr << "Could not " << (profileGenerate ? "instrument " : "apply the profile to ") << input.second << ":" << std::endl
+                  << profileErrors.value();
+        isValid = false;
+        continue;
+      }
+    }
+
     if (printOutput)
     {
       std::cout << std::endl
@@ -339,6 +639,8 @@ int main(int argc, const char *argv[])
     }
   }
 
+  flushDiagnostics();
+
   if (isValid && compileWith != none)
   {
     std::ostringstream cmd;
@@ -347,6 +649,10 @@ int main(int argc, const char *argv[])
     {
     case clang:
       cmd << "clang ";
+
+      // Links the runtime that writes out the profile when the program exits
+      if (profileGenerate)
+        cmd << "-fprofile-generate ";
       break;
     case gcc:
       cmd << "gcc ";
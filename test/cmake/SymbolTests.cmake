@@ -3,4 +3,5 @@ set(SYMBOL_TESTS
   symbol/symbol_tests.cpp
   symbol/scope_tests.cpp
   symbol/st_manager_tests.cpp
+  symbol/module_interface_tests.cpp
 )
\ No newline at end of file
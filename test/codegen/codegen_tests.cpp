@@ -12,8 +12,11 @@
 #include "WPLErrorHandler.h"
 #include "SemanticVisitor.h"
 #include "CodegenVisitor.h"
+#include "ProfilePipeline.h"
 #include "HashUtils.h"
 #include "CompilerFlags.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Verifier.h"
 
 TEST_CASE("Development Codegen Tests", "[codegen]")
 {
@@ -60,7 +63,7 @@ TEST_CASE("programs/test1 - General Overview", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c0bdac31a8ebe95ce34c84fc87340507f924e81315be3f4fea0d7c5f9d732019");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "24ec2dd3350ebc4146b4f02cbe84ebae0ddd041715b42ef2b927e7a4d8a0e55f");
 }
 
 TEST_CASE("programs/test1-full - General Overview - full", "[codegen]")
@@ -87,7 +90,7 @@ TEST_CASE("programs/test1-full - General Overview - full", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "7207846e3c3466a82caba824eef32c06a12c4300d879e474a5beec37e0fe50eb");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "fc37cbe932e17d04d068557c9cf44bdb4de72c6d743ef62e86b095db2e9d3e7e");
 }
 
 TEST_CASE("programs/test1a", "[codegen]")
@@ -141,7 +144,7 @@ TEST_CASE("programs/test2 - Scopes, multiple assignments, equality (non-arrays)"
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "6fe85492b8cabea3bee19c2fc54a5276861eb992ebdb4a97de10008cefb0832e");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c1d75a96ff4cb6212fbaf7f464ba48a06021ef4b7649b95e86c5e1dd1cb26ad6");
 }
 
 TEST_CASE("programs/test3 - If w/o else", "[codegen]")
@@ -222,7 +225,7 @@ TEST_CASE("programs/test5 - Nested ifs and if equality", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "6499fa76c19d5f518248a26b68be585002588e2a52851469d37dd3c6e7529f0b");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "bcb7870e8dca98589083775ef7d32855cba7e02f358a9539c9e11fe6aab0645a");
 }
 
 TEST_CASE("programs/test6 - Basic Select with Return", "[codegen]")
@@ -249,7 +252,7 @@ TEST_CASE("programs/test6 - Basic Select with Return", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "686f9e63c3f0c7f09de2dbc0ca6a6e8ae5161be63048a68814c74c5164c33305");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "532f5c6d0c60289e9f78e46f8c4e72aa841bf444d1ea3f5cc99cc0c5fbb0af01");
 }
 
 TEST_CASE("programs/testSelectBlock1 - Basic Select with Blocks that Return", "[codegen]")
@@ -277,7 +280,7 @@ TEST_CASE("programs/testSelectBlock1 - Basic Select with Blocks that Return", "[
     REQUIRE_FALSE(cv->hasErrors(0));
 
     // NOTE: THIS SHOULD BE THE SAME AS test6!!!
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "686f9e63c3f0c7f09de2dbc0ca6a6e8ae5161be63048a68814c74c5164c33305");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "532f5c6d0c60289e9f78e46f8c4e72aa841bf444d1ea3f5cc99cc0c5fbb0af01");
 }
 
 TEST_CASE("programs/test6a - Basic Nested Selects, LEQ, GEQ", "[codegen]")
@@ -304,7 +307,7 @@ TEST_CASE("programs/test6a - Basic Nested Selects, LEQ, GEQ", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "d86d9c224f8b22cfc4a52bab88aa5f9ce60016604aafe0e865dc6fc0aa177093");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "02765991fe61afe122e754eac6e9136721e75d1aceeefdd8ca9ae5da21702755");
 }
 
 TEST_CASE("programs/testSelectBlock2 - Select with blocks that don't return", "[codegen]")
@@ -332,7 +335,7 @@ TEST_CASE("programs/testSelectBlock2 - Select with blocks that don't return", "[
     REQUIRE_FALSE(cv->hasErrors(0));
 
     // NOTE: Should be same as test6a
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "d86d9c224f8b22cfc4a52bab88aa5f9ce60016604aafe0e865dc6fc0aa177093");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "02765991fe61afe122e754eac6e9136721e75d1aceeefdd8ca9ae5da21702755");
 }
 
 TEST_CASE("programs/test7 - Test String equality + Nested Loops", "[codegen]")
@@ -359,7 +362,7 @@ TEST_CASE("programs/test7 - Test String equality + Nested Loops", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "19032701f53255d06397da61e16546db973fd3347ddfed33f7629d64508935fb");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "b43a09f9dbc32b90f1d71f23390a10ed95d50a2eb650708be9e72a5cf215bdcc");
 }
 
 TEST_CASE("programs/test8 - Nested Loops", "[codegen]")
@@ -386,7 +389,7 @@ TEST_CASE("programs/test8 - Nested Loops", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c632ea5d57a074cd477ef3d48798816a64858c619830e98b463bb3360fdf085b");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "9ba4060b56aa844359d4a107d5eb32ae43166c0c82ab2cbc1926f18ca414611b");
 }
 
 TEST_CASE("programs/test9i - Global Integers", "[codegen]")
@@ -413,7 +416,7 @@ TEST_CASE("programs/test9i - Global Integers", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "328e5295eaad33348eee23da5f8302153e778c8bb631707f37fd4d03daae7cfa");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c52ffe8dcf02dec0eb804219fe8187e4557587e7a4ced95db4cc774d0f9c995e");
 }
 
 TEST_CASE("programs/test9iv - Global Integer Inference", "[codegen]")
@@ -440,7 +443,7 @@ TEST_CASE("programs/test9iv - Global Integer Inference", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "328e5295eaad33348eee23da5f8302153e778c8bb631707f37fd4d03daae7cfa");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c52ffe8dcf02dec0eb804219fe8187e4557587e7a4ced95db4cc774d0f9c995e");
 }
 
 TEST_CASE("programs/test9b - Global Booleans", "[codegen]")
@@ -467,7 +470,7 @@ TEST_CASE("programs/test9b - Global Booleans", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "d871755f7c89cd02ee76c67541ec1935a2117a1e3f23cc86a09573fa1ef8422c");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "ed61db4edd5a337902ee57a374524c9f4bbbde73cf9a5ce2168f4f6ce97cd515");
 }
 
 TEST_CASE("programs/test9bv - Global Boolean Inference", "[codegen]")
@@ -494,7 +497,7 @@ TEST_CASE("programs/test9bv - Global Boolean Inference", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "d871755f7c89cd02ee76c67541ec1935a2117a1e3f23cc86a09573fa1ef8422c");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "ed61db4edd5a337902ee57a374524c9f4bbbde73cf9a5ce2168f4f6ce97cd515");
 }
 
 TEST_CASE("programs/test9s - Global Strings", "[codegen]")
@@ -521,7 +524,7 @@ TEST_CASE("programs/test9s - Global Strings", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "4b20b6db3a31f068485c29786b8ca97704cff2931829462517cf402811ed711a");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "e6e7a592710ced77dcded6f5b68e67aee08faf0cdccc056a76a8b63be2211f2d");
 }
 
 TEST_CASE("programs/test9sv - Global String Inference", "[codegen]")
@@ -548,7 +551,7 @@ TEST_CASE("programs/test9sv - Global String Inference", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "4b20b6db3a31f068485c29786b8ca97704cff2931829462517cf402811ed711a");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "e6e7a592710ced77dcded6f5b68e67aee08faf0cdccc056a76a8b63be2211f2d");
 }
 
 TEST_CASE("programs/test9ba - Global Boolean Array", "[codegen]")
@@ -575,7 +578,7 @@ TEST_CASE("programs/test9ba - Global Boolean Array", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "b6b98b36e98caffd2ef053023bd97db39bfc12c3a2c38b90bffacb8fb1436097");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "d8e8b76ce1d5c65cca38c114cce7d3f409c65eff0ee60f8de14fb416e0cc18d7");
 }
 
 TEST_CASE("programs/test9ia - Global Integer Array", "[codegen]")
@@ -602,7 +605,7 @@ TEST_CASE("programs/test9ia - Global Integer Array", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "0b667384676913d1b0aee9853fd9be42eabea34887e18cd1de6b54c5cf1823ca");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "00a5bbebcc333b7e97952365bf48b242ad2bcf01945f861da1cc7894658a3d43");
 }
 
 TEST_CASE("programs/test9sa - Global String Array - FLAWED", "[codegen]")
@@ -629,7 +632,7 @@ TEST_CASE("programs/test9sa - Global String Array - FLAWED", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "9e5834e13db9f511e072a26b22de0bee49ae44d914fc08ecb86f9b14f1c4fdc1");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "d1b27a176caa6d6abd0a9259a9e8cc9c5a77a5d51a04d0c05b67645b962c7a09");
 }
 
 TEST_CASE("programs/test9sa-1 - Global String Array - CORRECT", "[codegen]")
@@ -656,7 +659,7 @@ TEST_CASE("programs/test9sa-1 - Global String Array - CORRECT", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "b7e94a1425ecfbc8a9b99dbc9160cb966bfcd7ae69e13bee2cf4702d310d9f0c");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "62d236a9a60d32eaa48cb8c2ca12500a227cc4d4389f6e5aec7484edfbe9cd52");
 }
 
 TEST_CASE("programs/test11 - Expressions in decl (let*) ", "[codegen]")
@@ -683,7 +686,7 @@ TEST_CASE("programs/test11 - Expressions in decl (let*) ", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "52c5ebd78944d1733c68270498483c16acc997d9e33fddcde44dc45d53a26a0b");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "e02643a93ed3920042104901271654e220dfd02ce57675d11430e877daefe899");
 }
 
 TEST_CASE("programs/test12 - Scopes & Prime Finder Example! ", "[codegen]")
@@ -710,7 +713,7 @@ TEST_CASE("programs/test12 - Scopes & Prime Finder Example! ", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "209c1960ddf81cfa4490c2d8a0501577b799bdacc5d829ce2530f094559ed915");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "e5670f673c04708b2fc35e3177b030fc269acd6146df7cb0f52e886184dc3733");
 }
 
 TEST_CASE("programs/test13 - Recursive Fibonacci", "[codegen]")
@@ -737,7 +740,7 @@ TEST_CASE("programs/test13 - Recursive Fibonacci", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "fd2a506796e162de9e1a00a12e154827fa25a34833b68c68aa83750e3c4ab657");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c474e1fd73cbaab876e951d984eac971dc5218075a85ba54ac2530eef64de8ff");
 }
 
 TEST_CASE("programs/test-runtime - Basic runtime tests", "[codegen]")
@@ -765,7 +768,7 @@ TEST_CASE("programs/test-runtime - Basic runtime tests", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "6c84e861ca345b6cf3b11cf5abe99daed731acac1e48a302ac8efe6640cad7b6");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "ed6b4d554afae9309ece0b237df7e4612b79977a28af83abad75f3ad0394b7e7");
 }
 
 TEST_CASE("programs/test-shortcircuit - Basic Short Circuit (and)", "[codegen]")
@@ -792,7 +795,7 @@ TEST_CASE("programs/test-shortcircuit - Basic Short Circuit (and)", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "e664f3cf5af34edd6f3fecb5248e4c6390565443c942e01f5652c7b5b3c3d4ba");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "1c3d703820ac75a879653a5015fb67eece226f8d0efbd92999b6bbbcaa1585d1");
 }
 
 TEST_CASE("programs/test-shortcircuit-rt - Basic Short Circuit (and + or) w/ Runtime", "[codegen]")
@@ -819,7 +822,7 @@ TEST_CASE("programs/test-shortcircuit-rt - Basic Short Circuit (and + or) w/ Run
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "2309d18c37760ca695b7acd1fe81c7bf428ea5e44764f35e6c993780a3815459");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c63847991acf9e5473fab499323af2450f21238223d055a76334fdb34a2ce708");
 }
 
 TEST_CASE("programs/test-arrayAssign - Assigning one array to another and editing arrays in functions", "[codegen]")
@@ -848,7 +851,7 @@ TEST_CASE("programs/test-arrayAssign - Assigning one array to another and editin
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "ea6cf3bb36fb69f95ea73e48f616f5dc4415f3184579cfe08d668d3722e865e3");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "4b67c1b8bff09cea4e67c566b6e69ac11af6ae76d67be5f2b4a7df4dabc30615");
 }
 
 TEST_CASE("programs/externProc - Declaring an external proc", "[codegen]")
@@ -903,7 +906,7 @@ TEST_CASE("programs/test14a - Test nested/more complex shorting", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "a4ac4a3664f5835bc88328e2dd925472074de7b0f9977106f0685508130628f8");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "47fbff8f917a64c2536361a7427fdead079ecc058ab655f6a8e939bf6ebae244");
 }
 
 TEST_CASE("programs/test18 - Parody", "[codegen]")
@@ -930,7 +933,7 @@ TEST_CASE("programs/test18 - Parody", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "171d2045fbfe890b72ef57ae92b798e8bcc88a099aa1791e58fa653cc2d94c22");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "7f519a2db719f315e57e6fff2f4e32e269eb77f361911220a70cd20f4964e351");
 }
 
 TEST_CASE("programs/test19 - Editing Global String and Using Across Inv", "[codegen]")
@@ -957,7 +960,7 @@ TEST_CASE("programs/test19 - Editing Global String and Using Across Inv", "[code
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "bd911e955a6da1d18d92cf4ca430456daa8ea8c4c8601f778e0f8bb83178222e");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "7a39e751b2eb7771dc24634b5a6ee9d575b99592003fdcfdf290038093c0d8ce");
 }
 
 TEST_CASE("programs/testGlobalAndLocal - Parody", "[codegen]")
@@ -984,7 +987,7 @@ TEST_CASE("programs/testGlobalAndLocal - Parody", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "f9b33450b1f1522122b1dffbf07819f959e08aac6ccdfc112cac7c25690a5c78");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "fbfa2850a4bc8057bb1cdd0056f27b15a4a4d8ca062ecd398e49377ff19332dd");
 }
 
 TEST_CASE("programs/forwardWrongArg - Forward Declaration w/ wrong arg name", "[codegen]")
@@ -1146,7 +1149,7 @@ TEST_CASE("programs/enum1 - Basic Enum 1", "[codegen][enum]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c8988c284c4ae357ff29cf4e222a3ea2a53e1ce6e641b2098355c4c0c57b5279");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "956d8702043d6fb7f03abb17de9802821adf36d7026b09a0b45ec36629f6e1fa");
 }
 
 TEST_CASE("programs/enum2 - Basic Enum 2", "[codegen][enum]")
@@ -1173,7 +1176,7 @@ TEST_CASE("programs/enum2 - Basic Enum 2", "[codegen][enum]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "523f0fdd247182b25da3af5c5e19e8878a4e1a98a9b42511a9a82bfc9922918b");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "35f9392f052477c70840b72235295dfcb7ba58744c65b9b56819d469305b3608");
 }
 
 TEST_CASE("programs/enumAssign - Same a  Enum 2 but with assignmens outside of decl", "[codegen][enum]")
@@ -1200,7 +1203,7 @@ TEST_CASE("programs/enumAssign - Same a  Enum 2 but with assignmens outside of d
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "a754100cd398e8c52269bdf94bf069a461c5310f705b00cf984ca688ab622c04");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "8a8ff86b64385026263c3f83b55c5837040ba6927f39979208f9e493ed718481");
 }
 
 TEST_CASE("programs/enumAssign2 - Returning lambdas, functions, and enums", "[codegen][enum][lambda]")
@@ -1227,7 +1230,7 @@ TEST_CASE("programs/enumAssign2 - Returning lambdas, functions, and enums", "[co
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "bf7f5d87893b5afd5fe2ba76cbc633153d7fc26b10331ad8da8dfd6f86dfa22b");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "45a7452b09e85e482b9ec6085afe9c2b3a59e37fa29595d17a78aa614c2fc4ad");
 }
 
 TEST_CASE("programs/enum3", "[codegen][enum]")
@@ -1254,7 +1257,7 @@ TEST_CASE("programs/enum3", "[codegen][enum]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "fd533dcb6fae0d185130d6d6a017aee1d67b890a336ded81829b1f1ac2e3234c");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "85343e0aeddf8a8c88b8f4425b6db09cc3d31f3a5f2f812593e222946c6fde8d");
 }
 
 TEST_CASE("programs/StructTest2", "[codegen][struct]")
@@ -1281,7 +1284,7 @@ TEST_CASE("programs/StructTest2", "[codegen][struct]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "959a3a3209316c2f10186c59f5db5552fd2f8b9ca5624a95f4b837e1cc0e8b0e");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "4738f1bc8f4242ee912b7fba23b4806602fc4fc610f40808e3571b2313e24c96");
 }
 
 TEST_CASE("programs/StructTest3", "[codegen][struct]")
@@ -1308,7 +1311,7 @@ TEST_CASE("programs/StructTest3", "[codegen][struct]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "21b9ab1ae93492f89f17f6ff8da9bd340b2a71d110463f19499bc9192b10b6cd");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "c1c504f1634fe4df06287523501416b2feced7303fe6ca30bcd4dad263304acf");
 }
 
 TEST_CASE("programs/StructTest3a - nested fields", "[codegen][struct]")
@@ -1335,7 +1338,7 @@ TEST_CASE("programs/StructTest3a - nested fields", "[codegen][struct]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "58c43527727e01ae069ff43a95d8d62aed6e850d3f9693c3cb7c74efdab41b13");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "f3915f23511ad094140ee28e8d176fed0e465a5bea83cfc3e3c09cacdbd19632");
 }
 
 TEST_CASE("programs/StructTest3b - nested fields", "[codegen][struct]")
@@ -1362,7 +1365,7 @@ TEST_CASE("programs/StructTest3b - nested fields", "[codegen][struct]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "f29652970edd86dff1e5cd7e80d41a43fbfe1b47f993eb7f5fb0fb06a2563d41");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "5cafb3f5ed47e6728a704a36961b608010275842a85229c434b5b06fd16bc9b3");
 }
 
 TEST_CASE("programs/StructTest4", "[codegen][struct]")
@@ -1389,7 +1392,7 @@ TEST_CASE("programs/StructTest4", "[codegen][struct]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "f84941b2168968d3c991b76e9ed5374a025c1db7200f825476e29a84446f9390");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "79a6fa7b46dcf35e5a9d1c9a8b1b54a64e084c960907d6f0362c17616a6dbf94");
 }
 
 TEST_CASE("programs/adv/NestedEnum", "[codegen][struct]")
@@ -1416,7 +1419,7 @@ TEST_CASE("programs/adv/NestedEnum", "[codegen][struct]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "25c3e6bbdf9ecb257815732a7f75a2be1cb209a503bde63cd92658b4ee8c5977");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "1c35d5b88d32fb657909a89eb83b123508a9fe02e0141cdd7ace46d8af882811");
 }
 
 TEST_CASE("programs/dangerLambda - lambdas with dupl function names", "[codegen][struct]")
@@ -1443,7 +1446,7 @@ TEST_CASE("programs/dangerLambda - lambdas with dupl function names", "[codegen]
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "19c387e4371170bb078319a7323018c2bd6488f01e8a5a98d0c3ebadf3356048");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "74ddaf0daa20b6ce7624898dd86c97c40f8d73d7a748361bb73144d737a32ddf");
 }
 
 TEST_CASE("programs/adv/enumPassing - passing non-enum as enum argument", "[codegen][struct]")
@@ -1470,7 +1473,7 @@ TEST_CASE("programs/adv/enumPassing - passing non-enum as enum argument", "[code
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "3a8deea38620a5392962e96679b5c4e6f2e7564d369fa712eb211d5af150ae97");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "785bec92a7526c2af0111bae692515de80bac6d14b88c880585b606664a0d678");
 }
 
 TEST_CASE("programs/Lambda2a - More nested lambdas", "[codegen][lambda]")
@@ -1497,7 +1500,7 @@ TEST_CASE("programs/Lambda2a - More nested lambdas", "[codegen][lambda]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "d7baa5365992b710eef5b1dd8780324342fc6e7534b276297ffb0fd3b716966c");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "133e510aa0d1654e50f3bccc76706e6381d6f7a50c43de280d81eb53853e21d9");
 }
 
 TEST_CASE("programs/adv/enumPassingInf - Enum passing with Type Inference", "[codegen][enum][type-inf]")
@@ -1524,7 +1527,7 @@ TEST_CASE("programs/adv/enumPassingInf - Enum passing with Type Inference", "[co
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "98b014e6ea9ae1f277bcd10f6e4a326fe5dd24cc966c9985d30e78507dc83c5d");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "07c797e9729410e34584f6fd79bb8bf85077decb259a30735198006cf039031c");
 }
 
 TEST_CASE("programs/Lambda2b - More nested lambdas", "[codegen][struct]")
@@ -1551,7 +1554,7 @@ TEST_CASE("programs/Lambda2b - More nested lambdas", "[codegen][struct]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "988c2083a8eceed9f580c8ec6830e3bee0f4353b677bdad6b59aed2fe98afbe2");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "656aa1fa4f078ae8918cab718704e77d1831542712737b5e3fd8de5fb210cdbd");
 }
 
 
@@ -1614,7 +1617,7 @@ TEST_CASE("programs/example", "[codegen][program]")
     cv->visitCompilationUnit(tree);
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "468c29659808773d4cf880d99d88374e1d02640e6bc970c12215db998af32a8c");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "660d149d9b30dbfa2ca119dbf41c83285b47a4440ff98579802679734cd5e8e7");
 }
 
 /************************************
@@ -1728,7 +1731,7 @@ TEST_CASE("B Level Positive Test #2", "[codegen]")
 
     REQUIRE_FALSE(cv->hasErrors(0));
 
-    REQUIRE(llvmIrToSHA256(cv->getModule()) == "a7d0860f47d046fb0a819057f8abc6cac2fc3046f0dd8b9ad631a6ededb7c328");
+    REQUIRE(llvmIrToSHA256(cv->getModule()) == "f484a6181b7df8b92c2c5065af6c803b1da730d56702bb41b8c0966ec71b6656");
 }
 
 /************************************
@@ -1786,4 +1789,1946 @@ TEST_CASE("A Level Positive Test #2", "[codegen]")
     REQUIRE_FALSE(cv->hasErrors(0));
 
     REQUIRE(llvmIrToSHA256(cv->getModule()) == "3ab074cdd00ea287689233a158d1bc268eaa11ac1d07fb1e2fb633e8bca8eaca");
+}
+TEST_CASE("Entry block allocations", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+    int i <- 0;
+    while i < 10 do {
+        int j <- i * 2;
+        int [5] a;
+        a[0] <- j;
+        i <- i + a[0];
+    }
+    return i;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Function *fn = cv->getModule()->getFunction("program");
+    REQUIRE(fn);
+
+    unsigned int numAllocas = 0;
+    unsigned int numStarts = 0;
+    unsigned int numEnds = 0;
+
+    for (llvm::BasicBlock &blk : *fn)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::isa<llvm::AllocaInst>(inst))
+            {
+                // Every allocation should be in the entry block, even those for the loop body
+                REQUIRE(&blk == &fn->getEntryBlock());
+                numAllocas++;
+            }
+            else if (llvm::IntrinsicInst *intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(&inst))
+            {
+                if (intrinsic->getIntrinsicID() == llvm::Intrinsic::lifetime_start)
+                    numStarts++;
+                else if (intrinsic->getIntrinsicID() == llvm::Intrinsic::lifetime_end)
+                    numEnds++;
+            }
+        }
+    }
+
+    REQUIRE(numAllocas >= 3);
+    // Only j and a are scoped to the loop body
+    REQUIRE(numStarts == 2);
+    REQUIRE(numEnds == 2);
+}
+
+TEST_CASE("Array access through variable storage", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int [100000] g;
+
+int func program() {
+    int [100000] a;
+    int i <- 0;
+    while i < a.length do {
+        a[i] <- i;
+        g[i] <- a[i] + g[i];
+        i <- i + 1;
+    }
+    return a[5] + g[5];
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Function *fn = cv->getModule()->getFunction("program");
+    REQUIRE(fn);
+
+    unsigned int numArrayAllocas = 0;
+
+    for (llvm::BasicBlock &blk : *fn)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            // The only array allocation should be for a itself
+            if (llvm::AllocaInst *alloc = llvm::dyn_cast<llvm::AllocaInst>(&inst))
+            {
+                if (alloc->getAllocatedType()->isArrayTy())
+                    numArrayAllocas++;
+            }
+
+            // Whole arrays should never be loaded or stored
+            if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(&inst))
+                REQUIRE_FALSE(load->getType()->isArrayTy());
+
+            if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(&inst))
+                REQUIRE_FALSE(store->getValueOperand()->getType()->isArrayTy());
+        }
+    }
+
+    REQUIRE(numArrayAllocas == 1);
+}
+
+TEST_CASE("Struct field access through variable storage", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+define struct Inner {
+    int x;
+    int [4] arr;
+}
+
+define struct Outer {
+    boolean b;
+    Inner in;
+}
+
+int func program() {
+    Outer o;
+    o.in.arr[2] <- 7;
+    return o.in.x + o.in.arr[2];
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Function *fn = cv->getModule()->getFunction("program");
+    REQUIRE(fn);
+
+    unsigned int numAllocas = 0;
+    unsigned int numFieldGEPs = 0;
+
+    for (llvm::BasicBlock &blk : *fn)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::isa<llvm::AllocaInst>(inst))
+                numAllocas++;
+
+            // o.in.x should be a single GEP of o with the indices 0, 1, 0
+            if (llvm::GetElementPtrInst *gep = llvm::dyn_cast<llvm::GetElementPtrInst>(&inst))
+            {
+                if (gep->getSourceElementType()->isStructTy() && gep->getNumIndices() == 3)
+                    numFieldGEPs++;
+            }
+
+            // Structs should never be loaded or stored as a whole
+            if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(&inst))
+                REQUIRE_FALSE(load->getType()->isStructTy());
+
+            if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(&inst))
+                REQUIRE_FALSE(store->getValueOperand()->getType()->isStructTy());
+        }
+    }
+
+    // Only o itself should need to be allocated
+    REQUIRE(numAllocas == 1);
+    REQUIRE(numFieldGEPs == 3);
+}
+
+TEST_CASE("Bounds checks are only generated when needed", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func get(int [10] a, int k) {
+    return a[k];
+}
+
+int func program() {
+    int [10] a;
+    a[3] <- 1;
+
+    int i <- 0;
+    while i < a.length do {
+        a[i] <- a[i] + i;
+        i <- i + 1;
+    }
+
+    int j <- 0;
+    while j <= a.length do {
+        a[j] <- 0;
+        j <- j + 1;
+    }
+
+    return get(a, 3) + a[10];
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::BOUNDS_CHECK);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    unsigned int numChecks = 0;
+
+    for (llvm::Function &fn : *cv->getModule())
+    {
+        for (llvm::BasicBlock &blk : fn)
+        {
+            for (llvm::Instruction &inst : blk)
+            {
+                if (llvm::IntrinsicInst *intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(&inst))
+                {
+                    if (intrinsic->getIntrinsicID() == llvm::Intrinsic::trap)
+                        numChecks++;
+                }
+
+                // Checks should be weighted towards being in bounds
+                if (llvm::BranchInst *br = llvm::dyn_cast<llvm::BranchInst>(&inst))
+                {
+                    if (br->isConditional() && br->getSuccessor(1)->getName().startswith("outofbounds"))
+                        REQUIRE(br->getMetadata(llvm::LLVMContext::MD_prof));
+                }
+            }
+        }
+    }
+
+    // a[k] in get, a[j] in the second loop (as j may equal a.length), and a[10]
+    REQUIRE(numChecks == 3);
+}
+
+TEST_CASE("Bounds checks on 64 bit indices", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func at(int [4] a, int64 k) {
+    return a[k];
+}
+
+int func program() {
+    int [4] a;
+    return at(a, 4294967296);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::BOUNDS_CHECK);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    llvm::Function *at = module->getFunction("at");
+    REQUIRE(at);
+
+    // Truncating 2^32 to an INT would give 0, which is in bounds, so the index must be checked at its full width
+    unsigned int wideChecks = 0;
+    for (llvm::BasicBlock &blk : *at)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            REQUIRE_FALSE(llvm::isa<llvm::TruncInst>(&inst));
+
+            if (llvm::ICmpInst *cmp = llvm::dyn_cast<llvm::ICmpInst>(&inst); cmp && cmp->getPredicate() == llvm::CmpInst::ICMP_ULT)
+            {
+                REQUIRE(cmp->getOperand(0)->getType()->isIntegerTy(64));
+                wideChecks++;
+            }
+        }
+    }
+
+    REQUIRE(wideChecks == 1);
+}
+
+TEST_CASE("Constant folding", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int g <- 2 * 21;
+
+int func program() {
+    boolean b <- (1 < 2) & ~false;
+    return g + (1 + 2 * 3);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::CONST_FOLD);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::GlobalVariable *glob = cv->getModule()->getNamedGlobal("g");
+    REQUIRE(glob);
+    REQUIRE(llvm::cast<llvm::ConstantInt>(glob->getInitializer())->getSExtValue() == 42);
+
+    llvm::Function *fn = cv->getModule()->getFunction("program");
+    REQUIRE(fn);
+
+    // Only g + 7 should remain; the boolean should not need any branches
+    unsigned int numBinOps = 0;
+    for (llvm::BasicBlock &blk : *fn)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::isa<llvm::BinaryOperator>(inst) || llvm::isa<llvm::CmpInst>(inst))
+                numBinOps++;
+        }
+    }
+
+    REQUIRE(fn->size() == 1);
+    REQUIRE(numBinOps == 1);
+}
+
+TEST_CASE("Selects on a single INT generate switches", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+    int x <- 2;
+    int y <- 0;
+
+    select {
+        x = 1 : y <- 10;
+        (2 = x) : y <- 20;
+        x = 1 : y <- 30;
+        x = 3 : { return 3; }
+        true : y <- 40;
+    }
+
+    select {
+        x = 1 : y <- 5;
+        (x = 3) : y <- 7;
+    }
+
+    return y;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::SELECT_SWITCH);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Function *fn = cv->getModule()->getFunction("program");
+    REQUIRE(fn);
+
+    std::vector<llvm::SwitchInst *> switches;
+    unsigned int numCondBrs = 0;
+    for (llvm::BasicBlock &blk : *fn)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::SwitchInst *sw = llvm::dyn_cast<llvm::SwitchInst>(&inst))
+            {
+                switches.push_back(sw);
+            }
+            else if (llvm::BranchInst *br = llvm::dyn_cast<llvm::BranchInst>(&inst))
+            {
+                if (br->isConditional())
+                    numCondBrs++;
+            }
+        }
+    }
+
+    REQUIRE(switches.size() == 2);
+    REQUIRE(numCondBrs == 0);
+
+    // The repeated case for 1 is unreachable and the last alternative is the default
+    REQUIRE(switches.at(0)->getNumCases() == 3);
+    REQUIRE(switches.at(0)->getDefaultDest()->getName().startswith("default"));
+
+    // A parenthesized comparison as the last alternative is just another case
+    REQUIRE(switches.at(1)->getNumCases() == 2);
+    REQUIRE(switches.at(1)->getDefaultDest()->getName().startswith("selectcont"));
+}
+
+TEST_CASE("Matches on variables do not copy the sum", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+    (int + boolean) v <- 5;
+    int total <- 0;
+
+    match v {
+        int i => { total <- i; }
+        boolean b => { total <- 1; }
+    }
+
+    return total;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Function *fn = cv->getModule()->getFunction("program");
+    REQUIRE(fn);
+
+    // The tag and payload are read through GEPs on v, so the whole sum is never loaded into a temporary
+    unsigned int numSumAllocas = 0;
+    for (llvm::BasicBlock &blk : *fn)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::AllocaInst *alloc = llvm::dyn_cast<llvm::AllocaInst>(&inst))
+            {
+                if (alloc->getAllocatedType()->isStructTy())
+                    numSumAllocas++;
+            }
+            else if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(&inst))
+            {
+                REQUIRE_FALSE(load->getType()->isStructTy());
+            }
+        }
+    }
+
+    REQUIRE(numSumAllocas == 1);
+}
+
+TEST_CASE("Matches read the sum in place", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+    (int + boolean) v <- 5;
+
+    match v {
+        int i => { return i; }
+        boolean b => { return 0; }
+    }
+
+    return 1;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::SELECT_SWITCH);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Function *fn = cv->getModule()->getFunction("program");
+    REQUIRE(fn);
+
+    // Only the variable itself should be a sum-typed allocation; the match should not copy it
+    unsigned int numSumAllocas = 0;
+    unsigned int numSwitches = 0;
+    for (llvm::BasicBlock &blk : *fn)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::AllocaInst *alloc = llvm::dyn_cast<llvm::AllocaInst>(&inst))
+            {
+                if (alloc->getAllocatedType()->isStructTy())
+                    numSumAllocas++;
+            }
+            else if (llvm::SwitchInst *sw = llvm::dyn_cast<llvm::SwitchInst>(&inst))
+            {
+                numSwitches++;
+
+                // An unassigned sum has tag 0, so the default must stay reachable
+                REQUIRE(sw->getNumCases() == 2);
+                REQUIRE(sw->getDefaultDest()->getName().startswith("matchcont"));
+            }
+        }
+    }
+
+    REQUIRE(numSumAllocas == 1);
+    REQUIRE(numSwitches == 1);
+}
+
+TEST_CASE("Compact sum layout", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+    (int + boolean) v <- true;
+    (str + boolean) s <- "hello";
+
+    match v {
+        int i => { return i; }
+        boolean b => { return 0; }
+    }
+
+    return 1;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::COMPACT_SUMS);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    const llvm::DataLayout &DL = module->getDataLayout();
+
+    llvm::StructType *intOrBool = llvm::StructType::getTypeByName(module->getContext(), "(BOOL + INT)");
+    REQUIRE(intOrBool);
+    REQUIRE(intOrBool->getElementType(0)->isIntegerTy(8));
+    REQUIRE(DL.getStructLayout(intOrBool)->getElementOffset(1) == DL.getABITypeAlign(llvm::Type::getInt32Ty(module->getContext())).value());
+
+    llvm::StructType *strOrBool = llvm::StructType::getTypeByName(module->getContext(), "(BOOL + STR)");
+    REQUIRE(strOrBool);
+    REQUIRE(strOrBool->getElementType(0)->isIntegerTy(8));
+    REQUIRE(DL.getStructLayout(strOrBool)->getElementOffset(1) == DL.getPointerABIAlignment(0).value());
+
+    // The match must compare against tags of the same width
+    llvm::Function *fn = module->getFunction("program");
+    REQUIRE(fn);
+    REQUIRE_FALSE(llvm::verifyFunction(*fn, &llvm::errs()));
+}
+
+TEST_CASE("Aggregates passed by reference", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+define struct Pair {
+    int a;
+    int b;
+}
+
+int func total(int [100] arr) {
+    int sum <- 0;
+    int i <- 0;
+    while i < 100 do {
+        sum <- sum + arr[i];
+        i <- i + 1;
+    }
+    return sum;
+}
+
+int func clobber(int [100] arr) {
+    arr[0] <- 5;
+    return arr[0];
+}
+
+Pair func swap(Pair p) {
+    return Pair::init(p.b, p.a);
+}
+
+int func program() {
+    int [100] a;
+    Pair p <- swap(Pair::init(1, 2));
+    return total(a) + clobber(a) + p.a;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::AGGREGATE_REFS);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    auto arrayAllocas = [](llvm::Function *fn) {
+        std::vector<llvm::AllocaInst *> ans;
+        for (llvm::BasicBlock &blk : *fn)
+        {
+            for (llvm::Instruction &inst : blk)
+            {
+                if (llvm::AllocaInst *alloc = llvm::dyn_cast<llvm::AllocaInst>(&inst))
+                {
+                    if (alloc->getAllocatedType()->isArrayTy())
+                        ans.push_back(alloc);
+                }
+            }
+        }
+        return ans;
+    };
+
+    // Arrays that are only read are used in place, while those that are updated are copied by the callee
+    llvm::Function *total = module->getFunction("total");
+    REQUIRE(total);
+    REQUIRE(total->getArg(0)->getType()->isPointerTy());
+    REQUIRE(total->hasParamAttribute(0, llvm::Attribute::ReadOnly));
+    REQUIRE(total->hasParamAttribute(0, llvm::Attribute::NoAlias));
+    REQUIRE(arrayAllocas(total).empty());
+
+    llvm::Function *clobber = module->getFunction("clobber");
+    REQUIRE(clobber);
+    REQUIRE(arrayAllocas(clobber).size() == 1);
+
+    // Structs are returned through the caller's storage
+    llvm::Function *swap = module->getFunction("swap");
+    REQUIRE(swap);
+    REQUIRE(swap->hasStructRetAttr());
+    REQUIRE(swap->getReturnType()->isVoidTy());
+
+    // The caller passes its own variable rather than a copy
+    llvm::Function *program = module->getFunction("program");
+    REQUIRE(program);
+
+    std::vector<llvm::AllocaInst *> callerArrays = arrayAllocas(program);
+    REQUIRE(callerArrays.size() == 1);
+
+    for (llvm::BasicBlock &blk : *program)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst))
+            {
+                if (call->getCalledFunction() == total || call->getCalledFunction() == clobber)
+                    REQUIRE(call->getArgOperand(0) == callerArrays.at(0));
+            }
+        }
+    }
+}
+
+TEST_CASE("Externs take aggregates by value", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+define struct P {
+    int a;
+    int b;
+}
+
+extern int func takeP(P p);
+extern P func makeP(int a);
+
+int func program() {
+    P p <- makeP(1);
+    return takeP(p);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    // Externs follow the C convention, so their signatures must not depend on how WPL passes aggregates
+    for (int flags : std::vector<int>{CompilerFlags::NO_RUNTIME, CompilerFlags::NO_RUNTIME | CompilerFlags::AGGREGATE_REFS})
+    {
+        CodegenVisitor *cv = new CodegenVisitor(pm, "test", flags);
+        cv->visitCompilationUnit(tree);
+        REQUIRE_FALSE(cv->hasErrors(0));
+
+        llvm::Module *module = cv->getModule();
+        REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+        llvm::Function *takeP = module->getFunction("takeP");
+        REQUIRE(takeP);
+        REQUIRE(takeP->arg_size() == 1);
+        REQUIRE(takeP->getArg(0)->getType()->isStructTy());
+
+        llvm::Function *makeP = module->getFunction("makeP");
+        REQUIRE(makeP);
+        REQUIRE(makeP->arg_size() == 1);
+        REQUIRE_FALSE(makeP->hasStructRetAttr());
+        REQUIRE(makeP->getReturnType()->isStructTy());
+    }
+}
+
+TEST_CASE("Function attributes from effects", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+extern int func printf(str s, ...);
+
+int g <- 1;
+
+int func square(int x) {
+    return x * x;
+}
+
+int func readG() {
+    return g + square(2);
+}
+
+proc bump() {
+    g <- g + 1;
+}
+
+int func countDown(int n) {
+    while n > 0 do {
+        n <- n - 1;
+    }
+    return n;
+}
+
+int func fact(int n) {
+    if n <= 1 then {
+        return 1;
+    }
+    return n * fact(n - 1);
+}
+
+int func get(int [] s, int i) {
+    return s[i];
+}
+
+int func program() {
+    bump();
+    printf("%u\n", readG());
+    return countDown(3) + fact(3);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::FUNCTION_ATTRS);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+
+    llvm::Function *square = module->getFunction("square");
+    REQUIRE(square);
+    REQUIRE(square->hasFnAttribute(llvm::Attribute::NoUnwind));
+    REQUIRE(square->hasFnAttribute(llvm::Attribute::ReadNone));
+    REQUIRE(square->hasFnAttribute(llvm::Attribute::WillReturn));
+    REQUIRE(square->hasFnAttribute(llvm::Attribute::NoRecurse));
+
+    llvm::Function *readG = module->getFunction("readG");
+    REQUIRE(readG);
+    REQUIRE(readG->hasFnAttribute(llvm::Attribute::ReadOnly));
+    REQUIRE(readG->hasFnAttribute(llvm::Attribute::WillReturn));
+
+    llvm::Function *bump = module->getFunction("bump");
+    REQUIRE(bump);
+    REQUIRE(bump->hasFnAttribute(llvm::Attribute::NoUnwind));
+    REQUIRE_FALSE(bump->hasFnAttribute(llvm::Attribute::ReadOnly));
+    REQUIRE_FALSE(bump->hasFnAttribute(llvm::Attribute::ReadNone));
+
+    // Loops and recursion may not terminate
+    llvm::Function *countDown = module->getFunction("countDown");
+    REQUIRE(countDown);
+    REQUIRE(countDown->hasFnAttribute(llvm::Attribute::ReadNone));
+    REQUIRE_FALSE(countDown->hasFnAttribute(llvm::Attribute::WillReturn));
+
+    llvm::Function *fact = module->getFunction("fact");
+    REQUIRE(fact);
+    REQUIRE(fact->hasFnAttribute(llvm::Attribute::ReadNone));
+    REQUIRE_FALSE(fact->hasFnAttribute(llvm::Attribute::WillReturn));
+    REQUIRE_FALSE(fact->hasFnAttribute(llvm::Attribute::NoRecurse));
+
+    // Slices are always bounds checked, so indexing one may abort even without BOUNDS_CHECK
+    llvm::Function *get = module->getFunction("get");
+    REQUIRE(get);
+    REQUIRE_FALSE(get->hasFnAttribute(llvm::Attribute::WillReturn));
+    REQUIRE_FALSE(get->hasFnAttribute(llvm::Attribute::ReadOnly));
+    REQUIRE_FALSE(get->hasFnAttribute(llvm::Attribute::ReadNone));
+
+    // Known externs are annotated too
+    llvm::Function *printf = module->getFunction("printf");
+    REQUIRE(printf);
+    REQUIRE(printf->hasFnAttribute(llvm::Attribute::NoUnwind));
+
+    llvm::Function *program = module->getFunction("program");
+    REQUIRE(program);
+    REQUIRE_FALSE(program->hasFnAttribute(llvm::Attribute::ReadOnly));
+    REQUIRE_FALSE(program->hasFnAttribute(llvm::Attribute::WillReturn));
+}
+
+TEST_CASE("Callers of recursive functions may not return", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+proc spin(int x) {
+    spin(x);
+}
+
+int func f(int x) {
+    spin(x);
+    return x;
+}
+
+int func program() {
+    return f(1);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::FUNCTION_ATTRS);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+
+    llvm::Function *spin = module->getFunction("spin");
+    REQUIRE(spin);
+    REQUIRE_FALSE(spin->hasFnAttribute(llvm::Attribute::WillReturn));
+    REQUIRE_FALSE(spin->hasFnAttribute(llvm::Attribute::NoRecurse));
+
+    // Neither f nor program recurse themselves, but both reach spin, which may never return
+    for (std::string name : {"f", "program"})
+    {
+        llvm::Function *fn = module->getFunction(name);
+        REQUIRE(fn);
+        REQUIRE(fn->hasFnAttribute(llvm::Attribute::NoRecurse));
+        REQUIRE_FALSE(fn->hasFnAttribute(llvm::Attribute::WillReturn));
+    }
+}
+
+TEST_CASE("Tail calls and self recursion", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func sum(int n, int acc) {
+    if n <= 0 then {
+        return acc;
+    }
+    return sum(n - 1, acc + n);
+}
+
+proc countDown(int n) {
+    if n > 0 then {
+        countDown(n - 1);
+    }
+}
+
+boolean func isEven(int n) {
+    if n = 0 then {
+        return true;
+    }
+    return isOdd(n - 1);
+}
+
+boolean func isOdd(int n) {
+    if n = 0 then {
+        return false;
+    }
+    return isEven(n - 1);
+}
+
+int func twice(int n) {
+    return sum(n, n);
+}
+
+int func program() {
+    countDown(3);
+    return twice(3);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::TAIL_CALLS);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    // Finds the calls a function makes to another
+    auto callsTo = [](llvm::Function *fn, llvm::Function *callee) {
+        std::vector<llvm::CallInst *> calls;
+        for (llvm::BasicBlock &blk : *fn)
+        {
+            for (llvm::Instruction &inst : blk)
+            {
+                if (llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst); call && call->getCalledFunction() == callee)
+                    calls.push_back(call);
+            }
+        }
+        return calls;
+    };
+
+    // Direct self recursion becomes a loop, in both FUNCs and PROCs
+    llvm::Function *sum = module->getFunction("sum");
+    REQUIRE(sum);
+    REQUIRE(callsTo(sum, sum).empty());
+
+    llvm::Function *countDown = module->getFunction("countDown");
+    REQUIRE(countDown);
+    REQUIRE(callsTo(countDown, countDown).empty());
+
+    // Mutual recursion between functions of the same prototype is guaranteed to reuse the frame
+    llvm::Function *isEven = module->getFunction("isEven");
+    llvm::Function *isOdd = module->getFunction("isOdd");
+    REQUIRE(isEven);
+    REQUIRE(isOdd);
+    REQUIRE(callsTo(isEven, isOdd).size() == 1);
+    REQUIRE(callsTo(isEven, isOdd).at(0)->isMustTailCall());
+    REQUIRE(callsTo(isOdd, isEven).size() == 1);
+    REQUIRE(callsTo(isOdd, isEven).at(0)->isMustTailCall());
+
+    // Otherwise, the call is only marked as a tail call
+    llvm::Function *twice = module->getFunction("twice");
+    REQUIRE(twice);
+    REQUIRE(callsTo(twice, sum).size() == 1);
+    REQUIRE(callsTo(twice, sum).at(0)->isTailCall());
+    REQUIRE_FALSE(callsTo(twice, sum).at(0)->isMustTailCall());
+
+    // Calls that are not in tail position are left alone
+    llvm::Function *program = module->getFunction("program");
+    REQUIRE(program);
+    REQUIRE(callsTo(program, countDown).size() == 1);
+    REQUIRE_FALSE(callsTo(program, countDown).at(0)->isTailCall());
+}
+
+TEST_CASE("Calls through reassigned function variables are not self tail calls", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func other(int n) {
+    return n;
+}
+
+int func fib(int n) {
+    var f <- fib;
+    if n <= 0 then {
+        return 0;
+    }
+    f <- other;
+    return f(n - 1);
+}
+
+int func program() {
+    return fib(3);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::TAIL_CALLS);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    llvm::Function *fib = module->getFunction("fib");
+    REQUIRE(fib);
+
+    // f no longer refers to fib when it is called, so the call must go through it rather than looping back
+    unsigned int indirectCalls = 0;
+    for (llvm::BasicBlock &blk : *fib)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst); call && !call->getCalledFunction())
+                indirectCalls++;
+        }
+    }
+
+    REQUIRE(indirectCalls == 1);
+}
+
+TEST_CASE("Single test loops with hints", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+    int [8] a;
+    int i <- 0;
+    @unroll(4) @vectorize(8)
+    while i < 8 do {
+        a[i] <- i * 2;
+        i <- i + 1;
+    }
+    return a[7];
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::SINGLE_TEST_LOOPS);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    llvm::Function *program = module->getFunction("program");
+    REQUIRE(program);
+
+    // The condition is only generated once, and the latch carries the hints
+    unsigned int compares = 0;
+    llvm::MDNode *loopID = nullptr;
+    for (llvm::BasicBlock &blk : *program)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::isa<llvm::ICmpInst>(&inst))
+                compares++;
+            if (llvm::MDNode *md = inst.getMetadata(llvm::LLVMContext::MD_loop))
+                loopID = md;
+        }
+    }
+
+    REQUIRE(compares == 1);
+    REQUIRE(loopID);
+    REQUIRE(loopID->getOperand(0) == loopID);
+
+    auto getCount = [&](std::string property) -> std::optional<uint64_t> {
+        for (unsigned int i = 1; i < loopID->getNumOperands(); i++)
+        {
+            llvm::MDNode *op = llvm::cast<llvm::MDNode>(loopID->getOperand(i));
+            if (llvm::cast<llvm::MDString>(op->getOperand(0))->getString() == property)
+                return llvm::mdconst::extract<llvm::ConstantInt>(op->getOperand(1))->getZExtValue();
+        }
+        return std::nullopt;
+    };
+
+    REQUIRE(getCount("llvm.loop.unroll.count") == std::optional<uint64_t>(4));
+    REQUIRE(getCount("llvm.loop.vectorize.enable") == std::optional<uint64_t>(1));
+    REQUIRE(getCount("llvm.loop.vectorize.width") == std::optional<uint64_t>(8));
+}
+
+TEST_CASE("String literal pool", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+extern int func printf(str s, ...);
+
+str greeting <- "hi\t\"there\"\n";
+
+int func program() {
+    printf("%u\n", 1);
+    printf("%u\n", 2);
+    printf(greeting);
+    printf("\\n");
+    return 0;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::STRING_POOL);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    // Each distinct literal gets exactly one global, with its escapes decoded
+    std::vector<std::string> literals;
+    for (llvm::GlobalVariable &glob : module->globals())
+    {
+        if (llvm::ConstantDataArray *dat = llvm::dyn_cast_or_null<llvm::ConstantDataArray>(glob.hasInitializer() ? glob.getInitializer() : nullptr))
+        {
+            if (dat->isCString())
+                literals.push_back(dat->getAsCString().str());
+        }
+    }
+
+    REQUIRE(std::count(literals.begin(), literals.end(), "%u\n") == 1);
+    REQUIRE(std::count(literals.begin(), literals.end(), "hi\t\"there\"\n") == 1);
+    REQUIRE(std::count(literals.begin(), literals.end(), "\\n") == 1);
+}
+
+TEST_CASE("Debug info", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int g <- 2;
+
+int func scale(int x) {
+    int y <- x * g;
+    return y;
+}
+
+int func program() {
+    var f <- (int a) : int {
+        return a + 1;
+    };
+    return scale(f(3));
+}
+)"""");
+    input.name = "dir/debug.wpl";
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::DEBUG_INFO);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    bool brokenDebugInfo = false;
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs(), &brokenDebugInfo));
+    REQUIRE_FALSE(brokenDebugInfo);
+
+    llvm::Function *scale = module->getFunction("scale");
+    REQUIRE(scale);
+    llvm::DISubprogram *sp = scale->getSubprogram();
+    REQUIRE(sp);
+    REQUIRE(sp->getName() == "scale");
+    REQUIRE(sp->getLine() == 4);
+    REQUIRE(sp->getFilename() == "debug.wpl");
+    REQUIRE(sp->getDirectory() == "dir");
+
+    // Instructions are attributed to the statement they were generated for, and variables are described
+    bool sawMultiply = false;
+    std::set<std::string> variables;
+    for (llvm::BasicBlock &blk : *scale)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (inst.getOpcode() == llvm::Instruction::Mul)
+            {
+                sawMultiply = true;
+                REQUIRE(inst.getDebugLoc());
+                REQUIRE(inst.getDebugLoc().getLine() == 5);
+            }
+
+            if (llvm::DbgDeclareInst *declare = llvm::dyn_cast<llvm::DbgDeclareInst>(&inst))
+                variables.insert(declare->getVariable()->getName().str());
+        }
+    }
+    REQUIRE(sawMultiply);
+    REQUIRE(variables == std::set<std::string>({"x", "y"}));
+
+    // Lambdas and globals are described too, but the generated main is not
+    bool sawLambda = false;
+    for (llvm::Function &fn : *module)
+    {
+        if (fn.getSubprogram() && fn.getSubprogram()->getName() == "lambda")
+        {
+            sawLambda = true;
+            REQUIRE(fn.getSubprogram()->getLine() == 10);
+        }
+    }
+    REQUIRE(sawLambda);
+    REQUIRE_FALSE(module->getFunction("main")->getSubprogram());
+
+    llvm::SmallVector<llvm::DIGlobalVariableExpression *, 1> globals;
+    module->getNamedGlobal("g")->getDebugInfo(globals);
+    REQUIRE(globals.size() == 1);
+    REQUIRE(globals[0]->getVariable()->getName() == "g");
+}
+
+TEST_CASE("Debug info for bounds checks", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func third(int [] xs) {
+    return 1 + xs[2];
+}
+
+int func program() {
+    int [5] a;
+    return third(a);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::DEBUG_INFO);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    bool brokenDebugInfo = false;
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs(), &brokenDebugInfo));
+    REQUIRE_FALSE(brokenDebugInfo);
+
+    llvm::Function *third = module->getFunction("third");
+    REQUIRE(third);
+
+    // A failed check is attributed to the access, while the rest of the statement keeps its own location
+    bool sawTrap = false;
+    bool sawAdd = false;
+    for (llvm::BasicBlock &blk : *third)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::IntrinsicInst *intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(&inst))
+            {
+                if (intrinsic->getIntrinsicID() == llvm::Intrinsic::trap)
+                {
+                    sawTrap = true;
+                    REQUIRE(inst.getDebugLoc());
+                    REQUIRE(inst.getDebugLoc().getLine() == 3);
+                    REQUIRE(inst.getDebugLoc().getCol() == 16);
+                }
+            }
+            else if (inst.getOpcode() == llvm::Instruction::Add)
+            {
+                sawAdd = true;
+                REQUIRE(inst.getDebugLoc());
+                REQUIRE(inst.getDebugLoc().getCol() == 5);
+            }
+        }
+    }
+    REQUIRE(sawTrap);
+    REQUIRE(sawAdd);
+}
+
+TEST_CASE("Profile instrumentation", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+    int i <- 0;
+    while i < 10 do {
+        i <- i + 1;
+    }
+    return i;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+
+    SECTION("Generating a profile instruments the program")
+    {
+        REQUIRE_FALSE(runProfilePipeline(module, nullptr, llvm::PGOOptions("", "", "", llvm::PGOOptions::IRInstr), 0).has_value());
+        REQUIRE_FALSE(llvm::verifyModule(*module));
+
+        // The counters are updated in the program and written out by the profile runtime
+        bool hasCounters = false;
+        for (llvm::GlobalVariable &glob : module->globals())
+        {
+            if (glob.getName().startswith("__profc_program"))
+                hasCounters = true;
+        }
+
+        REQUIRE(hasCounters);
+        REQUIRE(module->getNamedValue("__llvm_profile_runtime"));
+    }
+
+    SECTION("Missing profiles are reported")
+    {
+        std::string fileName = std::tmpnam(nullptr);
+
+        std::optional<std::string> errors = runProfilePipeline(module, nullptr, llvm::PGOOptions(fileName, "", "", llvm::PGOOptions::IRUse), 0);
+        REQUIRE(errors.has_value());
+        REQUIRE(errors.value().find(fileName) != std::string::npos);
+    }
+
+    SECTION("Malformed profiles are reported")
+    {
+        std::string fileName = std::tmpnam(nullptr);
+        std::ofstream(fileName) << "not a profile";
+
+        std::optional<std::string> errors = runProfilePipeline(module, nullptr, llvm::PGOOptions(fileName, "", "", llvm::PGOOptions::IRUse), 2);
+        REQUIRE(errors.has_value());
+        std::remove(fileName.c_str());
+    }
+}
+
+TEST_CASE("Branchless logic for cheap operands", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+boolean func isPositive(int a) {
+    return a > 0;
+}
+
+boolean func inRange(int a, int b, int c) {
+    return a < b & b < c & c / 2 ~= 0;
+}
+
+boolean func outside(int a, int b) {
+    return a < 0 | (b > 10 | a + b = 7);
+}
+
+boolean func guarded(int [5] arr, int i) {
+    return i < 5 & arr[i] > 0;
+}
+
+boolean func calls(int a) {
+    return a = 1 | isPositive(a) | a / a = 1;
+}
+
+int func program() {
+    return 0;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::BRANCHLESS_LOGIC);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    // Counts the conditional branches in a function
+    auto countBranches = [module](std::string name) {
+        unsigned int count = 0;
+        for (llvm::BasicBlock &blk : *module->getFunction(name))
+        {
+            if (llvm::BranchInst *br = llvm::dyn_cast<llvm::BranchInst>(blk.getTerminator()))
+            {
+                if (br->isConditional())
+                    count++;
+            }
+        }
+        return count;
+    };
+
+    // Comparisons, arithmetic, and division by a safe constant are evaluated unconditionally
+    REQUIRE(countBranches("inRange") == 0);
+    REQUIRE(countBranches("outside") == 0);
+
+    // Array accesses, calls, and division by a variable are still short-circuited
+    REQUIRE(countBranches("guarded") == 1);
+    REQUIRE(countBranches("calls") == 2);
+}
+
+TEST_CASE("Sized integers", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int8 limit <- 100;
+
+int64 func total(int8 [4] bytes) {
+    int64 sum <- 0;
+    int i <- 0;
+    while i < bytes.length do {
+        sum <- sum + bytes[i];
+        i <- i + 1;
+    }
+    return sum;
+}
+
+boolean func below(uint32 a, uint32 b) {
+    return a / 2 < b;
+}
+
+int func program() {
+    int8 [4] bytes;
+    bytes[0] <- 127;
+    bytes[1] <- -128;
+    int64 big <- 5000000000;
+    int64 t <- total(bytes) + big;
+    return int(t / 1000);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    llvm::Function *total = module->getFunction("total");
+    REQUIRE(total->getReturnType()->isIntegerTy(64));
+    REQUIRE(total->getArg(0)->getType() == llvm::ArrayType::get(llvm::Type::getInt8Ty(module->getContext()), 4));
+
+    // Counts the instructions with the given opcode in a function
+    auto countOps = [](llvm::Function *fn, unsigned int opcode) {
+        unsigned int count = 0;
+        for (llvm::BasicBlock &blk : *fn)
+        {
+            for (llvm::Instruction &inst : blk)
+            {
+                if (inst.getOpcode() == opcode)
+                    count++;
+            }
+        }
+        return count;
+    };
+
+    // Elements are sign extended before they are added to the INT64
+    REQUIRE(countOps(total, llvm::Instruction::SExt) == 1);
+
+    // Unsigned integers are divided and compared as unsigned
+    llvm::Function *below = module->getFunction("below");
+    REQUIRE(countOps(below, llvm::Instruction::UDiv) == 1);
+    REQUIRE(countOps(below, llvm::Instruction::SDiv) == 0);
+    bool sawUnsignedCompare = false;
+    for (llvm::BasicBlock &blk : *below)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::ICmpInst *cmp = llvm::dyn_cast<llvm::ICmpInst>(&inst))
+                sawUnsignedCompare = cmp->getPredicate() == llvm::CmpInst::ICMP_ULT;
+        }
+    }
+    REQUIRE(sawUnsignedCompare);
+
+    // Globals are initialized with constants of their own type
+    REQUIRE(module->getNamedGlobal("limit")->getInitializer() == llvm::ConstantInt::get(llvm::Type::getInt8Ty(module->getContext()), 100));
+
+    // The INT64 result is truncated back to an INT (the only other truncation is of the negated literal stored into the INT8 array)
+    unsigned int intTruncs = 0;
+    for (llvm::BasicBlock &blk : *module->getFunction("program"))
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::isa<llvm::TruncInst>(inst) && inst.getType()->isIntegerTy(32))
+                intTruncs++;
+        }
+    }
+    REQUIRE(intTruncs == 1);
+}
+
+TEST_CASE("Sized integer globals", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int8 limit <- 100;
+int64 big <- 5;
+int64 neg <- -1;
+int64 k <- 3000000000 + 1;
+uint8 m <- uint8(200) + 100;
+
+int func program() {
+    return limit;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, 0);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    // Without CONST_FOLD, the conversions to each global's type must still produce constants
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", 0);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    llvm::LLVMContext &context = module->getContext();
+    REQUIRE(module->getNamedGlobal("limit")->getInitializer() == llvm::ConstantInt::get(llvm::Type::getInt8Ty(context), 100));
+    REQUIRE(module->getNamedGlobal("big")->getInitializer() == llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), 5));
+    REQUIRE(module->getNamedGlobal("neg")->getInitializer() == llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), -1, true));
+
+    // Constant expressions are evaluated in their own type, wrapping around as they would at runtime
+    REQUIRE(module->getNamedGlobal("k")->getInitializer() == llvm::ConstantInt::get(llvm::Type::getInt64Ty(context), 3000000001));
+    REQUIRE(module->getNamedGlobal("m")->getInitializer() == llvm::ConstantInt::get(llvm::Type::getInt8Ty(context), 44));
+}
+
+TEST_CASE("Array slices", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func sum(int [] xs) {
+    int total <- 0;
+    int i <- 0;
+    while i < xs.length do {
+        total <- total + xs[i];
+        i <- i + 1;
+    }
+    return total;
+}
+
+int func program() {
+    int [3] small;
+    int [5] big;
+    small[0] <- 1;
+    big[4] <- 2;
+    return sum(small) + sum(big);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    // A single definition serves arrays of every length, which are passed as a pointer and a length
+    llvm::LLVMContext &context = module->getContext();
+    llvm::Function *sum = module->getFunction("sum");
+    REQUIRE(sum->getArg(0)->getType() == llvm::StructType::get(context, {llvm::Type::getInt32PtrTy(context), llvm::Type::getInt32Ty(context)}));
+
+    unsigned int calls = 0;
+    for (llvm::BasicBlock &blk : *module->getFunction("program"))
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst))
+            {
+                if (call->getCalledFunction() == sum)
+                    calls++;
+            }
+        }
+    }
+    REQUIRE(calls == 2);
+
+    // The length of a slice is only known at runtime, so its accesses are always checked (even without BOUNDS_CHECK)
+    bool checksBounds = false;
+    for (llvm::BasicBlock &blk : *sum)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::IntrinsicInst *intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(&inst))
+                checksBounds |= intrinsic->getIntrinsicID() == llvm::Intrinsic::trap;
+        }
+    }
+    REQUIRE(checksBounds);
+}
+
+TEST_CASE("Arrays passed as slices are not shared by reference", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+proc zero(int [] xs) {
+    xs[0] <- 0;
+}
+
+int func first(int [4] a) {
+    zero(a);
+    return a[0];
+}
+
+int func both(int [4] a, int [] xs) {
+    xs[0] <- 1;
+    return a[0];
+}
+
+int func program() {
+    int [4] a;
+    a[0] <- 5;
+    return first(a) + both(a, a);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME | CompilerFlags::AGGREGATE_REFS);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    // The readonly parameter is copied before it is sliced, as zero() writes to the slice
+    unsigned int firstArrayAllocas = 0;
+    for (llvm::BasicBlock &blk : *module->getFunction("first"))
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (llvm::AllocaInst *alloc = llvm::dyn_cast<llvm::AllocaInst>(&inst))
+            {
+                if (alloc->getAllocatedType()->isArrayTy())
+                    firstArrayAllocas++;
+            }
+        }
+    }
+    REQUIRE(firstArrayAllocas == 1);
+
+    // As both() writes to the slice of a, the array cannot also be passed as a (noalias) pointer to a's storage
+    llvm::Function *program = module->getFunction("program");
+    llvm::Value *arrayStorage = nullptr;
+    llvm::CallInst *bothCall = nullptr;
+    for (llvm::BasicBlock &blk : *program)
+    {
+        for (llvm::Instruction &inst : blk)
+        {
+            if (inst.getName() == "a")
+                arrayStorage = &inst;
+            else if (llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst))
+            {
+                if (call->getCalledFunction() == module->getFunction("both"))
+                    bothCall = call;
+            }
+        }
+    }
+    REQUIRE(arrayStorage);
+    REQUIRE(bothCall);
+    REQUIRE(bothCall->getArgOperand(0) != arrayStorage);
+}
+
+TEST_CASE("Dynamic arrays", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+extern int func getIntArg(int i);
+
+int func sum(int [] xs) {
+    int total <- 0;
+    int i <- 0;
+    while i < xs.length do {
+        total <- total + xs[i];
+        i <- i + 1;
+    }
+    return total;
+}
+
+int func program() {
+    int [* getIntArg(1)] xs;
+    int i <- 0;
+    while i < 100 do {
+        int [*] temp;
+        temp.push(i);
+        xs.push(temp[0]);
+        i <- i + 1;
+    }
+    return sum(xs);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", 0);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    // Counts the calls to a function within program()
+    auto countCalls = [module](std::string name) {
+        unsigned int count = 0;
+        for (llvm::BasicBlock &blk : *module->getFunction("program"))
+        {
+            for (llvm::Instruction &inst : blk)
+            {
+                llvm::CallInst *call = llvm::dyn_cast<llvm::CallInst>(&inst);
+                if (call && call->getCalledFunction() && call->getCalledFunction()->getName() == name)
+                    count++;
+            }
+        }
+        return count;
+    };
+
+    // xs is sized once when it is declared, and each push only calls the runtime when the array is full
+    REQUIRE(countCalls("_wplArrayResize") == 3);
+
+    // temp is freed at the end of each iteration, and xs once its sum has been computed
+    REQUIRE(countCalls("_wplArrayFree") == 2);
+    REQUIRE(countCalls("sum") == 1);
+
+    // Reading temp[0] is checked against its length at runtime, even without BOUNDS_CHECK
+    REQUIRE(countCalls("_arrayIndexOutOfBounds") == 1);
+}
+
+TEST_CASE("Array builtins", "[codegen]")
+{
+    antlr4::ANTLRInputStream input(R""""(
+int func score(int [] weights, int [] values) {
+    return weights.dot(values) + values.min();
+}
+
+int func program() {
+    int [10] a;
+    int [10] b;
+    a.fill(0);
+    b.fill(3);
+    a.copy(b);
+    a.add(b);
+    return score(a, b) + a.sum();
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+    STManager *stm = new STManager();
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(stm, pm, CompilerFlags::NO_RUNTIME);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(0));
+
+    CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
+    cv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(cv->hasErrors(0));
+
+    llvm::Module *module = cv->getModule();
+    REQUIRE_FALSE(llvm::verifyModule(*module, &llvm::errs()));
+
+    // Collects the names of the intrinsics called by a function, and if it loads or stores any vectors
+    auto inspect = [](llvm::Function *fn, std::set<llvm::Intrinsic::ID> &intrinsics) {
+        bool usesVectors = false;
+        for (llvm::BasicBlock &blk : *fn)
+        {
+            for (llvm::Instruction &inst : blk)
+            {
+                if (llvm::IntrinsicInst *call = llvm::dyn_cast<llvm::IntrinsicInst>(&inst))
+                    intrinsics.insert(call->getIntrinsicID());
+                if (llvm::LoadInst *load = llvm::dyn_cast<llvm::LoadInst>(&inst))
+                    usesVectors |= load->getType()->isVectorTy();
+                if (llvm::StoreInst *store = llvm::dyn_cast<llvm::StoreInst>(&inst))
+                    usesVectors |= store->getValueOperand()->getType()->isVectorTy();
+            }
+        }
+        return usesVectors;
+    };
+
+    // Reductions combine vectors of partial results
+    std::set<llvm::Intrinsic::ID> scoreIntrinsics;
+    REQUIRE(inspect(module->getFunction("score"), scoreIntrinsics));
+    REQUIRE(scoreIntrinsics.count(llvm::Intrinsic::vector_reduce_add));
+    REQUIRE(scoreIntrinsics.count(llvm::Intrinsic::vector_reduce_smin));
+
+    // Zero fills and copies are memsets and memmoves; other fills and elementwise operations store whole vectors
+    std::set<llvm::Intrinsic::ID> programIntrinsics;
+    REQUIRE(inspect(module->getFunction("program"), programIntrinsics));
+    REQUIRE(programIntrinsics.count(llvm::Intrinsic::memset));
+    REQUIRE(programIntrinsics.count(llvm::Intrinsic::memmove));
 }
\ No newline at end of file
@@ -2854,4 +2854,105 @@ TEST_CASE("A Level Negative Test #2", "[semantic]")
   // CodegenVisitor *cv = new CodegenVisitor(pm, "test", CompilerFlags::NO_RUNTIME);
   // cv->visitCompilationUnit(tree);
   // REQUIRE(cv->hasErrors(0));
+}
+
+TEST_CASE("Parallel semantic analysis matches sequential", "[semantic]")
+{
+  std::string src = R""""(
+int a <- 2;
+
+int func foo(int x) {
+  var y <- x * a;
+  return y + b;
+}
+
+int b <- 3;
+
+boolean func bar(int x) {
+  return x < b;
+}
+
+proc baz() {
+  int z <- "not an int";
+}
+
+int func program() {
+  var i <- foo(1);
+  if bar(i) then { i <- i + 1; }
+  return i;
+}
+)"""";
+
+  auto check = [&src](int flags)
+  {
+    antlr4::ANTLRInputStream input(src);
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager(), flags);
+    sv->visitCompilationUnit(tree);
+    return sv->getErrors();
+  };
+
+  std::string seqErrors = check(0);
+  std::string parErrors = check(CompilerFlags::PARALLEL_SEMANTIC);
+
+  // foo cannot see b as it is declared afterwards, and baz has a bad assignment
+  REQUIRE(seqErrors != "");
+  REQUIRE(parErrors == seqErrors);
+}
+
+TEST_CASE("Parallel semantic analysis with inferred globals", "[semantic]")
+{
+  std::string src = R""""(
+var limit <- 10;
+var name <- "wpl";
+
+boolean func under(int x) {
+  return x < limit;
+}
+
+int func twice() {
+  return limit * 2;
+}
+
+int func length() {
+  str copy <- name;
+  int wrong <- name;
+  return limit;
+}
+
+int func program() {
+  if under(twice()) then { return length(); }
+  return 0;
+}
+)"""";
+
+  auto check = [&src](int flags)
+  {
+    antlr4::ANTLRInputStream input(src);
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager(), flags);
+    sv->visitCompilationUnit(tree);
+    return sv->getErrors();
+  };
+
+  std::string seqErrors = check(0);
+  std::string parErrors = check(CompilerFlags::PARALLEL_SEMANTIC);
+
+  // Every body reads an inferred global, so they must agree on (and must not race to update) its type
+  REQUIRE(seqErrors != "");
+  REQUIRE(parErrors == seqErrors);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <catch2/catch_test_macros.hpp>
+#include <algorithm>
 #include "antlr4-runtime.h"
 #include "WPLLexer.h"
 #include "WPLParser.h"
@@ -228,4 +229,679 @@ TEST_CASE("Test Type Equality - Supertype", "[semantic]")
     REQUIRE(BOT->isNotSupertype(BOT));
   }
   // Why is PL easier to read in mono fonts?
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test Type Inference - Union Find", "[semantic]")
+{
+  SECTION("Long chain resolves together")
+  {
+    std::vector<TypeInfer *> vars;
+    for (int i = 0; i < 1000; i++)
+    {
+      vars.push_back(new TypeInfer());
+      if (i > 0)
+        REQUIRE(vars.at(i)->isSubtype(vars.at(i - 1)));
+    }
+
+    for (auto v : vars)
+      REQUIRE_FALSE(v->hasBeenInferred());
+
+    REQUIRE(vars.at(500)->isSubtype(Types::INT));
+
+    for (auto v : vars)
+    {
+      REQUIRE(v->hasBeenInferred());
+      REQUIRE(v->find() == vars.at(0)->find());
+      REQUIRE(v->toString() == "{VAR/INT}");
+    }
+  }
+
+  SECTION("Conflicting sets are rejected")
+  {
+    TypeInfer *a = new TypeInfer();
+    TypeInfer *b = new TypeInfer();
+    TypeInfer *c = new TypeInfer();
+
+    REQUIRE(a->isSubtype(Types::INT));
+    REQUIRE(b->isSubtype(Types::BOOL));
+    REQUIRE(c->isSubtype(a));
+
+    REQUIRE_FALSE(c->isSubtype(b));
+    REQUIRE(c->toString() == "{VAR/INT}");
+    REQUIRE(c->isNotSubtype(Types::STR));
+
+    // A failed unification leaves both sets as they were
+    REQUIRE(b->toString() == "{VAR/BOOL}");
+    REQUIRE(b->find() != c->find());
+    REQUIRE_FALSE(b->isSubtype(a));
+  }
+}
+
+TEST_CASE("Test Type Equality - Subtype Cache", "[semantic]")
+{
+  SubtypeCache::clear();
+
+  std::set<const Type *, TypeCompare> cases = {Types::INT, Types::BOOL, Types::STR};
+  const TypeSum *sum = new TypeSum(cases, "Wide");
+  const TypeInvoke *fn = new TypeInvoke({sum, Types::INT}, Types::BOOL);
+  const TypeInvoke *other = new TypeInvoke({sum, Types::INT}, Types::BOOL);
+
+  SECTION("Composite queries are cached")
+  {
+    REQUIRE(Types::INT->isSubtype(sum));
+    REQUIRE(Types::INT->isSubtype(sum));
+    REQUIRE(sum->isSubtype(sum));
+    REQUIRE(fn->isSubtype(other));
+    REQUIRE(fn->isSubtype(other));
+    REQUIRE(sum->isNotSubtype(fn));
+
+    // INT <: Wide, Wide <: Wide, fn <: other, Wide </: fn
+    REQUIRE(SubtypeCache::size() == 4);
+  }
+
+  SECTION("Primitive queries are not cached")
+  {
+    REQUIRE(Types::INT->isSubtype(Types::INT));
+    REQUIRE(Types::INT->isNotSubtype(Types::STR));
+    REQUIRE(SubtypeCache::size() == 0);
+  }
+
+  SECTION("Inference is never cached")
+  {
+    TypeInfer *inf = new TypeInfer();
+    REQUIRE(inf->isSubtype(sum));
+    REQUIRE(inf->toString() == "{VAR/Wide}");
+
+    TypeInfer *inf2 = new TypeInfer();
+    REQUIRE(sum->isSubtype(inf2));
+    REQUIRE(inf2->isSubtype(sum));
+
+    REQUIRE_FALSE(SubtypeCache::lookup(inf, sum).has_value());
+    REQUIRE_FALSE(SubtypeCache::lookup(sum, inf2).has_value());
+    REQUIRE_FALSE(SubtypeCache::lookup(inf2, sum).has_value());
+  }
+}
+
+
+TEST_CASE("Error limits and diagnostic formats", "[semantic]")
+{
+  antlr4::ANTLRInputStream input(R""""(
+int func program() {
+  int a <- "x";
+  int b <- "y";
+  int c <- "z";
+  return 0;
+}
+)"""");
+  WPLLexer lexer(&input);
+  antlr4::CommonTokenStream tokens(&lexer);
+  WPLParser parser(&tokens);
+  parser.removeErrorListeners();
+  WPLParser::CompilationUnitContext *tree = NULL;
+  REQUIRE_NOTHROW(tree = parser.compilationUnit());
+  REQUIRE(tree != NULL);
+
+  SECTION("No limit")
+  {
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+
+    std::string errs = sv->getErrors();
+    REQUIRE(std::count(errs.begin(), errs.end(), '\n') == 3);
+  }
+
+  SECTION("Limit stops early")
+  {
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->setErrorLimit(2);
+    sv->visitCompilationUnit(tree);
+
+    std::string errs = sv->getErrors();
+    REQUIRE(errs.find("[3,") != std::string::npos);
+    REQUIRE(errs.find("[4,") != std::string::npos);
+    REQUIRE(errs.find("[5,") == std::string::npos);
+    REQUIRE(errs.find("Error limit of 2 reached") != std::string::npos);
+  }
+
+  SECTION("JSON and SARIF")
+  {
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->setErrorLimit(1);
+    sv->visitCompilationUnit(tree);
+
+    std::string json = sv->getErrors(JSON);
+    REQUIRE(json.rfind("[", 0) == 0);
+    REQUIRE(json.find("\"line\": 3, \"column\": 6, \"endLine\": 3, \"endColumn\": 14") != std::string::npos);
+
+    std::string sarif = sv->getErrors(SARIF);
+    REQUIRE(sarif.find("\"version\": \"2.1.0\"") != std::string::npos);
+    REQUIRE(sarif.find("\"startLine\": 3, \"startColumn\": 7") != std::string::npos);
+
+    // The errors of several files can be combined into one document
+    std::vector<std::string> entries = sv->getErrorEntries(SARIF);
+    std::vector<std::string> more = sv->getErrorEntries(SARIF);
+    entries.insert(entries.end(), more.begin(), more.end());
+
+    std::string combined = WPLErrorHandler::wrapEntries(entries, SARIF);
+    REQUIRE(combined.find("\"runs\"") == combined.rfind("\"runs\""));
+    REQUIRE(combined.find("\"startLine\": 3") != combined.rfind("\"startLine\": 3"));
+  }
+
+  SECTION("Messages are only built when displayed")
+  {
+    WPLErrorHandler handler;
+    bool rendered = false;
+
+    handler.addSemanticError(tree, [&rendered]()
+                             { rendered = true; return std::string("lazy"); });
+    REQUIRE(handler.hasErrors(0));
+    REQUIRE_FALSE(rendered);
+
+    REQUIRE(handler.errorList().find("lazy") != std::string::npos);
+    REQUIRE(rendered);
+  }
+}
+
+
+TEST_CASE("Constant expressions", "[semantic]")
+{
+  SECTION("Global initializers and array lengths")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int g <- (1 + 2) * 3 - 10 / 4;
+boolean b <- ~(1 < 2) | 3 = 3;
+int [2 * 4] arr;
+
+int func program() {
+  int [g] local;
+  return local.length + arr.length;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), pm);
+    sv->visitCompilationUnit(tree);
+
+    // g is not a constant (only literals are), so it cannot be used as an array length
+    REQUIRE(sv->hasErrors(ERROR));
+    REQUIRE(sv->getErrors().find("Array length must be a constant INT expression, but was: g") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Global variables must be") == std::string::npos);
+
+    auto gDecl = dynamic_cast<WPLParser::VarDeclStatementContext *>(tree->stmts.at(0));
+    REQUIRE(gDecl);
+    REQUIRE(pm->getConstant(gDecl->assignments.at(0)->ex) == std::optional<ConstValue>((int64_t)7));
+
+    auto bDecl = dynamic_cast<WPLParser::VarDeclStatementContext *>(tree->stmts.at(1));
+    REQUIRE(bDecl);
+    REQUIRE(pm->getConstant(bDecl->assignments.at(0)->ex) == std::optional<ConstValue>(true));
+  }
+
+  SECTION("Folding follows runtime semantics")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+  int a <- 2147483647 + 1;
+  int b <- 7 / 0;
+  boolean c <- false & program() = 0;
+  boolean d <- program() = 0 & false;
+  return 0;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), pm);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(ERROR));
+
+    auto program = dynamic_cast<WPLParser::FuncDefContext *>(tree->stmts.at(0));
+    REQUIRE(program);
+
+    auto getInit = [&](unsigned int i)
+    { return dynamic_cast<WPLParser::VarDeclStatementContext *>(program->block()->stmts.at(i))->assignments.at(0)->ex; };
+
+    // Overflow wraps around
+    REQUIRE(pm->getConstant(getInit(0)) == std::optional<ConstValue>((int64_t)INT32_MIN));
+    // Division by zero is left to runtime
+    REQUIRE_FALSE(pm->getConstant(getInit(1)));
+    // & short-circuits, so a leading false is enough...
+    REQUIRE(pm->getConstant(getInit(2)) == std::optional<ConstValue>(false));
+    // ...but a trailing one is not as the call must still happen
+    REQUIRE_FALSE(pm->getConstant(getInit(3)));
+  }
+}
+
+TEST_CASE("Loop hints", "[semantic]")
+{
+  SECTION("Known hints are accepted")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+  int i <- 0;
+  @unroll(4) @vectorize(8) @interleave(2)
+  while i < 10 do {
+    i <- i + 1;
+  }
+  return i;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(ERROR));
+  }
+
+  SECTION("Unknown hints and zero counts are rejected")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+  int i <- 0;
+  @fuse(2)
+  while i < 10 do {
+    i <- i + 1;
+  }
+  @unroll(0)
+  while i < 20 do {
+    i <- i + 1;
+  }
+  return i;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE(sv->hasErrors(ERROR));
+    REQUIRE(sv->getErrors().find("Unknown loop hint: @fuse") != std::string::npos);
+    REQUIRE(sv->getErrors().find("@unroll expects a count") != std::string::npos);
+  }
+
+  SECTION("Counts with leading zeros do not parse")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+  int i <- 0;
+  @unroll(00)
+  while i < 10 do {
+    i <- i + 1;
+  }
+  return i;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    REQUIRE_NOTHROW(parser.compilationUnit());
+    REQUIRE(parser.getNumberOfSyntaxErrors() > 0);
+  }
+}
+
+TEST_CASE("Sized integer semantics", "[semantic]")
+{
+  SECTION("Constants and widening conversions are implicit")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int64 func total(int8 [4] bytes) {
+  int64 sum <- 0;
+  int i <- 0;
+  while i < bytes.length do {
+    sum <- sum + bytes[i];
+    i <- i + 1;
+  }
+  return sum;
+}
+
+int func program() {
+  int8 [4] bytes;
+  bytes[0] <- 127;
+  bytes[1] <- -128;
+  uint8 small <- 255;
+  uint32 count <- small * 2;
+  int64 big <- 5000000000;
+  int64 t <- total(bytes) + big;
+  return int(t / 1000);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(ERROR));
+  }
+
+  SECTION("Narrowing and sign changes require an explicit conversion")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+  int a <- 1000;
+  int8 narrow <- a;
+  int8 overflow <- 128;
+  uint32 u <- 1;
+  int mixed <- a + u;
+  int8 ok <- int8(a);
+  return 0;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE(sv->hasErrors(ERROR));
+    REQUIRE(sv->getErrors().find("Expression of type INT cannot be assigned to INT8") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Cannot implicitly convert between INT and UINT32") != std::string::npos);
+    REQUIRE(sv->getErrors().find("int8(a)") == std::string::npos);
+  }
+
+  SECTION("Constant expressions wrap around to their own type")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int64 k <- 3000000000 + 1;
+uint8 m <- uint8(200) + 100;
+int8 n <- int8(-128) - 1;
+uint64 u <- uint64(-1);
+
+int func program() {
+  return 0;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    PropertyManager *pm = new PropertyManager();
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), pm);
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(ERROR));
+
+    auto getInit = [&](unsigned int i)
+    { return dynamic_cast<WPLParser::VarDeclStatementContext *>(tree->stmts.at(i))->assignments.at(0)->ex; };
+
+    REQUIRE(pm->getConstant(getInit(0)) == std::optional<ConstValue>((int64_t)3000000001));
+    REQUIRE(pm->getConstantType(getInit(0)) == std::optional<const TypeInt *>(static_cast<const TypeInt *>(Types::INT64)));
+    REQUIRE(pm->getConstant(getInit(1)) == std::optional<ConstValue>((int64_t)44));
+    REQUIRE(pm->getConstantType(getInit(1)) == std::optional<const TypeInt *>(static_cast<const TypeInt *>(Types::UINT8)));
+    REQUIRE(pm->getConstant(getInit(2)) == std::optional<ConstValue>((int64_t)127));
+    REQUIRE(pm->getConstant(getInit(3)) == std::optional<ConstValue>((int64_t)-1));
+  }
+}
+
+TEST_CASE("Array slice semantics", "[semantic]")
+{
+  SECTION("Arrays of any length can be passed as slices")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func sum(int [] xs) {
+  int total <- 0;
+  int i <- 0;
+  while i < xs.length do {
+    total <- total + xs[i];
+    i <- i + 1;
+  }
+  return total;
+}
+
+proc zero(int [] xs) {
+  xs[0] <- 0;
+}
+
+int func program() {
+  int [3] small;
+  int [5] big;
+  zero(big);
+  return sum(small) + sum(big);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(ERROR));
+  }
+
+  SECTION("Slices cannot outlive their parameter")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func first(int [] xs) {
+  var copy <- xs;
+  int [] other;
+  return xs[0];
+}
+
+int func program() {
+  return 0;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE(sv->hasErrors(ERROR));
+    REQUIRE(sv->getErrors().find("Slices can only be used as parameter types and cannot be assigned to variables") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Slices can only be used as parameter types, but found") != std::string::npos);
+  }
+}
+
+TEST_CASE("Dynamic array semantics", "[semantic]")
+{
+  SECTION("Runtime sized arrays that can grow")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+extern int func getIntArg(int i);
+
+int func sum(int [] xs) {
+  int total <- 0;
+  int i <- 0;
+  while i < xs.length do {
+    total <- total + xs[i];
+    i <- i + 1;
+  }
+  return total;
+}
+
+int func program() {
+  int [* getIntArg(1)] xs;
+  int [*] ys;
+  xs[0] <- 1;
+  ys.push(xs[0]);
+  ys.resize(ys.length + 10);
+  return sum(xs) + sum(ys);
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(ERROR));
+  }
+
+  SECTION("Dynamic arrays are owned by the block declaring them")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int [*] global;
+
+int func program() {
+  int [* 4] xs;
+  var copy <- xs;
+  xs <- xs;
+  xs.push(true);
+  return 0;
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE(sv->hasErrors(ERROR));
+    REQUIRE(sv->getErrors().find("Dynamic arrays can only be declared as local variables") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Dynamic arrays cannot be initialized by assignment") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Cannot assign to dynamic array xs") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Argument 0 provided to xs.push expected INT but got BOOL") != std::string::npos);
+  }
+}
+
+TEST_CASE("Array builtin semantics", "[semantic]")
+{
+  SECTION("Bulk operations on any kind of array")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func score(int [] weights, int [] values) {
+  return weights.dot(values) + values.max() - values.min();
+}
+
+int func program() {
+  int [8] a;
+  int [8] b;
+  a.fill(1);
+  b.copy(a);
+  b.add(a);
+  b.mul(a);
+  int64 [4] big;
+  int64 total <- big.sum();
+  boolean [3] flags;
+  flags.fill(true);
+  return score(a, b) + a.sum();
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE_FALSE(sv->hasErrors(ERROR));
+  }
+
+  SECTION("Arithmetic builtins require integer elements")
+  {
+    antlr4::ANTLRInputStream input(R""""(
+int func program() {
+  boolean [3] flags;
+  boolean any <- flags.sum();
+  int [3] a;
+  int8 [3] small;
+  a.push(1);
+  a.copy(small);
+  return a.dot();
+}
+)"""");
+    WPLLexer lexer(&input);
+    antlr4::CommonTokenStream tokens(&lexer);
+    WPLParser parser(&tokens);
+    parser.removeErrorListeners();
+    WPLParser::CompilationUnitContext *tree = NULL;
+    REQUIRE_NOTHROW(tree = parser.compilationUnit());
+    REQUIRE(tree != NULL);
+
+    SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager());
+    sv->visitCompilationUnit(tree);
+    REQUIRE(sv->hasErrors(ERROR));
+    REQUIRE(sv->getErrors().find("Cannot invoke sum on BOOL[3]") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Cannot invoke push on INT[3]") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Argument 0 provided to a.copy expected INT[] but got INT8[3]") != std::string::npos);
+    REQUIRE(sv->getErrors().find("Invocation of a.dot expected 1 argument(s), but got 0") != std::string::npos);
+  }
+}
+TEST_CASE("Externs taking aggregates as values", "[semantic]")
+{
+  antlr4::ANTLRInputStream input(R""""(
+extern int func first(int [4] a);
+
+int func apply(int [4] -> int fn) {
+  int [4] a;
+  return fn(a);
+}
+
+int func program() {
+  return apply(first);
+}
+)"""");
+  WPLLexer lexer(&input);
+  antlr4::CommonTokenStream tokens(&lexer);
+  WPLParser parser(&tokens);
+  parser.removeErrorListeners();
+  WPLParser::CompilationUnitContext *tree = NULL;
+  REQUIRE_NOTHROW(tree = parser.compilationUnit());
+  REQUIRE(tree != NULL);
+
+  // Externs take aggregates by value, so they cannot be called like WPL invokables which take them by reference
+  SemanticVisitor *sv = new SemanticVisitor(new STManager(), new PropertyManager(), CompilerFlags::AGGREGATE_REFS);
+  sv->visitCompilationUnit(tree);
+  REQUIRE(sv->hasErrors(ERROR));
+  REQUIRE(sv->getErrors().find("Cannot use extern first") != std::string::npos);
+
+  // Without AGGREGATE_REFS, both pass them the same way
+  SemanticVisitor *byValue = new SemanticVisitor(new STManager(), new PropertyManager(), 0);
+  byValue->visitCompilationUnit(tree);
+  REQUIRE_FALSE(byValue->hasErrors(ERROR));
+}
@@ -0,0 +1,131 @@
+/**
+ * @file module_interface_tests.cpp
+ * @author Alex Friedman (ahfriedman.com)
+ * @brief Tests for reading and writing module interfaces
+ * @version 0.1
+ * @date 2022-11-28
+ */
+#include <catch2/catch_test_macros.hpp>
+#include "ModuleInterface.h"
+#include "CompilerFlags.h"
+
+TEST_CASE("Module interface round trip", "[symbol]")
+{
+  LinkedMap<std::string, const Type *> elements;
+  elements.insert({"x", Types::INT});
+  elements.insert({"name", Types::STR});
+
+  const TypeStruct *point = new TypeStruct(elements, "Point");
+  std::set<const Type *, TypeCompare> cases = {Types::INT, Types::BOOL, point};
+  const TypeSum *shape = new TypeSum(cases, "Shape");
+
+  const TypeInvoke *fn = new TypeInvoke({point, new TypeArray(Types::INT, 5)}, shape, false, true);
+
+  TypeInfer *inf = new TypeInfer();
+  REQUIRE(inf->isSubtype(Types::BOOL));
+
+  std::vector<const Symbol *> exports = {
+      new Symbol("Point", point, true, true),
+      new Symbol("Shape", shape, true, true),
+      new Symbol("make", fn, true, true),
+      new Symbol("count", Types::INT, false, true),
+      new Symbol("flag", inf, false, true),
+  };
+
+  std::stringstream buffer;
+  REQUIRE(ModuleInterface::write(buffer, exports));
+
+  STManager *stmgr = new STManager();
+  std::optional<std::vector<Symbol *>> loaded = ModuleInterface::read(buffer, stmgr);
+
+  REQUIRE(loaded.has_value());
+  CHECK(loaded.value().size() == 5);
+  CHECK(stmgr->isGlobalScope());
+
+  Symbol *pointSym = stmgr->lookup("Point").value();
+  CHECK(pointSym->isDefinition);
+  CHECK(pointSym->type->toString() == "Point");
+
+  const TypeStruct *loadedPoint = dynamic_cast<const TypeStruct *>(pointSym->type);
+  REQUIRE(loadedPoint);
+  CHECK(loadedPoint->getIndex("name") == 1);
+  CHECK(loadedPoint->get("x").value()->isSubtype(Types::INT));
+
+  const TypeInvoke *loadedFn = dynamic_cast<const TypeInvoke *>(stmgr->lookup("make").value()->type);
+  REQUIRE(loadedFn);
+  CHECK(loadedFn->toString() == fn->toString());
+  CHECK(loadedFn->isDefined());
+
+  // The struct used in the signature must be the same one that was defined
+  CHECK(loadedFn->getParamTypes().at(0) == pointSym->type);
+  CHECK(loadedFn->getReturnType() == stmgr->lookup("Shape").value()->type);
+
+  Symbol *countSym = stmgr->lookup("count").value();
+  CHECK(countSym->isGlobal);
+  CHECK_FALSE(countSym->isDefinition);
+  CHECK(countSym->type->isSubtype(Types::INT));
+
+  CHECK(stmgr->lookup("flag").value()->type->isSubtype(Types::BOOL));
+}
+
+TEST_CASE("Module interface errors", "[symbol]")
+{
+  SECTION("Uninferred vars cannot be exported")
+  {
+    std::stringstream buffer;
+    CHECK_FALSE(ModuleInterface::write(buffer, {new Symbol("a", new TypeInfer(), false, true)}));
+  }
+
+  SECTION("Malformed interfaces are rejected")
+  {
+    std::stringstream buffer("WPLX");
+    CHECK_FALSE(ModuleInterface::read(buffer, new STManager()).has_value());
+  }
+
+  SECTION("Conflicting symbols are rejected")
+  {
+    std::stringstream buffer;
+    REQUIRE(ModuleInterface::write(buffer, {new Symbol("a", Types::INT, false, true)}));
+
+    STManager *stmgr = new STManager();
+    stmgr->enterScope();
+    stmgr->addSymbol(new Symbol("a", Types::STR, false, true));
+
+    CHECK_FALSE(ModuleInterface::read(buffer, stmgr).has_value());
+  }
+
+  SECTION("Interfaces with different ABI flags are rejected")
+  {
+    std::stringstream buffer;
+    REQUIRE(ModuleInterface::write(buffer, {new Symbol("a", Types::INT, false, true)}, CompilerFlags::AGGREGATE_REFS));
+
+    CHECK_FALSE(ModuleInterface::read(buffer, new STManager(), 0).has_value());
+  }
+}
+
+TEST_CASE("Module interface arrays and anonymous sums", "[symbol]")
+{
+  const TypeSum *anon = new TypeSum({Types::INT, Types::BOOL});
+  const TypeInvoke *fn = new TypeInvoke({new TypeDynArray(Types::INT), new TypeSlice(Types::STR)}, anon, false, true);
+
+  std::stringstream buffer;
+  REQUIRE(ModuleInterface::write(buffer, {new Symbol("f", fn, true, true)}, CompilerFlags::AGGREGATE_REFS));
+
+  STManager *stmgr = new STManager();
+  REQUIRE(ModuleInterface::read(buffer, stmgr, CompilerFlags::AGGREGATE_REFS).has_value());
+
+  const TypeInvoke *loadedFn = dynamic_cast<const TypeInvoke *>(stmgr->lookup("f").value()->type);
+  REQUIRE(loadedFn);
+  CHECK(loadedFn->toString() == fn->toString());
+
+  const TypeDynArray *dyn = dynamic_cast<const TypeDynArray *>(loadedFn->getParamTypes().at(0));
+  REQUIRE(dyn);
+  CHECK(dyn->getValueType() == Types::INT);
+
+  // Anonymous sums are not looked up by name, so they should not pick up an unrelated definition
+  const TypeSum *loadedSum = dynamic_cast<const TypeSum *>(loadedFn->getReturnType());
+  REQUIRE(loadedSum);
+  CHECK_FALSE(loadedSum->getName().has_value());
+  CHECK(loadedSum->getCases().size() == 2);
+  CHECK(loadedSum->isSubtype(anon));
+}